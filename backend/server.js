@@ -24,6 +24,15 @@ app.use(express.json());
 // Initialize user preferences tracker
 const userPrefs = new UserPreferences();
 
+// Link-based page scores written by the crawler's PageRank stage
+// (pages.page_rank, 1.0 is an average page). They boost the text score by up
+// to PAGE_RANK_WEIGHT; databases without the column rank by text alone.
+const PAGE_RANK_WEIGHT = 1.0;
+const hasPageRank = db.prepare("SELECT 1 FROM pragma_table_info('pages') WHERE name = 'page_rank'").get() !== undefined;
+const textRankOrder = hasPageRank
+    ? `rank * (1 + ${PAGE_RANK_WEIGHT} * COALESCE(p.page_rank, 0) / (COALESCE(p.page_rank, 0) + 1))`
+    : 'rank';
+
 // Initialize cache (TTL: 5 minutes, check period: 10 minutes)
 const searchCache = new NodeCache({ stdTTL: 300, checkperiod: 600 });
 
@@ -382,7 +391,7 @@ app.get("/search", (req, res) => {
             LEFT JOIN images i ON p.id = i.page_id
             WHERE pages_fts MATCH ?
             GROUP BY p.id
-            ORDER BY title_priority ASC, title_length ASC, rank ASC
+            ORDER BY title_priority ASC, title_length ASC, ${textRankOrder} ASC
             LIMIT 10
         `;
 
@@ -0,0 +1,103 @@
+#ifndef BENCH_UTIL_HPP
+#define BENCH_UTIL_HPP
+
+// Helpers shared by the offline benchmarks
+
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+#include "../html_store.hpp"
+
+#ifndef BENCH_CORPUS_DIR
+#define BENCH_CORPUS_DIR "bench/corpus"
+#endif
+
+struct CorpusPage {
+    std::string name;
+    std::string url;
+    std::string html;
+};
+
+inline bool endsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Load every *.html file in a directory (sorted by name)
+inline std::vector<CorpusPage> loadCorpusDir(const std::string& dir) {
+    std::vector<CorpusPage> pages;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        std::cerr << "Cannot open corpus directory: " << dir << std::endl;
+        return pages;
+    }
+    while (dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (!endsWith(name, ".html")) continue;
+        std::ifstream in(dir + "/" + name, std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        pages.push_back({name, "https://bench.example/" + name, ss.str()});
+    }
+    closedir(d);
+    std::sort(pages.begin(), pages.end(),
+              [](const CorpusPage& a, const CorpusPage& b) { return a.name < b.name; });
+    return pages;
+}
+
+// Load up to `limit` real pages (their stored raw HTML) from a crawler database
+inline std::vector<CorpusPage> loadCorpusDb(const std::string& path, int limit) {
+    std::vector<CorpusPage> pages;
+    sqlite3* db;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open database: " << path << std::endl;
+        sqlite3_close(db);
+        return pages;
+    }
+    HtmlReader reader(db);
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT id, url FROM pages ORDER BY id";
+    if (reader.ok() && sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+        std::string html;
+        while (static_cast<int>(pages.size()) < limit && sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* url = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            if (!url || !reader.readByPageId(sqlite3_column_int64(stmt, 0), html)) continue;
+            pages.push_back({url, url, html});
+        }
+        sqlite3_finalize(stmt);
+    } else {
+        std::cerr << "Query failed: " << sqlite3_errmsg(db) << std::endl;
+    }
+    sqlite3_close(db);
+    return pages;
+}
+
+// Load the corpus named on the command line: a directory of .html files or
+// a crawler .db file. Defaults to the checked-in corpus.
+inline std::vector<CorpusPage> loadCorpus(const std::string& source) {
+    if (endsWith(source, ".db")) return loadCorpusDb(source, 1000);
+    return loadCorpusDir(source);
+}
+
+// Run fn() `iterations` times and return the mean nanoseconds per call
+template <typename Fn>
+double timeNsPerOp(int iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) fn();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// Keep the optimizer from discarding a benchmark result
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif // BENCH_UTIL_HPP
@@ -0,0 +1,333 @@
+// Runs the crawler's hot paths offline against the checked-in corpus (saved
+// HTML pages plus robots files in <corpus>/robots) and reports ns/op, heap
+// allocations per op and ops/sec. --json prints the same numbers as one
+// JSON document for regression tracking.
+//
+//   ./crawler_bench [--json] [--min-time=SECONDS] [corpus-dir | crawler_data.db]
+//
+// Allocations are counted through operator new; memory that C libraries
+// (gumbo, SQLite, zstd) get from malloc directly is not included.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <random>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "../database.hpp"
+#include "../html_parser.hpp"
+#include "../page_arena.hpp"
+#include "../robots.hpp"
+#include "../simhash.hpp"
+#include "../url_utils.hpp"
+
+namespace {
+
+const size_t MIN_DICT_PAGES = 100;
+const size_t NEAR_DUPLICATE_INDEX_PAGES = 1000000;  // stored pages the duplicate check runs against
+
+std::atomic<size_t> allocationCount{0};
+std::atomic<size_t> allocationBytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource allocates through the aligned forms
+void* operator new(size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct Result {
+    std::string name;
+    std::string unit;   // what one op is
+    size_t ops = 0;
+    double ns = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;
+
+    double nsPerOp() const { return ops ? ns / ops : 0; }
+    double opsPerSec() const { return ns > 0 ? ops * 1e9 / ns : 0; }
+    double allocsPerOp() const { return ops ? static_cast<double>(allocations) / ops : 0; }
+    double bytesPerOp() const { return ops ? static_cast<double>(bytes) / ops : 0; }
+};
+
+// Repeat pass() (which performs opsPerPass ops) until minSeconds of timed
+// work. reset() runs untimed between passes.
+template <typename Pass, typename Reset>
+Result measure(const std::string& name, const std::string& unit, size_t opsPerPass, double minSeconds,
+               Pass&& pass, Reset&& reset) {
+    Result result;
+    result.name = name;
+    result.unit = unit;
+    if (opsPerPass == 0) return result;
+
+    pass();  // warm up caches and pools
+    reset();
+    while (result.ns < minSeconds * 1e9) {
+        size_t allocationsBefore = allocationCount.load();
+        size_t bytesBefore = allocationBytes.load();
+        auto start = std::chrono::steady_clock::now();
+        pass();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        result.allocations += allocationCount.load() - allocationsBefore;
+        result.bytes += allocationBytes.load() - bytesBefore;
+        result.ns += std::chrono::duration<double, std::nano>(elapsed).count();
+        result.ops += opsPerPass;
+        reset();
+    }
+    return result;
+}
+
+template <typename Pass>
+Result measure(const std::string& name, const std::string& unit, size_t opsPerPass, double minSeconds, Pass&& pass) {
+    return measure(name, unit, opsPerPass, minSeconds, pass, []() {});
+}
+
+std::vector<std::string> loadRobotsFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return files;
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(d)) {
+        if (endsWith(entry->d_name, ".txt")) names.push_back(entry->d_name);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    for (const auto& name : names) {
+        std::ifstream in(dir + "/" + name, std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        files.push_back(ss.str());
+    }
+    return files;
+}
+
+// Function to escape a string for JSON output
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+void printTable(const std::vector<Result>& results) {
+    std::cout << std::left << std::setw(20) << "benchmark" << std::right << std::setw(12) << "ns/op"
+              << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op" << std::setw(14) << "ops/sec"
+              << "  unit" << std::endl;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(20) << r.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << r.nsPerOp() << std::setw(12) << r.allocsPerOp() << std::setw(12)
+                  << r.bytesPerOp() << std::setw(14) << std::setprecision(0) << r.opsPerSec() << "  " << r.unit
+                  << std::endl;
+    }
+}
+
+void printJson(const std::vector<Result>& results, const std::string& corpus, size_t pages, size_t links) {
+    std::cout << "{\"corpus\": " << jsonString(corpus) << ", \"pages\": " << pages << ", \"links\": " << links
+              << ", \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::cout << (i ? ", " : "") << std::fixed << std::setprecision(2) << "{\"name\": " << jsonString(r.name)
+                  << ", \"unit\": " << jsonString(r.unit) << ", \"ops\": " << r.ops << ", \"ns_per_op\": "
+                  << r.nsPerOp() << ", \"allocs_per_op\": " << r.allocsPerOp() << ", \"bytes_per_op\": "
+                  << r.bytesPerOp() << ", \"ops_per_sec\": " << r.opsPerSec() << "}";
+    }
+    std::cout << "]}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string source = BENCH_CORPUS_DIR;
+    bool json = false;
+    double minSeconds = 0.5;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg.compare(0, 11, "--min-time=") == 0) {
+            minSeconds = std::stod(arg.substr(11));
+        } else {
+            source = arg;
+        }
+    }
+
+    std::vector<CorpusPage> corpus = loadCorpus(source);
+    if (corpus.empty()) {
+        std::cerr << "No pages found in " << source << std::endl;
+        return 1;
+    }
+    std::vector<std::string> robotsFiles = loadRobotsFiles(std::string(BENCH_CORPUS_DIR) + "/robots");
+
+    // Inputs derived from the corpus: parsed pages and every link they hold
+    std::vector<BodyBuffer> bodies;
+    std::vector<PageData> parsed;
+    std::vector<std::string> links;
+    for (const auto& page : corpus) {
+        bodies.push_back(makeBodyBuffer(page.html));
+        parsed.push_back(parseHTML(bodies.back(), page.url));
+        for (const auto& link : parsed.back().outgoingLinks) links.emplace_back(link);
+    }
+    std::vector<RobotsRules> robots;
+    for (const auto& body : robotsFiles) {
+        robots.push_back(parseRobotsTxt(body, "CustomSearchBot"));
+    }
+
+    std::vector<Result> results;
+
+    results.push_back(measure("normalizeUrl", "url", links.size(), minSeconds, [&]() {
+        for (const auto& link : links) doNotOptimize(normalizeUrl(link));
+    }));
+
+    results.push_back(measure("parseHTML", "page", corpus.size(), minSeconds, [&]() {
+        for (size_t i = 0; i < corpus.size(); i++) doNotOptimize(parseHTML(bodies[i], corpus[i].url));
+    }));
+
+    // The crawler's path: each page parsed into the worker's arena, which
+    // is reset before the next one
+    results.push_back(measure("parseHTMLArena", "page", corpus.size(), minSeconds, [&]() {
+        PageArena& arena = threadPageArena();
+        ParseOptions options;
+        options.arena = &arena;
+        for (size_t i = 0; i < corpus.size(); i++) {
+            arena.reset();
+            doNotOptimize(parseHTML(bodies[i], corpus[i].url, options));
+        }
+    }));
+
+    results.push_back(measure("extractLinks", "page", corpus.size(), minSeconds, [&]() {
+        for (const auto& page : corpus) doNotOptimize(extractLinks(page.html, page.url));
+    }));
+
+    results.push_back(measure("parseRobotsTxt", "file", robotsFiles.size(), minSeconds, [&]() {
+        for (const auto& body : robotsFiles) doNotOptimize(parseRobotsTxt(body, "CustomSearchBot"));
+    }));
+
+    results.push_back(measure("isAllowedByRobots", "url", links.size() * robots.size(), minSeconds, [&]() {
+        for (const auto& rules : robots) {
+            for (const auto& link : links) doNotOptimize(isAllowedByRobots(link, rules));
+        }
+    }));
+
+    results.push_back(measure("isValidPage", "page", parsed.size(), minSeconds, [&]() {
+        for (const auto& data : parsed) doNotOptimize(isValidPage(data));
+    }));
+
+    results.push_back(measure("simhash", "page", parsed.size(), minSeconds, [&]() {
+        for (const auto& data : parsed) doNotOptimize(simhash(data.content));
+    }));
+
+    // Near-duplicate check of every page against an index holding a large
+    // crawl's worth of other fingerprints (no match, so all four bands are
+    // scanned)
+    {
+        NearDuplicateIndex index;
+        std::mt19937_64 random(42);
+        for (size_t i = 0; i < NEAR_DUPLICATE_INDEX_PAGES; i++) index.insert(random(), "stored");
+        std::vector<uint64_t> fingerprints;
+        std::vector<std::string> urls;
+        for (const auto& data : parsed) {
+            fingerprints.push_back(simhash(data.content));
+            urls.emplace_back(data.url);
+        }
+        std::string original;
+        int distance = 0;
+        results.push_back(measure("nearDuplicateCheck", "page", parsed.size(), minSeconds, [&]() {
+            for (size_t i = 0; i < parsed.size(); i++) {
+                doNotOptimize(index.find(fingerprints[i], urls[i], original, distance));
+            }
+        }));
+    }
+
+    // savePage (what the writer thread runs per page) on a scratch database,
+    // one transaction per corpus pass; rows are deleted between passes
+    char dbPath[] = "/tmp/crawler_bench_XXXXXX";
+    int fd = mkstemp(dbPath);
+    if (fd >= 0) close(fd);
+    std::streambuf* stdoutBuffer = std::cout.rdbuf();
+    std::ostringstream initLog;
+    if (json) std::cout.rdbuf(initLog.rdbuf());  // keep the JSON document clean
+    sqlite3* db = fd >= 0 ? initDatabase(dbPath) : nullptr;
+    std::cout.rdbuf(stdoutBuffer);
+    if (db) {
+        {
+            // Train the HTML dictionary during the warm-up pass when the
+            // corpus is big enough to train one, otherwise store without
+            HtmlStoreConfig htmlConfig;
+            htmlConfig.dictSamplePages = parsed.size() >= MIN_DICT_PAGES ? parsed.size() : SIZE_MAX;
+            PageStatements statements(db, htmlConfig);
+            results.push_back(measure("savePage", "page", parsed.size(), minSeconds, [&]() {
+                sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, 0);
+                for (const auto& data : parsed) {
+                    statements.savepoint();
+                    if (statements.savePage(data) < 0) statements.rollbackToSavepoint();
+                    statements.release();
+                }
+                sqlite3_exec(db, "COMMIT", 0, 0, 0);
+                statements.trainDictionaryIfReady();
+            }, [&]() {
+                sqlite3_exec(db, "DELETE FROM page_html; DELETE FROM images; DELETE FROM tags; "
+                                 "DELETE FROM links; DELETE FROM pages;", 0, 0, 0);
+            }));
+        }
+        sqlite3_close(db);
+    }
+    for (const char* suffix : {"", "-wal", "-shm"}) {
+        std::remove((std::string(dbPath) + suffix).c_str());
+    }
+
+    if (json) {
+        printJson(results, source, corpus.size(), links.size());
+    } else {
+        std::cout << "Corpus: " << source << " (" << corpus.size() << " pages, " << links.size() << " links, "
+                  << robotsFiles.size() << " robots files)\n" << std::endl;
+        printTable(results);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Drives FetchEngine against one URL (typically a local HTTP server) and
+// reports request throughput and connection reuse.
+//
+//   python3 -m http.server 8000 &
+//   ./fetch_bench http://127.0.0.1:8000/ 2000 200
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+#include "../fetch_engine.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <url> [requests=1000] [in-flight=100]" << std::endl;
+        return 1;
+    }
+    std::string url = argv[1];
+    size_t requests = argc > 2 ? std::stoul(argv[2]) : 1000;
+    size_t inFlight = argc > 3 ? std::stoul(argv[3]) : 100;
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    size_t ok = 0, failed = 0, bytes = 0;
+    {
+        FetchEngineConfig config;
+        config.maxInFlight = inFlight;
+        FetchEngine engine(config);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t done = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < requests; i++) {
+            engine.fetch(url, [&](FetchResult&& result) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (result.ok()) {
+                    ok++;
+                    bytes += result.body->size();
+                } else {
+                    failed++;
+                    if (failed <= 5) std::cerr << "Failed: " << result.error << std::endl;
+                }
+                if (++done == requests) cv.notify_one();
+            });
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&]() { return done == requests; });
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Requests: " << requests << " (ok: " << ok << ", failed: " << failed << ")" << std::endl;
+        std::cout << "In flight: " << inFlight << std::endl;
+        std::cout << "Elapsed: " << elapsed << "s, " << (requests / elapsed) << " req/sec, "
+                  << (bytes / elapsed / (1024 * 1024)) << " MiB/sec" << std::endl;
+        std::cout << "Connections opened: " << engine.newConnectionCount()
+                  << ", reused: " << engine.reusedConnectionCount() << std::endl;
+    }
+
+    curl_global_cleanup();
+    return failed == 0 ? 0 : 1;
+}
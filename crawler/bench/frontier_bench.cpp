@@ -0,0 +1,303 @@
+// Compares the best-first frontier with plain BFS. First, push and pop
+// throughput of PriorityFrontier with millions of queued URLs. Then a
+// simulated crawl of synthetic news sites (header and footer navigation,
+// account and legal pages, sections with paginated listings, tags,
+// authors, comment pages and articles whose popularity follows a Zipf
+// distribution) under the crawler's per-site budget and depth limit.
+// Articles are the pages worth indexing; a popular article is one in the
+// top 10% by in-links over the whole site.
+//
+//   ./frontier_bench [urls=1000000] [sites=4] [articles-per-site=4000]
+
+#include <ftw.h>
+#include <iomanip>
+#include <random>
+#include <unordered_map>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "../frontier.hpp"
+#include "../html_parser.hpp"
+
+namespace {
+
+const int MAX_DEPTH = 3;  // as in crawler.cpp
+const int BUDGETS[] = {100, 1000};
+
+enum PageKind { PAGE_HOME, PAGE_SECTION, PAGE_LISTING, PAGE_NAV, PAGE_TAG, PAGE_AUTHOR, PAGE_ARTICLE, PAGE_COMMENTS,
+                PAGE_SHARE };
+
+struct Link {
+    uint32_t target;
+    uint8_t flags;
+};
+
+struct Page {
+    std::string url;
+    PageKind kind;
+    std::vector<Link> links;
+};
+
+struct Site {
+    std::vector<Page> pages;
+    std::unordered_map<std::string, uint32_t> byUrl;
+    std::vector<bool> popular;  // top 10% of articles by in-links
+    size_t articleCount = 0;
+};
+
+const char* const SECTIONS[] = {"world", "politics", "business", "tech", "science", "health",
+                                "sport", "culture", "travel", "climate", "opinion", "video"};
+const int SECTION_COUNT = 12;
+const char* const NAV_PATHS[] = {"/login", "/account/settings", "/subscribe", "/search?q=", "/privacy-policy",
+                                 "/terms-of-use", "/contact", "/help", "/careers", "/cookies", "/sitemap",
+                                 "/newsletter"};
+const char* const WORDS[] = {"election", "market", "storm", "vaccine", "league", "festival", "startup", "court",
+                             "budget", "energy", "museum", "summit", "record", "border", "rocket", "harvest"};
+const int LISTING_PAGES = 10;
+const int TAG_COUNT = 150;
+const int AUTHOR_COUNT = 40;
+
+Site makeSite(int siteIndex, size_t articles) {
+    Site site;
+    std::string origin = "https://site" + std::to_string(siteIndex) + ".example";
+    auto add = [&](const std::string& path, PageKind kind) {
+        site.byUrl[origin + path] = static_cast<uint32_t>(site.pages.size());
+        site.pages.push_back({origin + path, kind, {}});
+        return static_cast<uint32_t>(site.pages.size() - 1);
+    };
+
+    uint32_t home = add("/", PAGE_HOME);
+    std::vector<uint32_t> sections, navs, tags, authors, articleIds;
+    std::vector<std::vector<uint32_t>> listings(SECTION_COUNT), sectionArticles(SECTION_COUNT);
+    for (int s = 0; s < SECTION_COUNT; s++) {
+        sections.push_back(add(std::string("/news/") + SECTIONS[s], PAGE_SECTION));
+        for (int p = 2; p <= LISTING_PAGES; p++) {
+            listings[s].push_back(add(std::string("/news/") + SECTIONS[s] + "?page=" + std::to_string(p),
+                                      PAGE_LISTING));
+        }
+    }
+    for (const char* path : NAV_PATHS) navs.push_back(add(path, PAGE_NAV));
+    for (int t = 0; t < TAG_COUNT; t++) {
+        tags.push_back(add(std::string("/tag/") + WORDS[t % 16] + std::to_string(t), PAGE_TAG));
+    }
+    for (int a = 0; a < AUTHOR_COUNT; a++) {
+        authors.push_back(add("/author/writer-" + std::to_string(a), PAGE_AUTHOR));
+    }
+    std::mt19937_64 rng(1000 + siteIndex);
+    for (size_t i = 0; i < articles; i++) {
+        int s = static_cast<int>(i % SECTION_COUNT);
+        std::string path = std::string("/news/") + SECTIONS[s] + "/2024/" + std::to_string(1 + rng() % 12) + "/" +
+                           WORDS[rng() % 16] + "-" + WORDS[rng() % 16] + "-" + WORDS[rng() % 16] + "-" +
+                           std::to_string(i);
+        uint32_t id = add(path, PAGE_ARTICLE);
+        articleIds.push_back(id);
+        sectionArticles[s].push_back(id);
+    }
+    site.articleCount = articles;
+    std::vector<uint32_t> comments(articles), shares(articles);
+    for (size_t i = 0; i < articles; i++) {
+        comments[i] = add(site.pages[articleIds[i]].url.substr(origin.size()) + "/comments", PAGE_COMMENTS);
+        shares[i] = add("/share?url=" + std::to_string(i) + "&utm_source=site", PAGE_SHARE);
+    }
+
+    // Article popularity: a random order, picked with Zipf-like weights
+    std::vector<uint32_t> byPopularity = articleIds;
+    std::shuffle(byPopularity.begin(), byPopularity.end(), rng);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    auto popularArticle = [&]() {
+        double u = uniform(rng);
+        return byPopularity[static_cast<size_t>(u * u * u * byPopularity.size())];
+    };
+
+    const uint8_t TEXT = LINK_HAS_TEXT;
+    const uint8_t NAV = LINK_HAS_TEXT | LINK_BOILERPLATE;
+    for (uint32_t id = 0; id < site.pages.size(); id++) {
+        Page& page = site.pages[id];
+        std::vector<Link>& links = page.links;
+        // Header: logo image, sections, account links; footer: legal and help
+        links.push_back({home, LINK_BOILERPLATE});
+        for (uint32_t section : sections) links.push_back({section, NAV});
+        for (size_t n = 0; n < 4; n++) links.push_back({navs[n], NAV});
+        for (size_t n = 4; n < navs.size(); n++) links.push_back({navs[n], NAV});
+
+        switch (page.kind) {
+        case PAGE_HOME:
+            for (int n = 0; n < 40; n++) links.push_back({popularArticle(), TEXT});
+            break;
+        case PAGE_SECTION:
+        case PAGE_LISTING: {
+            int s = 0, p = 1;
+            for (; s < SECTION_COUNT; s++) {
+                if (page.url.find(std::string("/news/") + SECTIONS[s]) != std::string::npos) break;
+            }
+            size_t query = page.url.find("page=");
+            if (query != std::string::npos) p = std::stoi(page.url.substr(query + 5));
+            const std::vector<uint32_t>& list = sectionArticles[s];
+            for (size_t n = (p - 1) * 25; n < std::min(list.size(), static_cast<size_t>(p) * 25); n++) {
+                links.push_back({list[list.size() - 1 - n], TEXT});  // newest first
+            }
+            if (p < LISTING_PAGES) links.push_back({listings[s][p - 1], TEXT});
+            for (int n = 0; n < 5; n++) links.push_back({tags[rng() % tags.size()], TEXT});
+            break;
+        }
+        case PAGE_TAG:
+        case PAGE_AUTHOR:
+            for (int n = 0; n < 20; n++) links.push_back({popularArticle(), TEXT});
+            break;
+        case PAGE_ARTICLE: {
+            size_t i = page.url.rfind('-');
+            size_t article = std::stoul(page.url.substr(i + 1));
+            for (int n = 0; n < 10; n++) links.push_back({popularArticle(), TEXT});
+            for (int n = 0; n < 3; n++) links.push_back({tags[rng() % tags.size()], TEXT});
+            links.push_back({authors[rng() % authors.size()], TEXT});
+            links.push_back({comments[article], TEXT});
+            links.push_back({shares[article], 0});
+            break;
+        }
+        case PAGE_COMMENTS:
+            links.push_back({site.byUrl[page.url.substr(0, page.url.size() - 9)], TEXT});
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Popular articles: top 10% by in-links
+    std::vector<uint32_t> inlinks(site.pages.size());
+    for (const Page& page : site.pages) {
+        for (const Link& link : page.links) inlinks[link.target]++;
+    }
+    std::vector<uint32_t> ranked = articleIds;
+    std::sort(ranked.begin(), ranked.end(), [&](uint32_t a, uint32_t b) { return inlinks[a] > inlinks[b]; });
+    site.popular.assign(site.pages.size(), false);
+    for (size_t n = 0; n < ranked.size() / 10; n++) site.popular[ranked[n]] = true;
+    return site;
+}
+
+struct CrawlStats {
+    size_t fetched = 0;
+    size_t articles = 0;
+    size_t popular = 0;
+    size_t requeued = 0;
+};
+
+// The crawler's loop for one site: pop, skip seen, "fetch", queue new links
+CrawlStats crawlSite(const Site& site, const std::string& dir, bool bestFirst, int budget) {
+    FrontierConfig config;
+    config.bestFirst = bestFirst;
+    PriorityFrontier frontier(dir, config);
+    std::vector<bool> seen(site.pages.size(), false);
+    frontier.push(site.pages[0].url, 0);
+
+    CrawlStats stats;
+    std::string url;
+    int depth = 0;
+    while (static_cast<int>(stats.fetched) < budget && frontier.pop(url, depth)) {
+        uint32_t id = site.byUrl.at(url);
+        if (seen[id]) continue;
+        seen[id] = true;
+        stats.fetched++;
+        const Page& page = site.pages[id];
+        if (page.kind == PAGE_ARTICLE) {
+            stats.articles++;
+            if (site.popular[id]) stats.popular++;
+        }
+        if (depth >= MAX_DEPTH) continue;
+        for (const Link& link : page.links) {
+            if (!seen[link.target]) frontier.push(site.pages[link.target].url, depth + 1, link.flags);
+        }
+        frontier.flush();
+    }
+    stats.requeued = frontier.requeuedCount();
+    return stats;
+}
+
+int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return std::remove(path);
+}
+
+void removeTree(const std::string& dir) {
+    nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t urlCount = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    int siteCount = argc > 2 ? std::stoi(argv[2]) : 4;
+    size_t articles = argc > 3 ? std::stoul(argv[3]) : 4000;
+    std::string root = "/tmp/frontier_bench." + std::to_string(getpid());
+
+    // Push and pop throughput with every URL queued at once
+    std::vector<std::string> urls;
+    std::vector<int> flags;
+    std::mt19937_64 rng(7);
+    for (size_t i = 0; i < urlCount; i++) {
+        urls.push_back("https://bench.example/news/" + std::string(SECTIONS[rng() % SECTION_COUNT]) + "/2024/" +
+                       WORDS[rng() % 16] + "-" + WORDS[rng() % 16] + "-" + std::to_string(i) +
+                       (rng() % 8 == 0 ? "?page=2" : ""));
+        flags.push_back(static_cast<int>(rng() % 4));
+    }
+    std::cout << std::left << std::setw(12) << "frontier" << std::right << std::setw(12) << "URLs"
+              << std::setw(14) << "push ns/op" << std::setw(14) << "pop ns/op" << std::setw(14) << "disk MB"
+              << std::endl;
+    for (bool bestFirst : {false, true}) {
+        std::string dir = root + (bestFirst ? "/best" : "/bfs");
+        FrontierConfig config;
+        config.bestFirst = bestFirst;
+        PriorityFrontier frontier(dir, config);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < urlCount; i++) {
+            frontier.push(urls[i], static_cast<int>(i % 4), flags[i]);
+            if (i % 64 == 63) frontier.flush();  // about one page of links
+        }
+        frontier.flush();
+        double pushNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        double diskMb = frontier.queuedBytes() / 1e6;
+        start = std::chrono::steady_clock::now();
+        std::string url;
+        int depth;
+        size_t popped = 0;
+        while (frontier.pop(url, depth)) popped++;
+        double popNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::left << std::setw(12) << (bestFirst ? "best-first" : "BFS") << std::right
+                  << std::setw(12) << popped << std::fixed << std::setprecision(0) << std::setw(14)
+                  << pushNs / urlCount << std::setw(14) << popNs / std::max<size_t>(popped, 1) << std::setw(14)
+                  << std::setprecision(1) << diskMb << std::endl;
+        removeTree(dir);
+    }
+
+    // Simulated crawls: useful pages per fetch for the same budget
+    std::vector<Site> sites;
+    size_t pageTotal = 0;
+    for (int s = 0; s < siteCount; s++) {
+        sites.push_back(makeSite(s, articles));
+        pageTotal += sites.back().pages.size();
+    }
+    std::cout << "\nSimulated crawl: " << siteCount << " sites, " << pageTotal << " pages (" << articles
+              << " articles per site), max depth " << MAX_DEPTH << std::endl;
+    std::cout << std::left << std::setw(8) << "budget" << std::setw(12) << "frontier" << std::right
+              << std::setw(10) << "fetched" << std::setw(11) << "articles" << std::setw(11) << "per fetch"
+              << std::setw(10) << "popular" << std::setw(11) << "requeued" << std::endl;
+    for (int budget : BUDGETS) {
+        for (bool bestFirst : {false, true}) {
+            CrawlStats total;
+            for (int s = 0; s < siteCount; s++) {
+                std::string dir = root + "/site" + std::to_string(s);
+                CrawlStats stats = crawlSite(sites[s], dir, bestFirst, budget);
+                removeTree(dir);
+                total.fetched += stats.fetched;
+                total.articles += stats.articles;
+                total.popular += stats.popular;
+                total.requeued += stats.requeued;
+            }
+            std::cout << std::left << std::setw(8) << budget << std::setw(12)
+                      << (bestFirst ? "best-first" : "BFS") << std::right << std::setw(10) << total.fetched
+                      << std::setw(11) << total.articles << std::fixed << std::setprecision(2) << std::setw(11)
+                      << static_cast<double>(total.articles) / std::max<size_t>(total.fetched, 1)
+                      << std::setw(10) << total.popular << std::setw(11) << total.requeued << std::endl;
+        }
+    }
+    removeTree(root);
+    return 0;
+}
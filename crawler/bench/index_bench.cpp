@@ -0,0 +1,200 @@
+// Builds an index segment and compares block-max WAND top-k search with
+// scoring every posting (searchExhaustive), checking that both return the
+// same scores. The corpus is either a crawler database or synthetic pages
+// whose words follow a Zipf distribution.
+//
+//   ./index_bench [crawler_data.db | synthetic-page-count=200000] [k=10]
+
+#include <iomanip>
+#include <random>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "../index_segment.hpp"
+
+namespace {
+
+const size_t VOCABULARY = 50000;
+const int QUERIES = 200;
+
+std::string wordFor(size_t rank) {
+    std::string word = "w";
+    for (size_t r = rank; r > 0; r /= 26) word += static_cast<char>('a' + r % 26);
+    return word;
+}
+
+// Zipf(1) over the vocabulary, by inverting the cumulative weights
+class ZipfWords {
+public:
+    explicit ZipfWords(size_t n) : cumulative(n) {
+        double total = 0;
+        for (size_t i = 0; i < n; i++) cumulative[i] = total += 1.0 / (i + 1);
+        for (auto& c : cumulative) c /= total;
+    }
+
+    size_t next(std::mt19937_64& rng) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return std::lower_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+    }
+
+private:
+    std::vector<double> cumulative;
+};
+
+std::string sentence(ZipfWords& zipf, std::mt19937_64& rng, size_t words) {
+    std::string text;
+    for (size_t i = 0; i < words; i++) {
+        if (i) text += ' ';
+        text += wordFor(zipf.next(rng));
+    }
+    return text;
+}
+
+void buildSynthetic(IndexSegmentWriter& writer, size_t pages) {
+    std::mt19937_64 rng(42);
+    ZipfWords zipf(VOCABULARY);
+    for (size_t i = 0; i < pages; i++) {
+        std::string url = "https://bench.example/" + std::to_string(i);
+        writer.addDocument(static_cast<int64_t>(i + 1), url, sentence(zipf, rng, 4 + rng() % 8),
+                           sentence(zipf, rng, 10 + rng() % 20), sentence(zipf, rng, 100 + rng() % 300));
+    }
+}
+
+void buildFromDb(IndexSegmentWriter& writer, const std::string& path, std::vector<std::string>& titles) {
+    sqlite3* db;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open database: " << path << std::endl;
+        sqlite3_close(db);
+        return;
+    }
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, url, title, description, content FROM pages ORDER BY id", -1, &stmt, 0) ==
+        SQLITE_OK) {
+        auto text = [stmt](int column) {
+            const unsigned char* value = sqlite3_column_text(stmt, column);
+            return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+        };
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            std::string title = text(2);
+            writer.addDocument(sqlite3_column_int64(stmt, 0), text(1), title, text(3), text(4));
+            titles.push_back(std::move(title));
+        }
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db);
+}
+
+// Two to four terms from a mix of frequent and rarer words, sometimes with
+// a quoted pair
+std::vector<std::string> makeQueries(std::mt19937_64& rng) {
+    std::vector<std::string> queries;
+    for (int q = 0; q < QUERIES; q++) {
+        std::string query;
+        size_t terms = 2 + rng() % 3;
+        for (size_t t = 0; t < terms; t++) {
+            size_t rank = t == 0 ? rng() % 50 : 50 + rng() % 5000;
+            query += wordFor(rank) + " ";
+        }
+        if (q % 10 == 0) query += "\"" + wordFor(rng() % 20) + " " + wordFor(rng() % 20) + "\"";
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+// Two or three words of a stored title, so queries over real pages match
+std::vector<std::string> titleQueries(const std::vector<std::string>& titles, std::mt19937_64& rng) {
+    std::vector<std::string> queries;
+    std::string term;
+    for (int q = 0; q < QUERIES && !titles.empty(); q++) {
+        std::vector<std::string> words;
+        Tokenizer tokenizer(titles[rng() % titles.size()]);
+        while (tokenizer.next(term)) words.push_back(term);
+        if (words.empty()) continue;
+        std::string query;
+        for (size_t t = 2 + rng() % 2; t > 0; t--) query += words[rng() % words.size()] + " ";
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+struct Latency {
+    double mean = 0;
+    double p99 = 0;
+};
+
+Latency summarize(std::vector<double>& micros) {
+    Latency latency;
+    if (micros.empty()) return latency;
+    for (double m : micros) latency.mean += m;
+    latency.mean /= micros.size();
+    std::sort(micros.begin(), micros.end());
+    latency.p99 = micros[std::min(micros.size() - 1, micros.size() * 99 / 100)];
+    return latency;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string source = argc > 1 ? argv[1] : "200000";
+    size_t k = argc > 2 ? std::stoul(argv[2]) : 10;
+    bool synthetic = !source.empty() && source.find_first_not_of("0123456789") == std::string::npos;
+
+    IndexSegmentWriter writer;
+    std::vector<std::string> titles;
+    auto start = std::chrono::steady_clock::now();
+    if (synthetic) buildSynthetic(writer, std::stoul(source));
+    else buildFromDb(writer, source, titles);
+    if (writer.documentCount() == 0) {
+        std::cerr << "No pages to index" << std::endl;
+        return 1;
+    }
+    std::string path = "/tmp/index_bench." + std::to_string(getpid()) + ".idx";
+    if (!writer.write(path)) return 1;
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    IndexSegment segment(path);
+    std::remove(path.c_str());
+    if (!segment.ok()) return 1;
+    std::cout << "Segment: " << segment.documentCount() << " docs, " << segment.termCount() << " terms, "
+              << segment.fileSize() / 1024 << " KiB, built in " << std::fixed << std::setprecision(2)
+              << buildSeconds << "s" << std::endl;
+
+    std::mt19937_64 rng(7);
+    std::vector<std::string> queries = synthetic ? makeQueries(rng) : titleQueries(titles, rng);
+
+    std::vector<double> wandMicros, exhaustiveMicros;
+    SearchStats wandStats, exhaustiveStats;
+    size_t mismatches = 0, hitsTotal = 0;
+    for (const auto& query : queries) {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<SearchHit> wand = segment.search(query, k, &wandStats);
+        auto t1 = std::chrono::steady_clock::now();
+        std::vector<SearchHit> exhaustive = segment.searchExhaustive(query, k, &exhaustiveStats);
+        auto t2 = std::chrono::steady_clock::now();
+        wandMicros.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        exhaustiveMicros.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+
+        // Ties at the cut-off may pick different documents; scores must agree
+        bool same = wand.size() == exhaustive.size();
+        for (size_t i = 0; same && i < wand.size(); i++) same = wand[i].score == exhaustive[i].score;
+        if (!same) mismatches++;
+        hitsTotal += wand.size();
+    }
+
+    Latency wand = summarize(wandMicros);
+    Latency exhaustive = summarize(exhaustiveMicros);
+    std::cout << std::left << std::setw(12) << "search" << std::right << std::setw(12) << "mean us" << std::setw(12)
+              << "p99 us" << std::setw(16) << "blocks/query" << std::setw(16) << "scored/query" << std::endl;
+    auto row = [&](const char* name, const Latency& latency, const SearchStats& stats) {
+        std::cout << std::left << std::setw(12) << name << std::right << std::setprecision(1) << std::setw(12)
+                  << latency.mean << std::setw(12) << latency.p99 << std::setw(16)
+                  << static_cast<double>(stats.blocksDecoded) / queries.size() << std::setw(16)
+                  << static_cast<double>(stats.documentsScored) / queries.size() << std::endl;
+    };
+    row("wand", wand, wandStats);
+    row("exhaustive", exhaustive, exhaustiveStats);
+    std::cout << queries.size() << " queries, k=" << k << ", " << hitsTotal << " hits, speedup "
+              << std::setprecision(1) << (wand.mean > 0 ? exhaustive.mean / wand.mean : 0) << "x, "
+              << mismatches << " top-k mismatches" << std::endl;
+    return mismatches ? 1 : 0;
+}
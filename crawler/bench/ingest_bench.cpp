@@ -0,0 +1,150 @@
+// Loads the same pages through DatabaseWriter twice, into fresh databases:
+// once with the FTS triggers updating pages_fts on every insert, and once
+// as a bulk load (triggers dropped, relaxed sync, large pages and mmap)
+// followed by one pages_fts rebuild + optimize. Reports the time of each
+// and checks that both full-text indexes answer queries alike.
+//
+//   ./ingest_bench [pages=20000] [content-bytes=2000]
+
+#include <iomanip>
+#include <random>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "../database.hpp"
+
+namespace {
+
+const size_t VOCABULARY = 30000;
+const size_t LINKS_PER_PAGE = 20;
+
+std::vector<std::string> makeVocabulary(std::mt19937_64& rng) {
+    std::vector<std::string> words;
+    for (size_t i = 0; i < VOCABULARY; i++) {
+        std::string word;
+        for (size_t n = 3 + rng() % 7; n > 0; n--) word += static_cast<char>('a' + rng() % 26);
+        words.push_back(word);
+    }
+    return words;
+}
+
+// Text of about `bytes` bytes, skewed towards the start of the vocabulary
+std::string text(const std::vector<std::string>& words, std::mt19937_64& rng, size_t bytes) {
+    std::string out;
+    while (out.size() < bytes) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        if (!out.empty()) out += ' ';
+        out += words[static_cast<size_t>(u * u * u * words.size())];
+    }
+    return out;
+}
+
+std::vector<PageData> makePages(size_t count, size_t contentBytes) {
+    std::mt19937_64 rng(42);
+    std::vector<std::string> words = makeVocabulary(rng);
+    std::vector<PageData> pages(count);
+    for (size_t i = 0; i < count; i++) {
+        PageData& page = pages[i];
+        page.url = "https://bench.example/page/" + std::to_string(i);
+        page.title = text(words, rng, 40);
+        page.description = text(words, rng, 150);
+        page.content = text(words, rng, contentBytes);
+        for (size_t l = 0; l < LINKS_PER_PAGE; l++) {
+            page.outgoingLinks.emplace_back("https://bench.example/page/" + std::to_string(rng() % (count * 4)));
+        }
+    }
+    return pages;
+}
+
+struct LoadResult {
+    double ingestSeconds = 0;
+    double ftsSeconds = 0;
+    std::vector<long long> matches;  // per probe query
+    bool ok = false;
+};
+
+long long countMatches(sqlite3* db, const std::string& query) {
+    sqlite3_stmt* stmt;
+    long long count = -1;
+    if (sqlite3_prepare_v2(db, "SELECT count(*) FROM pages_fts WHERE pages_fts MATCH ?", -1, &stmt, 0) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, query.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW) count = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return count;
+}
+
+LoadResult load(const std::vector<PageData>& pages, bool bulkLoad, const std::vector<std::string>& probes) {
+    LoadResult result;
+    std::string path = "/tmp/ingest_bench." + std::to_string(getpid()) + (bulkLoad ? ".bulk.db" : ".db");
+
+    std::streambuf* stdoutBuffer = std::cout.rdbuf();
+    std::ostringstream initLog;
+    std::cout.rdbuf(initLog.rdbuf());  // "Database initialized" noise
+    sqlite3* db = initDatabase(path.c_str(), bulkLoad);
+    std::cout.rdbuf(stdoutBuffer);
+    if (db && (!bulkLoad || beginBulkLoad(db))) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            WriterConfig config;
+            config.bulkLoad = bulkLoad;
+            DatabaseWriter writer(path, config);
+            for (const auto& page : pages) {
+                PageData copy = page;
+                writer.submit(std::move(copy));
+            }
+            writer.stop();
+        }
+        auto loaded = std::chrono::steady_clock::now();
+        result.ok = !bulkLoad || finishBulkLoad(db);
+        auto indexed = std::chrono::steady_clock::now();
+        result.ingestSeconds = std::chrono::duration<double>(loaded - start).count();
+        result.ftsSeconds = std::chrono::duration<double>(indexed - loaded).count();
+
+        result.ok = result.ok &&
+                    sqlite3_exec(db, "INSERT INTO pages_fts(pages_fts) VALUES ('integrity-check')", 0, 0, 0) == SQLITE_OK;
+        for (const auto& probe : probes) result.matches.push_back(countMatches(db, probe));
+    }
+    if (db) sqlite3_close(db);
+    for (const char* suffix : {"", "-wal", "-shm"}) std::remove((path + suffix).c_str());
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 20000;
+    size_t contentBytes = argc > 2 ? std::stoul(argv[2]) : 2000;
+
+    std::vector<PageData> pages = makePages(count, contentBytes);
+    std::vector<std::string> probes;
+    for (size_t i = 0; i < 20 && i < pages.size(); i++) {
+        const std::pmr::string& title = pages[i * pages.size() / 20].title;
+        probes.emplace_back(title.substr(0, title.find(' ')));
+    }
+
+    LoadResult triggers = load(pages, false, probes);
+    LoadResult bulk = load(pages, true, probes);
+    if (!triggers.ok || !bulk.ok) {
+        std::cerr << "Load failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << count << " pages, " << contentBytes << " content bytes each\n" << std::endl;
+    std::cout << std::left << std::setw(12) << "mode" << std::right << std::setw(12) << "ingest s" << std::setw(12)
+              << "fts s" << std::setw(12) << "total s" << std::setw(14) << "pages/sec" << std::endl;
+    auto row = [&](const char* name, const LoadResult& result) {
+        double total = result.ingestSeconds + result.ftsSeconds;
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << result.ingestSeconds << std::setw(12) << result.ftsSeconds << std::setw(12)
+                  << total << std::setw(14) << std::setprecision(0) << count / total << std::endl;
+    };
+    row("triggers", triggers);
+    row("bulk", bulk);
+
+    double speedup = (triggers.ingestSeconds + triggers.ftsSeconds) / (bulk.ingestSeconds + bulk.ftsSeconds);
+    bool same = triggers.matches == bulk.matches;
+    std::cout << "\nSpeedup: " << std::setprecision(2) << speedup << "x, " << probes.size() << " probe queries "
+              << (same ? "match" : "DIFFER") << std::endl;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+// Measures what logging costs the crawl loop: the AsyncLogger calls a
+// worker makes per page against the previous per-page ostringstream block
+// (written under a mutex and flushed), and the CPU time of info-level
+// logging as a share of parsing a corpus page.
+//
+//   ./log_bench [corpus-dir | crawler_data.db] [rounds=200] [threads=4]
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <sys/resource.h>
+
+#include "bench_util.hpp"
+#include "../html_parser.hpp"
+#include "../logger.hpp"
+#include "../page_arena.hpp"
+
+namespace {
+
+const int BATCH = 4096;  // calls between flushes (below the ring size, so nothing is dropped)
+
+std::ofstream legacyOut("/dev/null");
+std::mutex legacyMutex;
+
+// The log block each page produced before (see crawlNextPage)
+void legacyLogPage(int count, int maxPages, int depth, const std::string& url, const PageData& data) {
+    std::ostringstream log;
+    log << "Crawling [" << count << "/" << maxPages << "] (depth: " << depth << "): " << url << "\n";
+    log << "  - Title: \"" << data.title << "\"\n";
+    log << "  - Content length: " << data.content.length() << " chars\n";
+    log << "  - Content preview: \"" << data.content.substr(0, std::min((size_t)100, data.content.length()))
+        << "...\"\n";
+    log << "  - Discovered URLs: " << data.outgoingLinks.size() << "\n";
+    log << "  ✓ Queued for saving\n";
+    log << "  - Images: " << data.images.size() << "\n";
+    std::lock_guard<std::mutex> lock(legacyMutex);
+    legacyOut << log.str() << std::flush;
+}
+
+// The calls crawlNextPage makes now for a saved page
+void asyncLogPage(AsyncLogger& logger, int count, int maxPages, int depth, const std::string& url,
+                  const PageData& data) {
+    logger.debug("  {} title: \"{}\", content: {} chars, discovered URLs: {}, preview: \"{}...\"", url, data.title,
+                 data.content.length(), data.outgoingLinks.size(), std::string_view(data.content).substr(0, 100));
+    logger.info("[{}/{}] (depth: {}) {} ✓ {} ({} chars, {} links, {} images)", count, maxPages, depth, url,
+                "Queued for saving", data.content.length(), data.outgoingLinks.size(), data.images.size());
+}
+
+LoggerConfig benchConfig(FILE* devNull, LogLevel level) {
+    LoggerConfig config;
+    config.level = level;
+    config.capacity = 1 << 16;
+    config.out = devNull;
+    config.errorOut = devNull;
+    return config;
+}
+
+// Mean ns per logPage() call from `threads` threads, timing batches only
+// (flushes in between are not counted)
+template <typename LogPage>
+double nsPerCall(int threads, int batches, const std::vector<CorpusPage>& corpus, const std::vector<PageData>& pages,
+                 LogPage logPage, AsyncLogger* logger) {
+    double totalNs = 0;
+    for (int b = 0; b < batches; b++) {
+        std::vector<double> ns(threads);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                ns[t] = timeNsPerOp(BATCH / threads, [&, i = 0]() mutable {
+                    size_t page = i++ % pages.size();
+                    logPage(i, 100, 2, corpus[page].url, pages[page]);
+                });
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        for (double n : ns) totalNs += n;
+        if (logger) logger->flush();
+    }
+    return totalNs / (threads * batches);
+}
+
+double cpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string source = argc > 1 ? argv[1] : BENCH_CORPUS_DIR;
+    int rounds = argc > 2 ? std::stoi(argv[2]) : 200;
+    int threads = argc > 3 ? std::stoi(argv[3]) : 4;
+
+    std::vector<CorpusPage> corpus = loadCorpus(source);
+    if (corpus.empty()) {
+        std::cerr << "No pages found in " << source << std::endl;
+        return 1;
+    }
+    std::vector<PageData> pages;
+    std::vector<BodyBuffer> bodies;  // as handed over by the fetch engine
+    for (const auto& page : corpus) {
+        pages.push_back(parseHTML(page.html, page.url));
+        bodies.push_back(makeBodyBuffer(page.html));
+    }
+    FILE* devNull = std::fopen("/dev/null", "w");
+
+    // Caller-side cost per page
+    std::cout << std::left << std::setw(34) << "per-page logging" << std::right << std::setw(12) << "1 thread"
+              << std::setw(10) << threads << " threads" << std::endl;
+    auto row = [&](const char* name, double single, double multi) {
+        std::cout << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(9) << single << " ns" << std::setw(15) << multi << " ns" << std::endl;
+    };
+    int batches = 20;
+    row("ostringstream + mutex + flush", nsPerCall(1, batches, corpus, pages, legacyLogPage, nullptr),
+        nsPerCall(threads, batches, corpus, pages, legacyLogPage, nullptr));
+    size_t dropped = 0;
+    for (LogLevel level : {LOG_INFO, LOG_DEBUG, LOG_WARN}) {
+        AsyncLogger logger(benchConfig(devNull, level));
+        auto logPage = [&](int count, int maxPages, int depth, const std::string& url, const PageData& data) {
+            asyncLogPage(logger, count, maxPages, depth, url, data);
+        };
+        double single = nsPerCall(1, batches, corpus, pages, logPage, &logger);
+        double multi = nsPerCall(threads, batches, corpus, pages, logPage, &logger);
+        std::string name = std::string("AsyncLogger, level ") + logLevelName(level);
+        row(name.c_str(), single, multi);
+        logger.stop();
+        dropped += logger.droppedCount();
+    }
+
+    // Share of per-page time. Logging is charged its whole CPU cost (the
+    // call plus formatting and writing on the drain thread), measured as
+    // process CPU time, since wall time would also count the drain thread's
+    // idle sleeps.
+    AsyncLogger logger(benchConfig(devNull, LOG_INFO));
+    int lines = batches * BATCH;
+    double cpuStart = cpuSeconds();
+    for (int b = 0; b < batches; b++) {
+        for (int i = 0; i < BATCH; i++) {
+            size_t page = static_cast<size_t>(i) % pages.size();
+            asyncLogPage(logger, i, 100, 2, corpus[page].url, pages[page]);
+        }
+        logger.flush();
+    }
+    double logNs = (cpuSeconds() - cpuStart) * 1e9 / lines;
+    logger.stop();
+    dropped += logger.droppedCount();
+
+    PageArena arena;
+    ParseOptions options;
+    options.arena = &arena;
+    double parseNs = 0;
+    for (size_t p = 0; p < corpus.size(); p++) {
+        parseNs += timeNsPerOp(rounds, [&]() {
+            arena.reset();
+            doNotOptimize(parseHTML(bodies[p], corpus[p].url, options));
+        });
+    }
+    parseNs /= corpus.size();
+
+    std::cout << "\nInfo logging, CPU per page (call + drain thread): " << std::fixed << std::setprecision(0) << logNs
+              << " ns" << std::endl;
+    std::cout << "Parsing, mean per page (" << corpus.size() << " pages x " << rounds << "): " << std::setprecision(1)
+              << parseNs / 1000 << " us" << std::endl;
+    std::cout << "Logging share of parse time: " << std::setprecision(2) << logNs / parseNs * 100
+              << "% (a fetched page also spends its download, so less of the whole page)" << std::endl;
+    std::cout << "Lines written: " << logger.writtenCount() << ", dropped (all runs): " << dropped << std::endl;
+    std::fclose(devNull);
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Builds a synthetic link graph shaped like a crawl (most links stay near
+// their page, the rest point at a few popular pages far more often than at
+// others), then runs PageRank on it with 1, 2, 4, ... threads. Reports the
+// CSR build time, iterations, time and edges/sec per run, and checks that
+// every thread count gives exactly the ranks of the single-threaded run.
+//
+//   ./pagerank_bench [pages=2000000] [links-per-page=16] [max-threads=hardware]
+
+#include <iomanip>
+#include <random>
+#include <thread>
+
+#include "bench_util.hpp"
+#include "../pagerank.hpp"
+
+namespace {
+
+const size_t LOCAL_SPAN = 2000;   // "same site" links land this close to their page
+const double LOCAL_SHARE = 0.6;
+
+std::vector<LinkEdge> makeEdges(size_t pages, size_t linksPerPage) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<LinkEdge> edges;
+    edges.reserve(pages * linksPerPage);
+    for (size_t source = 0; source < pages; source++) {
+        // Out-degrees vary from 1 to 2 * linksPerPage - 1
+        size_t links = 1 + rng() % (2 * linksPerPage - 1);
+        for (size_t l = 0; l < links; l++) {
+            size_t target;
+            if (uniform(rng) < LOCAL_SHARE) {
+                size_t low = source > LOCAL_SPAN / 2 ? source - LOCAL_SPAN / 2 : 0;
+                target = std::min(pages - 1, low + rng() % LOCAL_SPAN);
+            } else {
+                double u = uniform(rng);
+                target = static_cast<size_t>(u * u * u * u * pages);  // popular pages have low numbers
+            }
+            edges.push_back({static_cast<uint32_t>(source), static_cast<uint32_t>(target)});
+        }
+    }
+    return edges;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t pages = argc > 1 ? std::stoul(argv[1]) : 2000000;
+    size_t linksPerPage = argc > 2 ? std::stoul(argv[2]) : 16;
+    unsigned maxThreads = argc > 3 ? static_cast<unsigned>(std::stoul(argv[3]))
+                                   : std::max(1u, std::thread::hardware_concurrency());
+    if (pages == 0 || linksPerPage == 0) {
+        std::cerr << "Need at least one page and one link per page" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<LinkEdge> edges = makeEdges(pages, linksPerPage);
+    double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    LinkGraph graph;
+    buildLinkGraph(graph, pages, edges, maxThreads);
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t generated = edges.size();
+    edges = {};
+
+    std::cout << "Graph: " << graph.nodeCount() << " pages, " << graph.edgeCount() << " links (" << generated
+              << " generated in " << std::fixed << std::setprecision(2) << generateSeconds << "s), CSR built in "
+              << buildSeconds << "s with " << maxThreads << " threads\n" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "iterations" << std::setw(10) << "s" << std::setw(16)
+              << "edges/sec" << std::setw(10) << "speedup" << std::setw(10) << "ranks" << std::endl;
+
+    PageRankResult reference;
+    double singleSeconds = 0;
+    bool allSame = true;
+    for (unsigned threads = 1;; threads = std::min(maxThreads, threads * 2)) {
+        PageRankOptions options;
+        options.threads = threads;
+        start = std::chrono::steady_clock::now();
+        PageRankResult result = computePageRank(graph, options);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (threads == 1) {
+            reference = result;
+            singleSeconds = seconds;
+        }
+        bool same = result.rank == reference.rank && result.iterations == reference.iterations;
+        allSame = allSame && same;
+
+        std::cout << std::setw(8) << threads << std::setw(12) << result.iterations << std::setw(10)
+                  << std::setprecision(2) << seconds << std::setw(16) << std::setprecision(0)
+                  << graph.edgeCount() * static_cast<double>(result.iterations) / seconds << std::setw(9)
+                  << std::setprecision(2) << singleSeconds / seconds << "x" << std::setw(10)
+                  << (same ? "same" : "DIFFER") << std::endl;
+        if (threads >= maxThreads) break;
+    }
+
+    double sum = 0;
+    for (double r : reference.rank) sum += r;
+    std::cout << "\n" << (reference.converged ? "Converged" : "Stopped at the iteration limit") << " (L1 change "
+              << std::scientific << std::setprecision(1) << reference.change << "), ranks sum to " << std::fixed
+              << std::setprecision(9) << sum << std::endl;
+    return allSame ? 0 : 1;
+}
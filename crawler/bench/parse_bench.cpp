@@ -0,0 +1,184 @@
+// Compares parseHTML against the previous extraction (two gumbo_parse calls
+// plus one searchForTag walk per tag) on a corpus of saved pages.
+//
+//   ./parse_bench [corpus-dir | crawler_data.db] [iterations=200]
+
+#include <iomanip>
+#include <regex>
+#include <set>
+
+#include "bench_util.hpp"
+#include "../html_parser.hpp"
+
+namespace legacy {
+
+void searchForTag(GumboNode* node, GumboTag tag, std::vector<GumboNode*>& results) {
+    if (node->type != GUMBO_NODE_ELEMENT) return;
+    if (node->v.element.tag == tag) results.push_back(node);
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        searchForTag(static_cast<GumboNode*>(children->data[i]), tag, results);
+    }
+}
+
+std::string domainOf(const std::string& url) {
+    size_t pos = url.find("://");
+    size_t domainEnd = url.find('/', pos + 3);
+    return (domainEnd != std::string::npos) ? url.substr(0, domainEnd) : url;
+}
+
+std::vector<std::string> extractLinks(const std::string& html, const std::string& baseUrl) {
+    std::vector<std::string> links;
+    std::set<std::string> uniqueLinks;
+    GumboOutput* output = gumbo_parse(html.c_str());
+    std::vector<GumboNode*> anchorNodes;
+    searchForTag(output->root, GUMBO_TAG_A, anchorNodes);
+    for (GumboNode* node : anchorNodes) {
+        std::string href = getAttribute(node, "href");
+        if (href.empty() || href[0] == '#' || href.find("mailto:") == 0 ||
+            href.find("javascript:") == 0 || href.find("tel:") == 0) continue;
+        if (href[0] == '/' && href[1] != '/') href = domainOf(baseUrl) + href;
+        else if (href.find("//") == 0) href = baseUrl.substr(0, baseUrl.find("://")) + ":" + href;
+        else if (href.find("http") != 0) continue;
+        if (uniqueLinks.insert(href).second) links.push_back(href);
+    }
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    return links;
+}
+
+PageData parseHTML(const std::string& html, const std::string& url) {
+    PageData data;
+    data.url = url;
+    data.rawHtml = makeBodyBuffer(html);  // the old path copied the body
+    GumboOutput* output = gumbo_parse(html.c_str());
+
+    std::vector<GumboNode*> titleNodes;
+    searchForTag(output->root, GUMBO_TAG_TITLE, titleNodes);
+    if (!titleNodes.empty()) {
+        std::string title;
+        extractText(titleNodes[0], title);
+        data.title = title;
+    }
+
+    std::vector<GumboNode*> metaNodes;
+    searchForTag(output->root, GUMBO_TAG_META, metaNodes);
+    for (GumboNode* node : metaNodes) {
+        if (getAttribute(node, "name") == "description" || getAttribute(node, "property") == "og:description") {
+            data.description = getAttribute(node, "content");
+            if (!data.description.empty()) { data.content = data.description; break; }
+        }
+    }
+
+    std::vector<GumboNode*> linkNodes;
+    searchForTag(output->root, GUMBO_TAG_LINK, linkNodes);
+    for (GumboNode* node : linkNodes) {
+        if (getAttribute(node, "rel").find("icon") != std::string::npos) {
+            std::string href = getAttribute(node, "href");
+            if (!href.empty()) { data.favicon = href; break; }
+        }
+    }
+
+    for (GumboNode* node : metaNodes) {
+        if (getAttribute(node, "name") == "keywords") {
+            std::stringstream ss(getAttribute(node, "content"));
+            std::string tag;
+            while (std::getline(ss, tag, ',')) if (!tag.empty()) data.tags.emplace_back(tag);
+        }
+    }
+
+    std::vector<std::string> links = extractLinks(html, url);
+    data.outgoingLinks.assign(links.begin(), links.end());
+
+    if (data.content.empty()) {
+        std::vector<GumboNode*> contentNodes;
+        searchForTag(output->root, GUMBO_TAG_ARTICLE, contentNodes);
+        if (contentNodes.empty()) searchForTag(output->root, GUMBO_TAG_MAIN, contentNodes);
+        if (contentNodes.empty()) searchForTag(output->root, GUMBO_TAG_BODY, contentNodes);
+        if (!contentNodes.empty()) {
+            std::vector<GumboNode*> paragraphs;
+            searchForTag(contentNodes[0], GUMBO_TAG_P, paragraphs);
+            for (GumboNode* p : paragraphs) {
+                std::string paraText;
+                extractText(p, paraText);
+                if (paraText.length() < 50) continue;
+                data.content += paraText + " ";
+                if (data.content.length() > 500) break;
+            }
+            if (data.content.length() < 100) {
+                std::string content;
+                extractText(contentNodes[0], content);
+                data.content = content;
+            }
+            std::regex multiSpace("\\s+");
+            data.content = std::regex_replace(std::string(data.content), multiSpace, " ");
+            if (data.content.length() > 2000) data.content = data.content.substr(0, 2000) + "...";
+        }
+    }
+
+    std::vector<GumboNode*> contentNodes;
+    searchForTag(output->root, GUMBO_TAG_ARTICLE, contentNodes);
+    if (contentNodes.empty()) searchForTag(output->root, GUMBO_TAG_MAIN, contentNodes);
+    if (contentNodes.empty()) searchForTag(output->root, GUMBO_TAG_BODY, contentNodes);
+    if (!contentNodes.empty()) {
+        std::vector<GumboNode*> imgNodes;
+        std::set<std::string> seenImages;
+        searchForTag(contentNodes[0], GUMBO_TAG_IMG, imgNodes);
+        for (GumboNode* node : imgNodes) {
+            std::string src = getAttribute(node, "src");
+            if (src.empty()) continue;
+            if (src[0] == '/' && src[1] == '/') src = "https:" + src;
+            else if (src[0] == '/') src = domainOf(url) + src;
+            if (isValidImageUrl(src) && seenImages.insert(src).second) data.images.emplace_back(src);
+        }
+    }
+
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    return data;
+}
+
+} // namespace legacy
+
+int main(int argc, char** argv) {
+    std::string source = argc > 1 ? argv[1] : BENCH_CORPUS_DIR;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    std::vector<CorpusPage> corpus = loadCorpus(source);
+    if (corpus.empty()) {
+        std::cerr << "No pages found in " << source << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(28) << "page" << std::right
+              << std::setw(10) << "bytes" << std::setw(14) << "legacy us" << std::setw(14) << "single us"
+              << std::setw(10) << "speedup" << std::endl;
+
+    double legacyTotal = 0, singleTotal = 0;
+    size_t mismatches = 0;
+    for (const auto& page : corpus) {
+        double legacyNs = timeNsPerOp(iterations, [&]() { doNotOptimize(legacy::parseHTML(page.html, page.url)); });
+        BodyBuffer body = makeBodyBuffer(page.html);  // as handed over by the fetch engine
+        double singleNs = timeNsPerOp(iterations, [&]() { doNotOptimize(parseHTML(body, page.url)); });
+        legacyTotal += legacyNs;
+        singleTotal += singleNs;
+
+        // Sanity check: both extract the same links and images
+        PageData a = legacy::parseHTML(page.html, page.url);
+        PageData b = parseHTML(page.html, page.url);
+        if (a.outgoingLinks != b.outgoingLinks || a.images != b.images) mismatches++;
+
+        std::string name = page.name.size() > 27 ? page.name.substr(0, 24) + "..." : page.name;
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << page.html.size() << std::setw(14) << legacyNs / 1000
+                  << std::setw(14) << singleNs / 1000 << std::setw(9) << legacyNs / singleNs << "x" << std::endl;
+    }
+
+    std::cout << "\nPages: " << corpus.size() << ", iterations: " << iterations << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Mean per page: legacy " << legacyTotal / corpus.size() / 1000 << " us, single-pass "
+              << singleTotal / corpus.size() / 1000 << " us (" << std::setprecision(2)
+              << legacyTotal / singleTotal << "x)" << std::endl;
+    if (mismatches) {
+        std::cout << "Warning: " << mismatches << " page(s) extracted different links/images" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+// Measures robots.txt matching throughput: the compiled trie matcher against
+// the previous linear scan over std::set (which only understood a trailing
+// '*'). Uses a generated robots.txt in the style of a large site, or the
+// file given on the command line.
+//
+//   ./robots_bench [robots.txt] [urls=100000]
+
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "bench_util.hpp"
+#include "../robots.hpp"
+
+namespace legacy {
+
+struct RobotsRules {
+    std::set<std::string> disallowedPaths;
+    std::set<std::string> allowedPaths;
+};
+
+RobotsRules parse(const std::string& body) {
+    RobotsRules rules;
+    std::istringstream stream(body);
+    std::string line;
+    bool inOurSection = false;
+    while (std::getline(stream, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r\n"));
+        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+        if (line.empty() || line[0] == '#') continue;
+        if (line.find("User-agent:") == 0) {
+            std::string agent = line.substr(11);
+            agent.erase(0, agent.find_first_not_of(" \t"));
+            if (inOurSection) break;
+            if (agent == "*") inOurSection = true;
+            continue;
+        }
+        if (!inOurSection) continue;
+        if (line.find("Disallow:") == 0) {
+            std::string path = line.substr(9);
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) rules.disallowedPaths.insert(path);
+        }
+        if (line.find("Allow:") == 0) {
+            std::string path = line.substr(6);
+            path.erase(0, path.find_first_not_of(" \t"));
+            if (!path.empty()) rules.allowedPaths.insert(path);
+        }
+    }
+    return rules;
+}
+
+bool isAllowed(const std::string& url, const RobotsRules& rules) {
+    size_t pos = url.find("://");
+    if (pos == std::string::npos) return false;
+    size_t pathStart = url.find('/', pos + 3);
+    if (pathStart == std::string::npos) return true;
+    std::string path = url.substr(pathStart);
+
+    for (const auto& allowed : rules.allowedPaths) {
+        if (!allowed.empty() && allowed.back() == '*') {
+            std::string prefix = allowed.substr(0, allowed.length() - 1);
+            if (path.find(prefix) == 0) return true;
+        } else if (path.find(allowed) == 0) {
+            return true;
+        }
+    }
+    for (const auto& disallowed : rules.disallowedPaths) {
+        if (disallowed == "/") return false;
+        if (!disallowed.empty() && disallowed.back() == '*') {
+            std::string prefix = disallowed.substr(0, disallowed.length() - 1);
+            if (path.find(prefix) == 0) return false;
+        } else if (path == disallowed || (disallowed.back() == '/' && path.find(disallowed) == 0)) {
+            return false;
+        } else if (path.find(disallowed) == 0) {
+            size_t matchEnd = disallowed.length();
+            if (matchEnd == path.length() || path[matchEnd] == '/' || path[matchEnd] == '?') return false;
+        }
+    }
+    return true;
+}
+
+} // namespace legacy
+
+namespace {
+
+const char* SECTIONS[] = {"wiki", "w", "api", "trap", "Special", "User", "Talk", "search", "static", "media"};
+
+// A robots.txt shaped like a big site's: a few hundred prefixes, some
+// wildcard and end-anchored patterns, Allow exceptions
+std::string generateRobotsTxt(std::mt19937& rng) {
+    std::ostringstream out;
+    out << "User-agent: Googlebot\nDisallow: /nogoogle/\n\nUser-agent: *\n";
+    for (int i = 0; i < 300; i++) {
+        std::string section = SECTIONS[rng() % 10];
+        switch (rng() % 6) {
+        case 0: out << "Disallow: /" << section << "/*?action=" << i << "\n"; break;
+        case 1: out << "Disallow: /*." << section << i << "$\n"; break;
+        case 2: out << "Allow: /" << section << "/public" << i << "/\n"; break;
+        default: out << "Disallow: /" << section << "/" << section << "_" << i << "\n"; break;
+        }
+    }
+    out << "Disallow: /w/\nAllow: /w/load.php\n";
+    return out.str();
+}
+
+std::vector<std::string> generateUrls(std::mt19937& rng, size_t count) {
+    std::vector<std::string> urls;
+    urls.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string section = SECTIONS[rng() % 10];
+        std::string url = "https://bench.example/" + section + "/";
+        switch (rng() % 4) {
+        case 0: url += section + "_" + std::to_string(rng() % 400); break;
+        case 1: url += "public" + std::to_string(rng() % 400) + "/page"; break;
+        case 2: url += "Article_" + std::to_string(rng()) + "?action=" + std::to_string(rng() % 400); break;
+        default: url += "Some_long_article_title_" + std::to_string(rng()); break;
+        }
+        urls.push_back(url);
+    }
+    return urls;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(42);
+    std::string body;
+    if (argc > 1) {
+        std::ifstream in(argv[1], std::ios::binary);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        body = ss.str();
+    } else {
+        body = generateRobotsTxt(rng);
+    }
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 100000;
+    std::vector<std::string> urls = generateUrls(rng, count);
+
+    double parseNs = timeNsPerOp(200, [&]() { doNotOptimize(parseRobotsTxt(body, "CustomSearchBot")); });
+    RobotsRules compiled = parseRobotsTxt(body, "CustomSearchBot");
+    legacy::RobotsRules old = legacy::parse(body);
+
+    size_t allowedCompiled = 0, allowedLegacy = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& url : urls) allowedLegacy += legacy::isAllowed(url, old);
+    double legacySec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (const auto& url : urls) allowedCompiled += isAllowedByRobots(url, compiled);
+    double compiledSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Rules: " << compiled.matcher.disallowCount() << " disallow, " << compiled.matcher.allowCount()
+              << " allow; parse+compile " << std::fixed << std::setprecision(1) << parseNs / 1000 << " us" << std::endl;
+    std::cout << "URLs: " << urls.size() << std::endl;
+    std::cout << std::setprecision(0) << "legacy:   " << std::setw(12) << urls.size() / legacySec << " matches/sec ("
+              << allowedLegacy << " allowed)" << std::endl;
+    std::cout << "compiled: " << std::setw(12) << urls.size() / compiledSec << " matches/sec (" << allowedCompiled
+              << " allowed)" << std::endl;
+    std::cout << std::setprecision(2) << "Speedup: " << legacySec / compiledSec << "x" << std::endl;
+    std::cout << "(allowed counts differ where the legacy matcher ignored '*' inside patterns and '$')" << std::endl;
+    return 0;
+}
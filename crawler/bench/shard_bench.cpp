@@ -0,0 +1,202 @@
+// Compares one crawler database writer against a sharded load: the same
+// pages, spread over 64 sites, are written either by one DatabaseWriter
+// with the FTS triggers on (an unsharded crawl), or split by shardOf() into
+// S bulk-loading writers running side by side (one per shard process in a
+// sharded crawl) and then combined with mergeShards(). Checks that both
+// databases hold the same pages and answer the same full-text queries.
+//
+//   ./shard_bench [pages=20000] [shards=4] [content-bytes=2000]
+
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+#include "bench_util.hpp"
+#include "../database.hpp"
+#include "../shard.hpp"
+
+namespace {
+
+const size_t VOCABULARY = 30000;
+const size_t LINKS_PER_PAGE = 20;
+const size_t SITES = 64;
+
+std::vector<std::string> makeVocabulary(std::mt19937_64& rng) {
+    std::vector<std::string> words;
+    for (size_t i = 0; i < VOCABULARY; i++) {
+        std::string word;
+        for (size_t n = 3 + rng() % 7; n > 0; n--) word += static_cast<char>('a' + rng() % 26);
+        words.push_back(word);
+    }
+    return words;
+}
+
+// Text of about `bytes` bytes, skewed towards the start of the vocabulary
+std::string text(const std::vector<std::string>& words, std::mt19937_64& rng, size_t bytes) {
+    std::string out;
+    while (out.size() < bytes) {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        if (!out.empty()) out += ' ';
+        out += words[static_cast<size_t>(u * u * u * words.size())];
+    }
+    return out;
+}
+
+std::string pageUrl(size_t i) {
+    return "https://site" + std::to_string(i % SITES) + ".example/page/" + std::to_string(i);
+}
+
+std::vector<PageData> makePages(size_t count, size_t contentBytes) {
+    std::mt19937_64 rng(42);
+    std::vector<std::string> words = makeVocabulary(rng);
+    std::vector<PageData> pages(count);
+    for (size_t i = 0; i < count; i++) {
+        PageData& page = pages[i];
+        page.url = pageUrl(i);
+        page.title = text(words, rng, 40);
+        page.description = text(words, rng, 150);
+        page.content = text(words, rng, contentBytes);
+        for (size_t l = 0; l < LINKS_PER_PAGE; l++) page.outgoingLinks.emplace_back(pageUrl(rng() % (count * 4)));
+    }
+    return pages;
+}
+
+std::string tempPath(const std::string& name) {
+    return "/tmp/shard_bench." + std::to_string(getpid()) + "." + name + ".db";
+}
+
+void removeDatabase(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm"}) std::remove((path + suffix).c_str());
+}
+
+// Write pages through one DatabaseWriter; returns false on error
+bool write(const std::string& path, const std::vector<const PageData*>& pages, bool bulkLoad) {
+    sqlite3* db = initDatabase(path.c_str(), bulkLoad);
+    bool ok = db && (!bulkLoad || beginBulkLoad(db));
+    if (ok) {
+        WriterConfig config;
+        config.bulkLoad = bulkLoad;
+        DatabaseWriter writer(path, config);
+        ok = writer.ok();
+        for (const PageData* page : pages) {
+            PageData copy = *page;
+            writer.submit(std::move(copy));
+        }
+        writer.stop();
+    }
+    if (db) sqlite3_close(db);
+    return ok;
+}
+
+long long queryInt(sqlite3* db, const std::string& sql, const std::string& text = "") {
+    sqlite3_stmt* stmt;
+    long long value = -1;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, 0) == SQLITE_OK) {
+        if (!text.empty()) sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+// Page, link and per-probe match counts of a finished database
+std::vector<long long> summarize(const std::string& path, const std::vector<std::string>& probes) {
+    std::vector<long long> counts;
+    sqlite3* db;
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+        counts.push_back(queryInt(db, "SELECT count(*) FROM pages"));
+        counts.push_back(queryInt(db, "SELECT count(*) FROM links"));
+        for (const auto& probe : probes) {
+            counts.push_back(queryInt(db, "SELECT count(*) FROM pages_fts WHERE pages_fts MATCH ?", probe));
+        }
+    }
+    sqlite3_close(db);
+    return counts;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 20000;
+    int shards = argc > 2 ? std::stoi(argv[2]) : 4;
+    size_t contentBytes = argc > 3 ? std::stoul(argv[3]) : 2000;
+
+    std::vector<PageData> pages = makePages(count, contentBytes);
+    std::vector<std::string> probes;
+    for (size_t i = 0; i < 20 && i < pages.size(); i++) {
+        const std::pmr::string& title = pages[i * pages.size() / 20].title;
+        probes.emplace_back(title.substr(0, title.find(' ')));
+    }
+
+    // Loads run with stdout silenced ("Database initialized" noise); the
+    // shard writers open their databases on their own threads
+    std::streambuf* stdoutBuffer = std::cout.rdbuf();
+    std::ostringstream initLog;
+    std::cout.rdbuf(initLog.rdbuf());
+
+    // One writer, FTS kept up to date by the triggers
+    std::string single = tempPath("single");
+    std::vector<const PageData*> all;
+    for (const auto& page : pages) all.push_back(&page);
+    auto start = std::chrono::steady_clock::now();
+    bool ok = write(single, all, false);
+    double singleSeconds = secondsSince(start);
+
+    // S bulk-loading writers side by side, then one merge
+    std::vector<std::vector<const PageData*>> parts(shards);
+    for (const auto& page : pages) parts[shardOf(std::string(page.url), shards)].push_back(&page);
+    std::vector<std::string> inputs;
+    for (int i = 0; i < shards; i++) inputs.push_back(tempPath("shard-" + std::to_string(i)));
+    std::vector<char> written(shards, 0);
+    start = std::chrono::steady_clock::now();
+    std::vector<std::thread> writers;
+    for (int i = 0; i < shards; i++) {
+        writers.emplace_back([&, i]() { written[i] = write(inputs[i], parts[i], true); });
+    }
+    for (auto& thread : writers) thread.join();
+    double shardSeconds = secondsSince(start);
+    for (char shardOk : written) ok = ok && shardOk;
+
+    std::string merged = tempPath("merged");
+    MergeStats stats;
+    ok = ok && mergeShards(inputs, merged, stats);
+    std::cout.rdbuf(stdoutBuffer);
+
+    std::vector<long long> singleCounts = summarize(single, probes);
+    std::vector<long long> mergedCounts = summarize(merged, probes);
+    for (const auto& path : inputs) removeDatabase(path);
+    removeDatabase(single);
+    removeDatabase(merged);
+    if (!ok) {
+        std::cerr << "Load failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << count << " pages on " << SITES << " sites, " << contentBytes << " content bytes each, " << shards
+              << " shards of ";
+    for (int i = 0; i < shards; i++) std::cout << (i ? "/" : "") << parts[i].size();
+    std::cout << " pages\n" << std::endl;
+    std::cout << std::left << std::setw(22) << "stage" << std::right << std::setw(12) << "seconds" << std::setw(14)
+              << "pages/sec" << std::endl;
+    auto row = [&](const char* name, double seconds) {
+        std::cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << seconds << std::setw(14) << std::setprecision(0) << count / seconds << std::endl;
+    };
+    double shardedTotal = shardSeconds + stats.copySeconds + stats.ftsSeconds;
+    row("single writer", singleSeconds);
+    row("shard writers", shardSeconds);
+    row("merge copy", stats.copySeconds);
+    row("merge FTS build", stats.ftsSeconds);
+    row("sharded total", shardedTotal);
+
+    bool same = singleCounts == mergedCounts && !singleCounts.empty();
+    std::cout << "\nSpeedup: " << std::setprecision(2) << singleSeconds / shardedTotal << "x on "
+              << std::thread::hardware_concurrency() << " cores, pages, links and " << probes.size()
+              << " probe queries " << (same ? "match" : "DIFFER") << std::endl;
+    return same ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Measures sitemap ingestion: SitemapParser throughput on a plain and a
+// gzipped sitemap of 50,000 entries (the protocol's maximum), fed in
+// download-sized chunks, and how peak RSS grows while sitemaps of 1k to
+// 500k entries are streamed through it. A sitemap kept as a response body
+// would hold all of its bytes; the parser only holds the current entry.
+//
+//   ./sitemap_bench [rounds=20] [chunk-bytes=16384]
+
+#include <iomanip>
+#include <sys/resource.h>
+#include <zlib.h>
+
+#include "bench_util.hpp"
+#include "../sitemap.hpp"
+
+namespace {
+
+const size_t ENTRIES = 50000;
+
+std::string entry(size_t i) {
+    return "  <url>\n    <loc>https://news.example/world/2024/05/a-long-story-about-something-" + std::to_string(i) +
+           "</loc>\n    <lastmod>2024-05-" + std::to_string(10 + i % 20) + "T08:30:00+00:00</lastmod>\n  </url>\n";
+}
+
+const char* const HEAD =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<urlset xmlns=\"http://www.sitemaps.org/schemas/sitemap/0.9\">\n";
+const char* const TAIL = "</urlset>\n";
+
+std::string makeSitemap(size_t entries) {
+    std::string xml = HEAD;
+    for (size_t i = 0; i < entries; i++) xml += entry(i);
+    return xml + TAIL;
+}
+
+std::string gzip(const std::string& data) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Parse body in chunks; returns the entries seen
+size_t parseChunked(const std::string& body, size_t chunk) {
+    size_t urls = 0;
+    SitemapParser parser([&urls](const std::string& loc, time_t lastModified) {
+        urls++;
+        doNotOptimize(loc.size() + lastModified);
+    }, nullptr);
+    for (size_t offset = 0; offset < body.size(); offset += chunk) {
+        parser.feed(body.data() + offset, std::min(chunk, body.size() - offset));
+    }
+    return parser.failed() ? 0 : urls;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::stoi(argv[1]) : 20;
+    size_t chunk = argc > 2 ? std::stoul(argv[2]) : 16384;
+
+    std::string xml = makeSitemap(ENTRIES);
+    std::string packed = gzip(xml);
+    std::cout << "Sitemap: " << ENTRIES << " entries, " << xml.size() / 1024 << " KB (" << packed.size() / 1024
+              << " KB gzipped), fed in " << chunk << "-byte chunks" << std::endl;
+    std::cout << std::left << std::setw(10) << "input" << std::right << std::setw(14) << "ms/sitemap"
+              << std::setw(14) << "ns/entry" << std::setw(14) << "MB/s (XML)" << std::endl;
+    for (const std::string* body : {&xml, &packed}) {
+        if (parseChunked(*body, chunk) != ENTRIES) {
+            std::cerr << "Parser returned the wrong entry count" << std::endl;
+            return 1;
+        }
+        double ns = timeNsPerOp(rounds, [&]() { doNotOptimize(parseChunked(*body, chunk)); });
+        std::cout << std::left << std::setw(10) << (body == &xml ? "plain" : "gzip") << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(14) << ns / 1e6 << std::setprecision(0) << std::setw(14)
+                  << ns / ENTRIES << std::setw(14) << xml.size() / (ns / 1e9) / 1e6 << std::endl;
+    }
+    xml.clear();
+    xml.shrink_to_fit();
+    packed.clear();
+    packed.shrink_to_fit();
+
+    // Stream growing sitemaps straight from a generator into the parser
+    std::cout << "\n" << std::left << std::setw(10) << "entries" << std::right << std::setw(16) << "XML bytes"
+              << std::setw(22) << "peak RSS growth (KB)" << std::endl;
+    for (size_t entries : {1000, 50000, 500000}) {
+        long before = peakRssKb();
+        size_t urls = 0, bytes = 0;
+        SitemapParser parser([&urls](const std::string&, time_t) { urls++; }, nullptr, 0);
+        std::string buffer = HEAD;
+        for (size_t i = 0; i <= entries; i++) {
+            if (i == entries) buffer += TAIL;
+            else buffer += entry(i);
+            if (buffer.size() >= chunk || i == entries) {
+                parser.feed(buffer.data(), buffer.size());
+                bytes += buffer.size();
+                buffer.clear();
+            }
+        }
+        if (urls != entries) {
+            std::cerr << "Parser returned the wrong entry count" << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(10) << entries << std::right << std::setw(16) << bytes << std::setw(22)
+                  << peakRssKb() - before << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Compares the content normalization in parseHTML (TextNormalizer) against
+// the previous std::regex("\\s+") replace + trim + substr on the full text
+// of each corpus page, as produced by extractText.
+//
+//   ./text_bench [corpus-dir | crawler_data.db] [iterations=200]
+
+#include <iomanip>
+#include <regex>
+
+#include "bench_util.hpp"
+#include "../html_parser.hpp"
+#include "../text_normalize.hpp"
+
+namespace {
+
+const size_t MAX_CONTENT_BYTES = 2000;
+
+// The content cleanup parseHTML used to do
+std::string regexNormalize(std::string content) {
+    std::regex multiSpace("\\s+");
+    content = std::regex_replace(content, multiSpace, " ");
+    content.erase(0, content.find_first_not_of(" \n\r\t"));
+    content.erase(content.find_last_not_of(" \n\r\t") + 1);
+    if (content.length() > MAX_CONTENT_BYTES) {
+        content = content.substr(0, MAX_CONTENT_BYTES) + "...";
+    }
+    return content;
+}
+
+std::string bodyText(const std::string& html) {
+    std::string text;
+    GumboOutput* output = gumbo_parse(html.c_str());
+    extractText(output->root, text);
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string source = argc > 1 ? argv[1] : BENCH_CORPUS_DIR;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    std::vector<CorpusPage> corpus = loadCorpus(source);
+    if (corpus.empty()) {
+        std::cerr << "No pages found in " << source << std::endl;
+        return 1;
+    }
+
+    // regex: previous path; capped: what parseHTML does now (stops at the
+    // cap); full: the whole text normalized, i.e. raw kernel throughput
+    std::cout << std::left << std::setw(28) << "page" << std::right << std::setw(10) << "text bytes"
+              << std::setw(12) << "regex us" << std::setw(12) << "capped us" << std::setw(12) << "full us"
+              << std::setw(12) << "full MB/s" << std::setw(10) << "speedup" << std::endl;
+
+    double regexTotal = 0, cappedTotal = 0, fullTotal = 0;
+    size_t bytesTotal = 0, mismatches = 0;
+    for (const auto& page : corpus) {
+        std::string text = bodyText(page.html);
+
+        double regexNs = timeNsPerOp(iterations, [&]() { doNotOptimize(regexNormalize(text)); });
+        double cappedNs = timeNsPerOp(iterations, [&]() { doNotOptimize(normalizeText(text, MAX_CONTENT_BYTES)); });
+        double fullNs = timeNsPerOp(iterations, [&]() { doNotOptimize(normalizeText(text)); });
+        regexTotal += regexNs;
+        cappedTotal += cappedNs;
+        fullTotal += fullNs;
+        bytesTotal += text.size();
+
+        // The outputs only differ where the old substr cut a UTF-8 character
+        std::string expected = regexNormalize(text);
+        std::string actual = normalizeText(text, MAX_CONTENT_BYTES);
+        size_t kept = actual.size() >= 3 ? actual.size() - 3 : 0;
+        if (expected != actual && !(endsWith(actual, "...") && expected.compare(0, kept, actual, 0, kept) == 0)) {
+            mismatches++;
+        }
+
+        std::string name = page.name.size() > 27 ? page.name.substr(0, 24) + "..." : page.name;
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << text.size() << std::setw(12) << regexNs / 1000 << std::setw(12)
+                  << cappedNs / 1000 << std::setw(12) << fullNs / 1000 << std::setw(12)
+                  << (fullNs > 0 ? text.size() * 1000.0 / fullNs : 0) << std::setw(9) << regexNs / cappedNs << "x"
+                  << std::endl;
+    }
+
+    std::cout << "\nPages: " << corpus.size() << ", iterations: " << iterations << std::endl;
+    std::cout << std::fixed << std::setprecision(1) << "Mean per page: regex " << regexTotal / corpus.size() / 1000
+              << " us, normalizer " << cappedTotal / corpus.size() / 1000 << " us capped / "
+              << fullTotal / corpus.size() / 1000 << " us full (" << std::setprecision(2)
+              << regexTotal / cappedTotal << "x)" << std::endl;
+    std::cout << "Full-text throughput: regex " << std::setprecision(1) << bytesTotal * 1000.0 / regexTotal
+              << " MB/s, normalizer " << bytesTotal * 1000.0 / fullTotal << " MB/s" << std::endl;
+    if (mismatches) {
+        std::cout << "Warning: " << mismatches << " page(s) normalized differently" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Measures link resolution on every <a href> of the corpus: resolveLinkHref
+// (RFC 3986 resolution over string_view components) against the previous
+// find("://") + substr version, which kept only absolute, root-relative and
+// protocol-relative hrefs. Also times parseUrl alone on the resolved links.
+//
+//   ./url_bench [corpus-dir | crawler_data.db] [iterations=200]
+
+#include <iomanip>
+
+#include "bench_util.hpp"
+#include "../html_parser.hpp"
+#include "../html_stream.hpp"
+#include "../url_utils.hpp"
+
+namespace legacy {
+
+bool extractDomain(const std::string& url, std::string& domain) {
+    size_t pos = url.find("://");
+    if (pos == std::string::npos) return false;
+    size_t domainEnd = url.find('/', pos + 3);
+    domain = (domainEnd != std::string::npos) ? url.substr(0, domainEnd) : url;
+    return true;
+}
+
+bool resolveLinkHref(std::string& href, const std::string& baseUrl) {
+    if (href.empty()) return false;
+    if (href[0] == '#' || href.find("mailto:") == 0 || href.find("javascript:") == 0 || href.find("tel:") == 0) {
+        return false;
+    }
+    if (href[0] == '/' && href[1] != '/') {
+        std::string domain;
+        if (extractDomain(baseUrl, domain)) href = domain + href;
+    } else if (href.find("//") == 0) {
+        size_t pos = baseUrl.find("://");
+        if (pos != std::string::npos) href = baseUrl.substr(0, pos) + ":" + href;
+    } else if (href.find("http") != 0) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace legacy
+
+namespace {
+
+struct Href {
+    std::string value;
+    const std::string* baseUrl;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string source = argc > 1 ? argv[1] : BENCH_CORPUS_DIR;
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    std::vector<CorpusPage> corpus = loadCorpus(source);
+    if (corpus.empty()) {
+        std::cerr << "No pages found in " << source << std::endl;
+        return 1;
+    }
+
+    // Every href as written in the pages
+    std::vector<Href> hrefs;
+    for (const auto& page : corpus) {
+        HtmlTagStream stream([&](const std::string& tag, const HtmlTagStream::Attributes& attributes) {
+            if (tag != "a") return;
+            for (const auto& attr : attributes) {
+                if (attr.first == "href") {
+                    hrefs.push_back({attr.second, &page.url});
+                    break;
+                }
+            }
+        });
+        stream.feed(page.html.data(), page.html.size());
+    }
+    if (hrefs.empty()) {
+        std::cerr << "No links found in " << source << std::endl;
+        return 1;
+    }
+
+    size_t legacyKept = 0, resolvedKept = 0;
+    std::vector<std::string> resolved;
+    std::string link;
+    for (const auto& href : hrefs) {
+        std::string copy = href.value;
+        legacyKept += legacy::resolveLinkHref(copy, *href.baseUrl);
+        if (resolveLinkHref(href.value, *href.baseUrl, link)) {
+            resolvedKept++;
+            resolved.push_back(link);
+        }
+    }
+
+    double legacyNs = timeNsPerOp(iterations, [&]() {
+        for (const auto& href : hrefs) {
+            std::string copy = href.value;
+            doNotOptimize(legacy::resolveLinkHref(copy, *href.baseUrl));
+            doNotOptimize(copy);
+        }
+    });
+    // parseHTML parses the page's base URL once for all of its links
+    double resolveNs = timeNsPerOp(iterations, [&]() {
+        const std::string* baseUrl = nullptr;
+        UrlParts base;
+        for (const auto& href : hrefs) {
+            if (href.baseUrl != baseUrl) {
+                baseUrl = href.baseUrl;
+                base = parseUrl(*baseUrl);
+            }
+            doNotOptimize(resolveLinkHref(href.value, base, link));
+        }
+    });
+    double parseNs = timeNsPerOp(iterations, [&]() {
+        for (const auto& url : resolved) doNotOptimize(parseUrl(url));
+    });
+
+    std::cout << "Pages: " << corpus.size() << ", hrefs: " << hrefs.size() << ", iterations: " << iterations
+              << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "legacy:      " << std::setw(12) << hrefs.size() * 1e9 / legacyNs << " links/sec, "
+              << legacyKept << " kept" << std::endl;
+    std::cout << "resolveUrl:  " << std::setw(12) << hrefs.size() * 1e9 / resolveNs << " links/sec, "
+              << resolvedKept << " kept" << std::endl;
+    if (!resolved.empty()) {
+        std::cout << "parseUrl:    " << std::setw(12) << resolved.size() * 1e9 / parseNs << " urls/sec" << std::endl;
+    }
+    std::cout << std::setprecision(2) << "Speedup: " << legacyNs / resolveNs << "x, links gained: "
+              << static_cast<long>(resolvedKept) - static_cast<long>(legacyKept) << std::endl;
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "body_buffer.hpp"
+
+#include <cstring>
+
+BodyBufferPool::BodyBufferPool(size_t initialCapacity, size_t maxPooled, size_t maxRetainedCapacity)
+    : state(std::make_shared<State>()) {
+    state->initialCapacity = initialCapacity;
+    state->maxPooled = maxPooled;
+    state->maxRetainedCapacity = maxRetainedCapacity;
+}
+
+std::shared_ptr<std::string> BodyBufferPool::acquire() {
+    std::unique_ptr<std::string> buffer;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->free.empty()) {
+            buffer = std::move(state->free.back());
+            state->free.pop_back();
+        }
+    }
+
+    if (buffer) {
+        state->reused++;
+    } else {
+        buffer = std::make_unique<std::string>();
+        buffer->reserve(state->initialCapacity);
+        state->allocated++;
+    }
+
+    std::shared_ptr<State> owner = state;
+    return std::shared_ptr<std::string>(buffer.release(), [owner](std::string* b) { owner->release(b); });
+}
+
+void BodyBufferPool::State::release(std::string* buffer) {
+    std::unique_ptr<std::string> owned(buffer);
+    // Don't let one huge page pin its memory in the pool
+    if (owned->capacity() > maxRetainedCapacity) return;
+    owned->clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free.size() < maxPooled) {
+        free.push_back(std::move(owned));
+    }
+}
+
+BodyBufferPool& bodyBufferPool() {
+    static BodyBufferPool pool;
+    return pool;
+}
+
+BodyBuffer makeBodyBuffer(std::string text) {
+    return std::make_shared<const std::string>(std::move(text));
+}
+
+// Function to fingerprint a body. Four independent multiply-rotate lanes
+// over 8-byte little-endian words, folded together with the tail and a
+// final avalanche step.
+uint64_t hashBody(const std::string& body) {
+    const uint64_t prime = 0x9e3779b97f4a7c15ULL;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto readWord = [](const char* p) {
+        unsigned char b[8];
+        std::memcpy(b, p, 8);
+        uint64_t word = 0;
+        for (int i = 7; i >= 0; i--) word = (word << 8) | b[i];
+        return word;
+    };
+
+    const char* p = body.data();
+    size_t length = body.size();
+    uint64_t lanes[4] = {prime, prime ^ 1, prime ^ 2, prime ^ 3};
+    while (length >= 32) {
+        for (int i = 0; i < 4; i++) {
+            lanes[i] = rotl(lanes[i] ^ (readWord(p + i * 8) * prime), 31) * 0xc2b2ae3d27d4eb4fULL;
+        }
+        p += 32;
+        length -= 32;
+    }
+
+    uint64_t h = body.size() * prime;
+    for (int i = 0; i < 4; i++) h = rotl(h ^ lanes[i], 27) * prime;
+    while (length >= 8) {
+        h = rotl(h ^ (readWord(p) * 0xc2b2ae3d27d4eb4fULL), 27) * prime;
+        p += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        h = rotl(h ^ static_cast<unsigned char>(*p++), 11) * prime;
+        length--;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
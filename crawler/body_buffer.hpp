@@ -0,0 +1,57 @@
+#ifndef BODY_BUFFER_HPP
+#define BODY_BUFFER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A downloaded response body. The fetch layer fills it, then the same
+// buffer is shared (not copied) with the parser and the storage layer.
+// When the last reference goes away the string goes back to its pool
+// with its capacity intact.
+using BodyBuffer = std::shared_ptr<const std::string>;
+
+class BodyBufferPool {
+public:
+    explicit BodyBufferPool(size_t initialCapacity = 256 * 1024,
+                            size_t maxPooled = 64,
+                            size_t maxRetainedCapacity = 4 * 1024 * 1024);
+
+    // Get an empty, writable buffer. Convert to BodyBuffer to share it.
+    std::shared_ptr<std::string> acquire();
+
+    size_t allocatedCount() const { return state->allocated.load(); }
+    size_t reusedCount() const { return state->reused.load(); }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<std::string>> free;
+        size_t initialCapacity;
+        size_t maxPooled;
+        size_t maxRetainedCapacity;
+        std::atomic<size_t> allocated{0};
+        std::atomic<size_t> reused{0};
+
+        void release(std::string* buffer);
+    };
+
+    // Buffers hold a reference to the state, so they can outlive the pool
+    std::shared_ptr<State> state;
+};
+
+// Process-wide pool used by the fetch engine
+BodyBufferPool& bodyBufferPool();
+
+// Wrap an existing string as a BodyBuffer (copies; for tools and benchmarks)
+BodyBuffer makeBodyBuffer(std::string text);
+
+// Function to fingerprint a body, e.g. to notice that a recrawled page is
+// unchanged. The value is stored, so it must not change between versions.
+uint64_t hashBody(const std::string& body);
+
+#endif // BODY_BUFFER_HPP
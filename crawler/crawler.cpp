@@ -1,18 +1,41 @@
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <set>
-#include <queue>
-#include <regex>
 #include <sstream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <curl/curl.h>
 #include <sqlite3.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-// External library for HTML parsing
-// Using gumbo-parser for HTML parsing
-#include <gumbo.h>
+#include "database.hpp"
+#include "fetch_engine.hpp"
+#include "frontier.hpp"
+#include "html_parser.hpp"
+#include "html_stream.hpp"
+#include "index_segment.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "page_arena.hpp"
+#include "pagerank.hpp"
+#include "robots.hpp"
+#include "shard.hpp"
+#include "simhash.hpp"
+#include "sitemap.hpp"
+#include "url_utils.hpp"
+#include "url_seen.hpp"
+#include "worker_pool.hpp"
 
 
 // Configuration
@@ -39,975 +62,972 @@ const std::vector<std::string> START_WEBSITES = {
 #define MAX_PAGES_PER_SITE 100 // Max pages to crawl per starting website
 #define MAX_DEPTH 3 // Max link depth from starting URL -1 for infinite
 #define CRAWL_DELAY_MS 0  // 1 second delay between requests (be polite)
+#define DEFAULT_WORKER_THREADS 8 // Concurrent crawl threads (override with CRAWLER_THREADS env)
+#define PAGES_PER_SLICE 1 // Pages a worker crawls for one host before moving to the next
+#define PROGRESS_INTERVAL_SEC 10 // Seconds between pages/sec progress reports
+#define WRITER_BATCH_PAGES 64 // Pages per database transaction...
+#define WRITER_BATCH_MS 250 // ...or milliseconds before a partial batch is committed
+#define ROBOTS_PRODUCT_TOKEN "CustomSearchBot" // User-agent token matched in robots.txt groups
+#define ROBOTS_TTL_SEC 86400 // Seconds before a host's robots.txt is fetched again
+#define ROBOTS_FAILURE_TTL_SEC 300 // Seconds a host crawls without rules after its robots.txt fetch threw
+#define ROBOTS_MAX_BYTES (500 * 1024) // robots.txt bytes parsed, the rest is ignored (RFC 9309's minimum)
+#define URL_SEEN_EXPECTED (1 << 22) // URLs the seen-filter is sized for (it grows past this)
+#define FRONTIER_SEGMENT_BYTES (4 << 20) // Size of one frontier segment file
+#define FRONTIER_CHECKPOINT_SEC 30 // Seconds between frontier checkpoints
+#define SIMHASH_MAX_DISTANCE 3 // Pages whose SimHashes differ in at most this many bits (3 at most) are near-duplicates
+#define METRICS_DUMP_SEC 60 // Seconds between per-stage latency summaries in the log
+#define MAX_PAGE_BYTES (4 << 20) // Pages with a bigger Content-Length or body are skipped mid-download
+#define LOG_QUEUE_RECORDS 8192 // Log lines buffered for the writer thread (more are dropped)
+#define LOG_DEBUG_PER_SEC 20 // Debug lines written per second at CRAWLER_LOG_LEVEL=debug
+#define SITEMAP_MAX_FILES 20 // Sitemaps (indexes included) fetched per host
+#define SITEMAP_MAX_URLS 50000 // URLs queued from a host's sitemaps
+#define SITEMAP_MAX_BYTES (50 << 20) // Largest sitemap, decompressed (the protocol's limit)
+#define SITEMAP_FLUSH_URLS 1024 // Sitemap URLs buffered before the frontiers are appended to
 
-struct RobotsRules {
-    std::set<std::string> disallowedPaths;
-    std::set<std::string> allowedPaths;
-    int crawlDelay = 0;
-    bool allowAll = false;
-};
 
-struct PageData {
-    std::string url;
-    std::string title;
-    std::string description;
-    std::vector<std::string> images;
-    std::vector<std::string> tags;
-    std::string content;
-    std::string rawHtml;
-    std::vector<std::string> outgoingLinks;
-    std::string favicon;
-};
+static_assert(SIMHASH_MAX_DISTANCE <= NearDuplicateIndex::MAX_DISTANCE,
+              "the near-duplicate index only finds matches within 3 bits");
 
-// Callback function for libcurl to write response data
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
-    userp->append((char*)contents, size * nmemb);
-    return size * nmemb;
-}
+// Shared fetch engine (created in main after curl_global_init)
+std::unique_ptr<FetchEngine> fetchEngine;
 
-// Function to normalize URLs (remove trailing slashes, fragments, sort query params)
-std::string normalizeUrl(const std::string& url) {
-    std::string normalized = url;
-    
-    // Remove fragment (#section)
-    size_t fragmentPos = normalized.find('#');
-    if (fragmentPos != std::string::npos) {
-        normalized = normalized.substr(0, fragmentPos);
-    }
-    
-    // Remove trailing slash (except for root domains)
-    if (normalized.length() > 8 && normalized.back() == '/') {
-        size_t protocolEnd = normalized.find("://");
-        if (protocolEnd != std::string::npos) {
-            size_t pathStart = normalized.find('/', protocolEnd + 3);
-            // Only remove if it's not just the domain
-            if (pathStart != std::string::npos && pathStart < normalized.length() - 1) {
-                normalized.pop_back();
-            }
-        }
+// Crawl log, written by its own thread (created first thing in main)
+std::unique_ptr<AsyncLogger> logger;
+
+// Function to log a transfer that was skipped or failed
+void reportFetch(const std::string& url, const FetchResult& result) {
+    if (result.skipped != SKIP_NONE) {
+        logger->info("Skipped download of {}: {}", url, result.error);
+    } else if (!result.ok()) {
+        logger->warn("Download failed for {}: {}", url, result.error);
     }
-    
-    // Convert to lowercase (for case-insensitive comparison)
-    std::transform(normalized.begin(), normalized.end(), normalized.begin(), ::tolower);
-    
-    return normalized;
 }
 
-// Function to download webpage content
-std::string downloadPage(const std::string& url) {
-    CURL* curl;
-    CURLcode res;
-    std::string readBuffer;
-
-    curl = curl_easy_init();
-    if(curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
-        
-        // Use realistic browser User-Agent to avoid bot detection
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, 
-            "Mozilla/5.0 (compatible; CustomSearchBot/1.0; +http://example.com/bot)");
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-        
-        // Enable automatic decompression (gzip, deflate, etc.)
-        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
-        
-        // Add common headers
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
-        headers = curl_slist_append(headers, "Accept-Language: en-US,en;q=0.9");
-        headers = curl_slist_append(headers, "Cache-Control: no-cache");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        
-        // SSL verification
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-        
-        res = curl_easy_perform(curl);
-        
-        curl_slist_free_all(headers);
-        
-        if(res != CURLE_OK) {
-            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
-            readBuffer.clear();
-        }
-        
-        curl_easy_cleanup(curl);
-    }
-    return readBuffer;
+// Function to fetch a page, conditionally when validators are given
+// Blocks the calling worker only; the transfer itself runs on the shared
+// fetch engine, which reuses connections across pages and threads.
+FetchResult fetchPage(const std::string& url, FetchEngine::ChunkObserver observer = nullptr,
+                      const Validators& validators = Validators(), const FetchLimits& limits = FetchLimits()) {
+    FetchResult result = fetchEngine->fetchSync(url, std::move(observer), validators, limits);
+    reportFetch(url, result);
+    return result;
 }
 
 // Function to fetch and parse robots.txt
 RobotsRules fetchRobotsTxt(const std::string& baseUrl) {
     RobotsRules rules;
     
-    // Extract domain from URL
-    size_t pos = baseUrl.find("://");
-    if (pos == std::string::npos) return rules;
-    
-    size_t domainEnd = baseUrl.find('/', pos + 3);
-    std::string domain = (domainEnd != std::string::npos) ? 
-                        baseUrl.substr(0, domainEnd) : baseUrl;
+    // robots.txt lives at the root of the origin
+    std::string robotsUrl;
+    if (!resolveUrl(baseUrl, "/robots.txt", robotsUrl) || !parseUrl(robotsUrl).isHttp()) return rules;
+    FetchLimits limits;
+    limits.maxBytes = ROBOTS_MAX_BYTES;
+    limits.truncate = true;
+    FetchResult result = fetchPage(robotsUrl, nullptr, Validators(), limits);
+    BodyBuffer robotsTxt = result.ok() ? std::move(result.body) : nullptr;
     
-    std::string robotsUrl = domain + "/robots.txt";
-    std::string robotsTxt = downloadPage(robotsUrl);
-    
-    if (robotsTxt.empty()) {
+    if (!robotsTxt || robotsTxt->empty()) {
         rules.allowAll = true;
         return rules;
     }
     
-    // Parse robots.txt (simple parser for User-agent: *)
-    std::istringstream stream(robotsTxt);
-    std::string line;
-    bool inOurSection = false;
-    
-    while (std::getline(stream, line)) {
-        // Trim whitespace
-        line.erase(0, line.find_first_not_of(" \t\r\n"));
-        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-        
-        // Skip empty lines and comments
-        if (line.empty() || line[0] == '#') continue;
-        
-        // Check for User-agent
-        if (line.find("User-agent:") == 0) {
-            std::string agent = line.substr(11);
-            agent.erase(0, agent.find_first_not_of(" \t"));
-            
-            // If we found our section and hit a new User-agent, we're done
-            if (inOurSection) {
-                break;
-            }
-            
-            // Check if this is our section (User-agent: *)
-            if (agent == "*") {
-                inOurSection = true;
-            }
-            continue;  // Don't process the User-agent line itself
+    return parseRobotsTxt(*robotsTxt, ROBOTS_PRODUCT_TOKEN);
+}
+
+
+
+// Read a boolean switch from the environment ("1", "true", "yes" enable it)
+bool envFlag(const char* name) {
+    const char* value = std::getenv(name);
+    if (!value) return false;
+    std::string v = value;
+    return v == "1" || v == "true" || v == "yes";
+}
+
+// Collect links with the streaming tokenizer during download (CRAWLER_STREAM_PARSE=1)
+const bool streamParse = envFlag("CRAWLER_STREAM_PARSE");
+
+// Visit stored pages again with conditional requests (CRAWLER_RECRAWL=1)
+const bool recrawl = envFlag("CRAWLER_RECRAWL");
+
+// Defer full-text index maintenance to the end of the crawl (CRAWLER_BULK_LOAD=1);
+// always on in a shard, whose pages_fts is built by the merge
+const bool bulkLoad = envFlag("CRAWLER_BULK_LOAD") || std::getenv("CRAWLER_SHARD");
+
+// Rank pages by their links once the crawl is done (CRAWLER_PAGERANK=1)
+const bool pageRank = envFlag("CRAWLER_PAGERANK");
+
+// Crawl each site's frontier in plain FIFO order instead of best-first (CRAWLER_BFS=1)
+const bool bfsFrontier = envFlag("CRAWLER_BFS");
+
+// Do not seed new frontiers from the hosts' sitemaps (CRAWLER_NO_SITEMAPS=1)
+const bool noSitemaps = envFlag("CRAWLER_NO_SITEMAPS");
+
+// This process's hash partition of the starting websites (CRAWLER_SHARD=i/N)
+ShardSpec shard;
+
+// Shared state across worker threads
+std::atomic<long> pagesFetched{0};
+std::atomic<long> pagesNotModified{0};  // recrawl: 304 responses
+std::atomic<long> pagesUnchanged{0};    // recrawl: 200 with the stored content hash
+std::atomic<int> checkpointEpoch{0};    // bumped every FRONTIER_CHECKPOINT_SEC
+
+// Crawl state of one starting website
+struct SiteCrawl {
+    std::string startUrl;
+    std::string baseDomain;
+    std::unique_ptr<PriorityFrontier> frontier;  // (url, depth) pairs still to crawl
+    int pageCount = 0;
+    bool resumed = false;  // the frontier came from a checkpoint
+    bool finished = false;
+};
+
+// Each starting website keeps its frontier in a directory named after it
+std::string frontierPath(const std::string& frontierDir, const std::string& startUrl) {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(UrlSeenFilter::fingerprint(startUrl)));
+    return frontierDir + "/" + name;
+}
+
+// All starting websites that share one host. Running them as one task means
+// the host is only ever fetched by one worker at a time.
+class HostCrawl : public HostTask {
+public:
+    HostCrawl(const std::string& origin, RobotsCache* robotsCache, UrlSeenFilter* seen, DatabaseWriter* writer,
+              NearDuplicateIndex* nearDuplicates, StoredPages* storedPages, int maxPages, int maxDepth)
+        : origin(origin), seen(seen), writer(writer), nearDuplicates(nearDuplicates), storedPages(storedPages),
+          maxPages(maxPages), maxDepth(maxDepth), robotsCache(robotsCache) {}
+
+    // Open the site's frontier; a checkpointed one continues where it
+    // stopped. A recrawl queues the seed again on top of it.
+    bool addSite(const std::string& startUrl, const std::string& frontierDir) {
+        SiteCrawl site;
+        site.startUrl = startUrl;
+        site.baseDomain = extractBaseDomain(startUrl);
+        FrontierConfig frontierConfig;
+        frontierConfig.segmentBytes = FRONTIER_SEGMENT_BYTES;
+        frontierConfig.bestFirst = !bfsFrontier;
+        site.frontier = std::make_unique<PriorityFrontier>(frontierPath(frontierDir, startUrl), frontierConfig);
+        if (!site.frontier->ok()) return false;
+        if (site.frontier->resumed()) {
+            site.pageCount = site.frontier->savedPageCount();
+            site.resumed = true;
+            resumedSites++;
         }
-        
-        // Only parse rules if we're in our section
-        if (inOurSection) {
-            // Parse Disallow
-            if (line.find("Disallow:") == 0) {
-                std::string path = line.substr(9);
-                path.erase(0, path.find_first_not_of(" \t"));
-                if (!path.empty()) {
-                    rules.disallowedPaths.insert(path);
-                }
-            }
-            
-            // Parse Allow
-            if (line.find("Allow:") == 0) {
-                std::string path = line.substr(6);
-                path.erase(0, path.find_first_not_of(" \t"));
-                if (!path.empty()) {
-                    rules.allowedPaths.insert(path);
-                }
-            }
-            
-            // Parse Crawl-delay
-            if (line.find("Crawl-delay:") == 0) {
-                std::string delay = line.substr(12);
-                delay.erase(0, delay.find_first_not_of(" \t"));
-                try {
-                    rules.crawlDelay = std::stoi(delay);
-                } catch (...) {}
-            }
+        if (site.frontier->empty() || recrawl) {
+            site.frontier->push(startUrl, 0);  // Start with depth 0
+            site.frontier->flush();
         }
+        sites.push_back(std::move(site));
+        return true;
     }
-    
-    return rules;
-}
 
-// Check if URL is allowed by robots.txt
-bool isAllowedByRobots(const std::string& url, const RobotsRules& rules) {
-    if (rules.allowAll) return true;
-    
-    // Extract path from URL
-    size_t pos = url.find("://");
-    if (pos == std::string::npos) return false;
-    
-    size_t pathStart = url.find('/', pos + 3);
-    if (pathStart == std::string::npos) return true;
-    
-    std::string path = url.substr(pathStart);
-    
-    // First check if explicitly allowed (Allow rules take precedence)
-    for (const auto& allowed : rules.allowedPaths) {
-        if (!allowed.empty() && allowed.back() == '*') {
-            std::string prefix = allowed.substr(0, allowed.length() - 1);
-            if (path.find(prefix) == 0) {
-                return true;
-            }
-        } else if (path.find(allowed) == 0) {
-            return true;
+    size_t resumedSiteCount() const { return resumedSites; }
+    size_t sitemapUrlCount() const { return sitemapUrls; }
+
+    // Record each site's frontier position. Pages taken from the frontier
+    // before it must be in the database first, so the writer is flushed.
+    // After a complete run the page counts start over, and the next run
+    // continues the remaining frontier with a fresh budget.
+    void checkpoint(bool runComplete = false) {
+        writer->flush();
+        for (auto& site : sites) {
+            site.frontier->checkpoint(runComplete ? 0 : site.pageCount);
         }
     }
-    
-    // Check if path matches any disallowed pattern
-    for (const auto& disallowed : rules.disallowedPaths) {
-        if (disallowed == "/") {
-            return false;  // Disallow all
+
+    // The pool drops a host whose slice threw; keep what it crawled so the
+    // next run continues its sites from here
+    void failed(const std::string& error) override {
+        logger->error("[{}] Crawl failed: {}; checkpointing its sites", origin, error);
+        checkpoint();
+    }
+
+    bool runSlice() override {
+        int epoch = checkpointEpoch.load();
+        if (epoch != checkpointedEpoch) {
+            checkpointedEpoch = epoch;
+            checkpoint();
         }
-        
-        // Check if disallowed ends with * (wildcard)
-        if (!disallowed.empty() && disallowed.back() == '*') {
-            std::string prefix = disallowed.substr(0, disallowed.length() - 1);
-            if (path.find(prefix) == 0) {
-                return false;
+        refreshRobots();
+
+        for (int n = 0; n < PAGES_PER_SLICE; n++) {
+            // Polite crawl delay: hand the worker back until this host is ready
+            if (std::chrono::steady_clock::now() < nextFetch) return true;
+
+            // Sitemaps come first; their URLs join the frontier at depth 1
+            if (!sitemapQueue.empty()) {
+                fetchNextSitemap();
+                continue;
             }
-        } 
-        // Exact match or prefix match for paths ending with /
-        else if (path == disallowed || 
-                 (disallowed.back() == '/' && path.find(disallowed) == 0)) {
-            return false;
-        }
-        // For non-slash endings, only match if followed by / or end of string
-        else if (path.find(disallowed) == 0) {
-            size_t matchEnd = disallowed.length();
-            if (matchEnd == path.length() || path[matchEnd] == '/' || path[matchEnd] == '?') {
-                return false;
+
+            // Round-robin over this host's sites that still have work
+            SiteCrawl* site = nullptr;
+            for (size_t i = 0; i < sites.size(); i++) {
+                SiteCrawl& candidate = sites[(nextSite + i) % sites.size()];
+                if (!candidate.finished) {
+                    site = &candidate;
+                    nextSite = (nextSite + i + 1) % sites.size();
+                    break;
+                }
             }
-        }
-    }
-    
-    return true;
-}
+            if (!site) break;
 
-// Function to extract text from a Gumbo node (excluding script and style tags)
-void extractText(GumboNode* node, std::string& text) {
-    if (node->type == GUMBO_NODE_TEXT) {
-        text += node->v.text.text;
-        text += " ";
-    } else if (node->type == GUMBO_NODE_ELEMENT) {
-        // Skip script, style, and noscript tags
-        GumboTag tag = node->v.element.tag;
-        if (tag == GUMBO_TAG_SCRIPT || tag == GUMBO_TAG_STYLE || 
-            tag == GUMBO_TAG_NOSCRIPT || tag == GUMBO_TAG_IFRAME) {
-            return;
+            crawlNextPage(*site);
         }
-        
-        GumboVector* children = &node->v.element.children;
-        for (unsigned int i = 0; i < children->length; ++i) {
-            extractText(static_cast<GumboNode*>(children->data[i]), text);
+
+        for (const auto& site : sites) {
+            if (!site.finished) return true;
         }
+        checkpoint();
+        return false;
     }
-}
 
-// Function to search for specific tags in the HTML tree
-void searchForTag(GumboNode* node, GumboTag tag, std::vector<GumboNode*>& results) {
-    if (node->type != GUMBO_NODE_ELEMENT) {
-        return;
-    }
-    if (node->v.element.tag == tag) {
-        results.push_back(node);
-    }
+    std::chrono::steady_clock::time_point nextRunTime() const override { return nextFetch; }
 
-    GumboVector* children = &node->v.element.children;
-    for (unsigned int i = 0; i < children->length; ++i) {
-        searchForTag(static_cast<GumboNode*>(children->data[i]), tag, results);
-    }
-}
+private:
+    // Pick up this host's rules from the shared cache (fetched again after the TTL)
+    void refreshRobots() {
+        std::shared_ptr<const RobotsRules> rules = robotsCache->get(origin);
+        if (rules == robotsRules) return;
+        robotsRules = rules;
+        crawlDelay = std::max(robotsRules->crawlDelay * 1000, CRAWL_DELAY_MS);
 
-// Function to get attribute value from a node
-std::string getAttribute(GumboNode* node, const char* attr_name) {
-    GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, attr_name);
-    if (attr) {
-        return std::string(attr->value);
+        logger->info("[{}] Fetched robots.txt (crawl delay: {}ms, disallow rules: {}, allow rules: {}, sitemaps: {})",
+                     origin, crawlDelay, robotsRules->matcher.disallowCount(), robotsRules->matcher.allowCount(),
+                     robotsRules->sitemaps.size());
+        if (!sitemapsQueued) {
+            sitemapsQueued = true;
+            queueSitemaps();
+        }
     }
-    return "";
-}
 
-// Function to check if URL has a valid image extension and is not an icon
-bool isValidImageUrl(const std::string& url) {
-    // Convert to lowercase for comparison
-    std::string lowerUrl = url;
-    std::transform(lowerUrl.begin(), lowerUrl.end(), lowerUrl.begin(), ::tolower);
-    
-    // Remove query parameters for extension check
-    size_t queryPos = lowerUrl.find('?');
-    if (queryPos != std::string::npos) {
-        lowerUrl = lowerUrl.substr(0, queryPos);
-    }
-    
-    // Exclude only obvious non-image formats
-    if (lowerUrl.find(".ico") != std::string::npos ||
-        lowerUrl.find(".gif") != std::string::npos ||
-        lowerUrl.find("favicon") != std::string::npos) {
-        return false;
-    }
-    
-    // Accept standard image formats
-    return (lowerUrl.find(".jpg") != std::string::npos ||
-            lowerUrl.find(".jpeg") != std::string::npos ||
-            lowerUrl.find(".png") != std::string::npos ||
-            lowerUrl.find(".webp") != std::string::npos ||
-            lowerUrl.find(".svg") != std::string::npos );
-}
+    // Queue the sitemaps robots.txt lists (or /sitemap.xml) once per run,
+    // unless every site resumed a frontier that already holds their URLs
+    // (a recrawl visits them again regardless)
+    void queueSitemaps() {
+        if (noSitemaps || maxDepth == 0) return;
+        bool freshSite = recrawl;
+        for (const auto& site : sites) freshSite = freshSite || !site.resumed;
+        if (!freshSite) return;
 
-// Function to extract links from HTML
-std::vector<std::string> extractLinks(const std::string& html, const std::string& baseUrl) {
-    std::vector<std::string> links;
-    std::set<std::string> uniqueLinks;  // Avoid duplicates
-    GumboOutput* output = gumbo_parse(html.c_str());
-    
-    std::vector<GumboNode*> anchorNodes;
-    searchForTag(output->root, GUMBO_TAG_A, anchorNodes);
-    
-    for (GumboNode* node : anchorNodes) {
-        std::string href = getAttribute(node, "href");
-        if (href.empty()) continue;
-        
-        // Skip anchors, mailto, javascript, etc.
-        if (href[0] == '#' || 
-            href.find("mailto:") == 0 || 
-            href.find("javascript:") == 0 ||
-            href.find("tel:") == 0) {
-            continue;
+        std::vector<std::string> listed = robotsRules->sitemaps;
+        if (listed.empty()) {
+            std::string fallback;
+            if (resolveUrl(origin, "/sitemap.xml", fallback)) listed.push_back(fallback);
         }
-        
-        // Convert relative URLs to absolute
-        if (href[0] == '/' && href[1] != '/') {
-            // Relative path
-            size_t pos = baseUrl.find("://");
-            if (pos != std::string::npos) {
-                size_t domainEnd = baseUrl.find('/', pos + 3);
-                std::string domain = (domainEnd != std::string::npos) ? 
-                                    baseUrl.substr(0, domainEnd) : baseUrl;
-                href = domain + href;
-            }
-        } else if (href.find("//") == 0) {
-            // Protocol-relative URL
-            size_t pos = baseUrl.find("://");
-            if (pos != std::string::npos) {
-                std::string protocol = baseUrl.substr(0, pos);
-                href = protocol + ":" + href;
-            }
-        } else if (href.find("http") != 0) {
-            // Relative URL without leading slash
-            continue;
+        for (auto it = listed.rbegin(); it != listed.rend(); ++it) {
+            if (sitemapQueue.size() >= SITEMAP_MAX_FILES) break;
+            if (parseUrl(*it).isHttp()) sitemapQueue.push_back(*it);
         }
-        
-        // Add to unique set then vector
-        if (uniqueLinks.find(href) == uniqueLinks.end()) {
-            uniqueLinks.insert(href);
-            links.push_back(href);
+        std::reverse(sitemapQueue.begin(), sitemapQueue.end());  // popped from the back, in listed order
+    }
+
+    // The site a sitemap URL belongs to: same base domain, a fresh
+    // frontier preferred
+    SiteCrawl* sitemapSite(const std::string& url) {
+        std::string baseDomain = extractBaseDomain(url);
+        SiteCrawl* match = nullptr;
+        for (auto& site : sites) {
+            if (site.baseDomain != baseDomain) continue;
+            if (!site.resumed) return &site;
+            if (!match) match = &site;
         }
+        return match;
     }
-    
-    gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return links;
-}
 
-// Function to parse HTML and extract page data
-PageData parseHTML(const std::string& html, const std::string& url) {
-    PageData data;
-    data.url = url;
-    data.rawHtml = html;  // Store raw HTML
-    
-    GumboOutput* output = gumbo_parse(html.c_str());
-    
-    // Extract title
-    std::vector<GumboNode*> titleNodes;
-    searchForTag(output->root, GUMBO_TAG_TITLE, titleNodes);
-    if (!titleNodes.empty()) {
-        extractText(titleNodes[0], data.title);
-        // Trim whitespace
-        data.title.erase(0, data.title.find_first_not_of(" \n\r\t"));
-        data.title.erase(data.title.find_last_not_of(" \n\r\t") + 1);
-    }
-    
-    // Extract meta description
-    std::vector<GumboNode*> metaNodes;
-    searchForTag(output->root, GUMBO_TAG_META, metaNodes);
-    for (GumboNode* node : metaNodes) {
-        std::string name = getAttribute(node, "name");
-        std::string property = getAttribute(node, "property");
-        if (name == "description" || property == "og:description") {
-            data.description = getAttribute(node, "content");
-            if (!data.description.empty()) {
-                // Use meta description as content (like Google does)
-                data.content = data.description;
-                break;
+    // Fetch one sitemap and queue its URLs. The parser runs on the fetch
+    // engine's thread and hands entries over in batches of
+    // SITEMAP_FLUSH_URLS; the transfer is paused while a full batch waits
+    // for this worker to add it to the frontiers.
+    void fetchNextSitemap() {
+        std::string sitemapUrl = std::move(sitemapQueue.back());
+        sitemapQueue.pop_back();
+        sitemapFiles++;
+        nextFetch = std::chrono::steady_clock::now() + std::chrono::milliseconds(crawlDelay);
+
+        struct Handoff {
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::vector<std::pair<std::string, time_t>> entries;  // the batch being filled
+            size_t taken = 0;                                     // entries handed over so far
+            std::vector<std::string> listed;
+            bool done = false;
+            FetchResult result;
+        } handoff;
+        size_t budget = SITEMAP_MAX_URLS - std::min<size_t>(sitemapUrls, SITEMAP_MAX_URLS);
+        auto onUrl = [&](const std::string& loc, time_t lastModified) {
+            std::lock_guard<std::mutex> lock(handoff.mutex);
+            if (handoff.taken >= budget) return;
+            handoff.taken++;
+            handoff.entries.emplace_back(loc, lastModified);
+            if (handoff.entries.size() == SITEMAP_FLUSH_URLS) handoff.changed.notify_one();
+        };
+        auto onSitemap = [&](const std::string& loc, time_t) {
+            std::lock_guard<std::mutex> lock(handoff.mutex);
+            if (handoff.listed.size() < SITEMAP_MAX_FILES) handoff.listed.push_back(loc);
+        };
+        SitemapParser parser(onUrl, onSitemap, SITEMAP_MAX_BYTES);
+
+        FetchLimits limits;
+        limits.maxBytes = SITEMAP_MAX_BYTES;
+        limits.keepBody = false;
+        // Notified under the lock: this worker may return (destroying the
+        // handoff) as soon as it sees done
+        fetchEngine->fetch(
+            sitemapUrl,
+            [&handoff](FetchResult&& result) {
+                std::lock_guard<std::mutex> lock(handoff.mutex);
+                handoff.result = std::move(result);
+                handoff.done = true;
+                handoff.changed.notify_one();
+            },
+            [&parser](const char* data, size_t length) { parser.feed(data, length); }, Validators(), limits,
+            [&handoff]() {
+                std::lock_guard<std::mutex> lock(handoff.mutex);
+                return handoff.entries.size() < SITEMAP_FLUSH_URLS;
+            });
+
+        size_t queued = 0;
+        std::vector<std::pair<std::string, time_t>> batch;
+        std::unique_lock<std::mutex> lock(handoff.mutex);
+        while (true) {
+            handoff.changed.wait(lock, [&handoff]() {
+                return handoff.done || handoff.entries.size() >= SITEMAP_FLUSH_URLS;
+            });
+            bool done = handoff.done;
+            batch.clear();
+            batch.swap(handoff.entries);
+            lock.unlock();
+
+            for (const auto& entry : batch) {
+                SiteCrawl* site = sitemapSite(entry.first);
+                if (!site || seen->contains(normalizeUrl(entry.first))) continue;
+                site->frontier->push(entry.first, 1, LINK_HAS_TEXT, entry.second);
+                sitemapUrls++;
+                queued++;
             }
+            for (auto& site : sites) site.frontier->flush();
+            if (done) break;
+            fetchEngine->wake();  // resume the transfer if it waits for this batch
+            lock.lock();
         }
-    }
-    
-    // Extract favicon
-    std::vector<GumboNode*> linkNodes;
-    searchForTag(output->root, GUMBO_TAG_LINK, linkNodes);
-    for (GumboNode* node : linkNodes) {
-        std::string rel = getAttribute(node, "rel");
-        if (rel.find("icon") != std::string::npos) {
-            std::string href = getAttribute(node, "href");
-            if (!href.empty()) {
-                // Convert relative URLs to absolute
-                if (href[0] == '/' && href[1] == '/') {
-                    href = "https:" + href;
-                } else if (href[0] == '/') {
-                    size_t pos = url.find("://");
-                    if (pos != std::string::npos) {
-                        size_t domainEnd = url.find('/', pos + 3);
-                        std::string domain = (domainEnd != std::string::npos) ? 
-                                            url.substr(0, domainEnd) : url;
-                        href = domain + href;
-                    }
-                } else if (href.find("http") != 0) {
-                    // Relative URL
-                    size_t pos = url.find("://");
-                    if (pos != std::string::npos) {
-                        size_t domainEnd = url.find('/', pos + 3);
-                        std::string domain = (domainEnd != std::string::npos) ? 
-                                            url.substr(0, domainEnd) : url;
-                        href = domain + "/" + href;
-                    }
-                }
-                data.favicon = href;
-                break;
+        FetchResult& result = handoff.result;
+        reportFetch(sitemapUrl, result);
+        addCount(COUNTER_SITEMAP_URLS, queued);
+        for (const auto& loc : handoff.listed) {
+            if (sitemapFiles + sitemapQueue.size() < SITEMAP_MAX_FILES && parseUrl(loc).isHttp()) {
+                sitemapQueue.push_back(loc);
             }
         }
-    }
-    
-    // If no favicon found in links, try default /favicon.ico
-    if (data.favicon.empty()) {
-        size_t pos = url.find("://");
-        if (pos != std::string::npos) {
-            size_t domainEnd = url.find('/', pos + 3);
-            std::string domain = (domainEnd != std::string::npos) ? 
-                                url.substr(0, domainEnd) : url;
-            data.favicon = domain + "/favicon.ico";
+
+        if (!result.ok()) return;  // reported above
+        if (result.status != 200 || parser.failed()) {
+            logger->info("[{}] No usable sitemap at {} (HTTP {}{})", origin, sitemapUrl, result.status,
+                         parser.failed() ? ", corrupt or over the size limit" : "");
+            return;
         }
+        logger->info("[{}] Sitemap {}{}: {} URLs queued of {}, {} sitemaps listed", origin, sitemapUrl,
+                     parser.gzipped() ? " (gzip)" : "", queued, parser.urlCount(), parser.sitemapCount());
     }
-    
-    // Extract keywords/tags
-    for (GumboNode* node : metaNodes) {
-        std::string name = getAttribute(node, "name");
-        if (name == "keywords") {
-            std::string keywords = getAttribute(node, "content");
-            // Split by comma
-            std::stringstream ss(keywords);
-            std::string tag;
-            while (std::getline(ss, tag, ',')) {
-                // Trim whitespace
-                tag.erase(0, tag.find_first_not_of(" \n\r\t"));
-                tag.erase(tag.find_last_not_of(" \n\r\t") + 1);
-                if (!tag.empty()) {
-                    data.tags.push_back(tag);
-                }
+
+    // Crawl the next eligible URL of a site (one download at most)
+    void crawlNextPage(SiteCrawl& site) {
+        std::string currentUrl;
+        int currentDepth = 0;
+        while (site.pageCount < maxPages && site.frontier->pop(currentUrl, currentDepth)) {
+            // Normalize URL to prevent duplicates
+            std::string normalizedUrl = normalizeUrl(currentUrl);
+
+            // Skip if already visited (by any site, or stored by an earlier run)
+            if (seen->contains(normalizedUrl)) {
+                continue;
             }
-        }
-    }
-    
-    // Extract outgoing links (discovered URLs)
-    data.outgoingLinks = extractLinks(html, url);
-    
-    // If no meta description found, extract from main content
-    if (data.content.empty()) {
-        std::vector<GumboNode*> contentNodes;
-        searchForTag(output->root, GUMBO_TAG_ARTICLE, contentNodes);
-        if (contentNodes.empty()) {
-            searchForTag(output->root, GUMBO_TAG_MAIN, contentNodes);
-        }
-        if (contentNodes.empty()) {
-            searchForTag(output->root, GUMBO_TAG_BODY, contentNodes);
-        }
-        
-        if (!contentNodes.empty()) {
-            // For Wikipedia and similar sites, find the first paragraph
-            std::vector<GumboNode*> paragraphs;
-            searchForTag(contentNodes[0], GUMBO_TAG_P, paragraphs);
-            
-            // Extract text from first few paragraphs (skip navigation/table of contents)
-            for (GumboNode* p : paragraphs) {
-                std::string paraText;
-                extractText(p, paraText);
-                
-                // Skip short paragraphs (likely navigation/UI elements)
-                if (paraText.length() < 50) continue;
-                
-                // Skip if it looks like navigation (contains "Toggle", "languages", etc.)
-                if (paraText.find("Toggle") != std::string::npos ||
-                    paraText.find("languages") != std::string::npos ||
-                    paraText.find("Jump to") != std::string::npos) {
-                    continue;
+
+            // Check robots.txt
+            if (!isAllowedByRobots(currentUrl, *robotsRules)) {
+                continue;
+            }
+
+            // Another site on a different host may have claimed it meanwhile
+            if (!seen->insert(normalizedUrl)) {
+                continue;
+            }
+            site.pageCount++;
+
+            // On a recrawl, ask the server only for changes since the stored copy
+            StoredPage stored;
+            bool known = storedPages && storedPages->lookup(currentUrl, stored);
+            Validators validators;
+            if (known) validators = {stored.etag, stored.lastModified};
+
+            // The next request to this host may start one crawl delay after
+            // this one starts, so the delay overlaps the download
+            nextFetch = std::chrono::steady_clock::now() + std::chrono::milliseconds(crawlDelay);
+
+            // Download page (optionally collecting links while the body streams in)
+            std::unique_ptr<StreamingLinkExtractor> streamedLinks;
+            FetchEngine::ChunkObserver observer;
+            if (streamParse) {
+                streamedLinks = std::make_unique<StreamingLinkExtractor>(currentUrl);
+                observer = [&streamedLinks](const char* chunk, size_t length) { streamedLinks->feed(chunk, length); };
+            }
+            FetchLimits limits;
+            limits.htmlOnly = true;
+            limits.maxBytes = MAX_PAGE_BYTES;
+            FetchResult result = fetchPage(currentUrl, std::move(observer), validators, limits);
+            if (known && result.ok() && result.notModified()) {
+                pagesNotModified++;
+                size_t storedLinks = keepStoredPage(site, stored, currentDepth);
+                logger->info("[{}/{}] (depth: {}) {} = Not modified, {} stored URLs", site.pageCount, maxPages,
+                             currentDepth, currentUrl, storedLinks);
+                return;
+            }
+            BodyBuffer html = result.ok() ? std::move(result.body) : nullptr;
+            if (!html || html->empty()) {
+                // Failed transfers were reported by fetchPage
+                if (result.ok()) logger->warn("Empty response for {}", currentUrl);
+                return;
+            }
+            pagesFetched++;
+
+            // Same bytes as the stored copy: nothing to parse or rewrite
+            uint64_t contentHash = hashBody(*html);
+            if (known && contentHash == stored.contentHash) {
+                pagesUnchanged++;
+                if (result.etag != stored.etag || result.lastModified != stored.lastModified) {
+                    PageData validatorsOnly;
+                    validatorsOnly.url = currentUrl;
+                    validatorsOnly.etag = result.etag;
+                    validatorsOnly.lastModified = result.lastModified;
+                    validatorsOnly.write = PageWrite::ValidatorsOnly;
+                    writer->submit(std::move(validatorsOnly));
                 }
-                
-                data.content += paraText + " ";
-                
-                // Get first 1-3 paragraphs of real content
-                if (data.content.length() > 500) break;
+                size_t storedLinks = keepStoredPage(site, stored, currentDepth);
+                logger->info("[{}/{}] (depth: {}) {} = Unchanged (same content hash), {} stored URLs",
+                             site.pageCount, maxPages, currentDepth, currentUrl, storedLinks);
+                return;
+            }
+
+            // Parse HTML and extract data into this worker's arena, which
+            // still holds the previous page until now
+            StageTimer parseTimer(STAGE_PARSE);
+            PageArena& arena = threadPageArena();
+            arena.reset();
+            ParseOptions parseOptions;
+            parseOptions.extractLinks = !streamedLinks;
+            parseOptions.arena = &arena;
+            PageData data = parseHTML(html, currentUrl, parseOptions);
+            if (streamedLinks) {
+                std::vector<std::string> links = streamedLinks->takeLinks();
+                data.outgoingLinks.assign(links.begin(), links.end());
             }
-            
-            // If still no good content, fallback to full body text
-            if (data.content.length() < 100) {
-                data.content.clear();
-                extractText(contentNodes[0], data.content);
+            data.etag = std::move(result.etag);
+            data.lastModified = std::move(result.lastModified);
+            data.contentHash = contentHash;
+            data.write = known ? PageWrite::Replace : PageWrite::Insert;
+            parseTimer.stop();
+
+            // Debug output (rate-limited)
+            logger->debug("  {} title: \"{}\", content: {} chars, discovered URLs: {}, preview: \"{}...\"", currentUrl,
+                          data.title, data.content.length(), data.outgoingLinks.size(),
+                          std::string_view(data.content).substr(0, 100));
+
+            // Validate page quality before saving
+            StageTimer validateTimer(STAGE_VALIDATE);
+            if (!isValidPage(data)) {
+                addCount(COUNTER_PAGES_INVALID);
+                logger->info("[{}/{}] (depth: {}) {} ✗ Skipped (failed validation)", site.pageCount, maxPages,
+                             currentDepth, currentUrl);
+                return;
             }
-            
-            // Clean up content
-            std::regex multiSpace("\\s+");
-            data.content = std::regex_replace(data.content, multiSpace, " ");
-            
-            // Trim
-            data.content.erase(0, data.content.find_first_not_of(" \n\r\t"));
-            data.content.erase(data.content.find_last_not_of(" \n\r\t") + 1);
-            
-            // Limit content to 2000 chars
-            if (data.content.length() > 2000) {
-                data.content = data.content.substr(0, 2000) + "...";
+
+            // A near-duplicate of a stored page is only recorded; its links
+            // were already found on the original. A recrawled page that
+            // became one loses its own stored row.
+            data.simhash = simhash(data.content);
+            std::string original;
+            int distance = 0;
+            bool nearDuplicate =
+                data.simhash && nearDuplicates->checkAndInsert(data.simhash, currentUrl, original, distance);
+            validateTimer.stop();
+            if (nearDuplicate) {
+                addCount(COUNTER_PAGES_DUPLICATE);
+                logger->info("[{}/{}] (depth: {}) {} = Near-duplicate of {} ({} bits apart)", site.pageCount,
+                             maxPages, currentDepth, currentUrl, original, distance);
+                PageData duplicate;
+                duplicate.url = currentUrl;
+                duplicate.duplicateOf = std::move(original);
+                duplicate.duplicateDistance = distance;
+                duplicate.write = PageWrite::Duplicate;
+                writer->submit(std::move(duplicate));
+                return;
             }
+
+            enqueueLinks(site, data.outgoingLinks, currentDepth, &data.outgoingLinkFlags);
+
+            // Hand the page to the database writer (committed in batches)
+            logger->info("[{}/{}] (depth: {}) {} ✓ {} ({} chars, {} links, {} images)", site.pageCount, maxPages,
+                         currentDepth, currentUrl, known ? "Changed, queued for update" : "Queued for saving",
+                         data.content.length(), data.outgoingLinks.size(), data.images.size());
+            writer->submit(std::move(data));
+            return;
         }
+
+        site.finished = true;
+        logger->info("[{}] Crawling completed for {}! Total pages crawled: {}", origin, site.startUrl,
+                     site.pageCount);
     }
-    
-    // Extract images from main content area (Google-style)
-    std::vector<GumboNode*> contentNodes;
-    searchForTag(output->root, GUMBO_TAG_ARTICLE, contentNodes);
-    if (contentNodes.empty()) {
-        searchForTag(output->root, GUMBO_TAG_MAIN, contentNodes);
-    }
-    if (contentNodes.empty()) {
-        searchForTag(output->root, GUMBO_TAG_BODY, contentNodes);
-    }
-    
-    if (!contentNodes.empty()) {
-        // Extract images from main content area only
-        std::vector<GumboNode*> imgNodes;
-        std::set<std::string> seenImages;
-        searchForTag(contentNodes[0], GUMBO_TAG_IMG, imgNodes);
-        
-        for (GumboNode* node : imgNodes) {
-            std::string src = getAttribute(node, "src");
-            if (src.empty()) continue;
-            
-            // Convert relative URLs to absolute
-            if (src[0] == '/' && src[1] == '/') {
-                src = "https:" + src;
-            } else if (src[0] == '/') {
-                size_t pos = url.find("://");
-                if (pos != std::string::npos) {
-                    size_t domainEnd = url.find('/', pos + 3);
-                    std::string domain = (domainEnd != std::string::npos) ? 
-                                        url.substr(0, domainEnd) : url;
-                    src = domain + src;
-                }
-            }
-            
-            // Only add valid, unique images
-            if (isValidImageUrl(src) && seenImages.find(src) == seenImages.end()) {
-                data.images.push_back(src);
-                seenImages.insert(src);
+
+    // Extract links and add to queue (only if within depth limit). flags
+    // are the parser's LinkFlag bits per link, when known.
+    template <typename Links>
+    void enqueueLinks(SiteCrawl& site, const Links& links, int depth,
+                      const std::pmr::vector<uint8_t>* flags = nullptr) {
+        if (maxDepth != -1 && depth >= maxDepth) return;
+        if (flags && flags->size() != links.size()) flags = nullptr;  // streamed links carry none
+        std::string link;
+        for (size_t i = 0; i < links.size(); i++) {
+            link.assign(links[i].data(), links[i].size());
+            // Only crawl if exact domain match (no subdomains)
+            std::string normalizedLink = normalizeUrl(link);
+            if (extractBaseDomain(link) == site.baseDomain && !seen->contains(normalizedLink)) {
+                site.frontier->push(link, depth + 1, flags ? (*flags)[i] : -1);
             }
         }
+        site.frontier->flush();
     }
-    
-    gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return data;
+
+    // A recrawled page that has not changed keeps its row; its stored links
+    // are followed as if it had been parsed again. Returns the link count.
+    size_t keepStoredPage(SiteCrawl& site, const StoredPage& stored, int depth) {
+        std::vector<std::string> links = storedPages->links(stored.id);
+        enqueueLinks(site, links, depth);
+        return links.size();
+    }
+
+    std::string origin;
+    UrlSeenFilter* seen;
+    DatabaseWriter* writer;
+    NearDuplicateIndex* nearDuplicates;
+    StoredPages* storedPages;  // set on recrawls only
+    int maxPages;
+    int maxDepth;
+
+    std::vector<SiteCrawl> sites;
+    size_t nextSite = 0;
+    size_t resumedSites = 0;
+    int checkpointedEpoch = 0;
+
+    RobotsCache* robotsCache;
+    std::shared_ptr<const RobotsRules> robotsRules;
+
+    // Sitemaps still to fetch (children of an index are added as it streams)
+    std::vector<std::string> sitemapQueue;
+    bool sitemapsQueued = false;
+    size_t sitemapFiles = 0;
+    size_t sitemapUrls = 0;
+    int crawlDelay = 0;
+    std::chrono::steady_clock::time_point nextFetch;  // earliest start of the next request
+};
+
+// Read the worker thread count from CRAWLER_THREADS (falls back to the default)
+size_t workerThreadCount() {
+    const char* env = std::getenv("CRAWLER_THREADS");
+    if (env) {
+        try {
+            int n = std::stoi(env);
+            if (n > 0) return static_cast<size_t>(n);
+        } catch (...) {}
+    }
+    return DEFAULT_WORKER_THREADS;
 }
 
-// Function to validate page quality (filter out Cloudflare, bot checks, low-quality pages)
-bool isValidPage(const PageData& data) {
-    // Check for Cloudflare or bot protection pages
-    if (data.title.find("Just a moment") != std::string::npos ||
-        data.title.find("Attention Required") != std::string::npos ||
-        data.title.find("Please verify you are human") != std::string::npos ||
-        data.title.find("Access denied") != std::string::npos ||
-        data.title.find("403 Forbidden") != std::string::npos ||
-        data.title.find("404 Not Found") != std::string::npos) {
-        return false;
+// Function to crawl with one child process per shard (CRAWLER_SHARDS=N) and
+// merge their databases into dbPath. The children are fresh executions of
+// this binary with CRAWLER_SHARD set, started before this process has any
+// threads. Returns the exit status for main.
+int runShards(int count, const std::string& dbPath) {
+    std::cout << "Starting " << count << " crawler shards..." << std::endl;
+    std::vector<pid_t> children;
+    for (int i = 0; i < count; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::string spec = std::to_string(i) + "/" + std::to_string(count);
+            setenv("CRAWLER_SHARD", spec.c_str(), 1);
+            char name[] = "crawler";
+            char* args[] = {name, nullptr};
+            execv("/proc/self/exe", args);
+            std::perror("Cannot start crawler shard");
+            _exit(127);
+        }
+        if (pid < 0) {
+            std::perror("Cannot start crawler shard");
+            break;
+        }
+        children.push_back(pid);
     }
     
-    // Check for minimal content length (reduced for dynamic sites like IMDB)
-    if (data.content.length() < 20) {
-        return false;
+    bool ok = children.size() == static_cast<size_t>(count);
+    for (pid_t child : children) {
+        int status = 0;
+        if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
     }
-    
-    // Check if title is empty (but allow short titles)
-    if (data.title.empty()) {
-        return false;
+    if (!ok) {
+        std::cerr << "A crawler shard failed; its database is kept and " << dbPath << " is not merged" << std::endl;
+        return 1;
     }
     
-    // Relax JavaScript check - only filter if heavily dominated by JS
-    size_t jsIndicators = 0;
-    if (data.content.find("window.ytcsi") != std::string::npos) jsIndicators++;
-    if (data.content.find("document.getElementById") != std::string::npos) jsIndicators++;
-    if (data.content.find("addEventListener") != std::string::npos) jsIndicators++;
-    if (data.content.find("var ") != std::string::npos) jsIndicators++;
-    if (data.content.find("const ") != std::string::npos) jsIndicators++;
+    // Pages of an earlier (unsharded or merged) database go after the
+    // shards, so a page the shards crawled again keeps its newer row
+    std::vector<std::string> inputs;
+    for (int i = 0; i < count; i++) inputs.push_back(shardDatabasePath(dbPath, ShardSpec{i, count}));
+    if (access(dbPath.c_str(), F_OK) == 0) inputs.push_back(dbPath);
     
-    // Only reject if 4 or more JS indicators (very strict)
-    if (jsIndicators >= 4) {
-        return false;
+    std::cout << "\nMerging " << inputs.size() << " databases into " << dbPath << "..." << std::endl;
+    MergeStats stats;
+    if (!mergeShards(inputs, dbPath, stats)) {
+        std::cerr << "Shard merge failed; " << dbPath << " was not changed" << std::endl;
+        return 1;
     }
-    
-    return true;
-}
-
-// Function to initialize SQLite database
-sqlite3* initDatabase(const char* dbName) {
-    sqlite3* db;
-    char* errMsg = 0;
-    
-    int rc = sqlite3_open(dbName, &db);
-    if (rc) {
-        std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
-        return nullptr;
-    }
-    
-    // Create tables
-    const char* sql = 
-        "CREATE TABLE IF NOT EXISTS pages ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "url TEXT UNIQUE NOT NULL,"
-        "title TEXT,"
-        "description TEXT,"
-        "content TEXT,"
-        "raw_html TEXT,"
-        "favicon TEXT,"
-        "crawled_at DATETIME DEFAULT CURRENT_TIMESTAMP"
-        ");"
-        
-        "CREATE TABLE IF NOT EXISTS images ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "page_id INTEGER,"
-        "image_url TEXT,"
-        "FOREIGN KEY(page_id) REFERENCES pages(id)"
-        ");"
-        
-        "CREATE TABLE IF NOT EXISTS tags ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "page_id INTEGER,"
-        "tag TEXT,"
-        "FOREIGN KEY(page_id) REFERENCES pages(id)"
-        ");"
-        
-        "CREATE TABLE IF NOT EXISTS links ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "source_page_id INTEGER,"
-        "target_url TEXT,"
-        "FOREIGN KEY(source_page_id) REFERENCES pages(id)"
-        ");"
-        
-        // FTS5 virtual table for full-text search
-        "CREATE VIRTUAL TABLE IF NOT EXISTS pages_fts USING fts5("
-        "title, "
-        "description, "
-        "content, "
-        "content='pages', "
-        "content_rowid='id'"
-        ");"
-        
-        // Triggers to keep FTS5 table in sync with pages table
-        "CREATE TRIGGER IF NOT EXISTS pages_ai AFTER INSERT ON pages BEGIN "
-        "INSERT INTO pages_fts(rowid, title, description, content) "
-        "VALUES (new.id, new.title, new.description, new.content); "
-        "END;"
-        
-        "CREATE TRIGGER IF NOT EXISTS pages_ad AFTER DELETE ON pages BEGIN "
-        "INSERT INTO pages_fts(pages_fts, rowid, title, description, content) "
-        "VALUES('delete', old.id, old.title, old.description, old.content); "
-        "END;"
-        
-        "CREATE TRIGGER IF NOT EXISTS pages_au AFTER UPDATE ON pages BEGIN "
-        "INSERT INTO pages_fts(pages_fts, rowid, title, description, content) "
-        "VALUES('delete', old.id, old.title, old.description, old.content); "
-        "INSERT INTO pages_fts(rowid, title, description, content) "
-        "VALUES (new.id, new.title, new.description, new.content); "
-        "END;"
-        
-        // Create index on URL for faster duplicate checking
-        "CREATE INDEX IF NOT EXISTS idx_pages_url ON pages(url);"
-        "CREATE INDEX IF NOT EXISTS idx_images_page_id ON images(page_id);"
-        "CREATE INDEX IF NOT EXISTS idx_links_source_page_id ON links(source_page_id);";
-    
-    rc = sqlite3_exec(db, sql, 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "SQL error: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-        return nullptr;
-    }
-    
-    std::cout << "Database initialized successfully" << std::endl;
-    return db;
+    std::cout << "Shard merge: " << stats.pages << " pages (" << stats.pagesSkipped << " already merged), "
+              << stats.rows << " other rows in " << std::fixed << std::setprecision(2) << stats.copySeconds
+              << "s, FTS built in " << stats.ftsSeconds << "s" << std::endl;
+    
+    // Link ranking and the index segment need every shard's pages
+    const char* index_path_env = std::getenv("CRAWLER_INDEX_PATH");
+    if (pageRank || index_path_env) {
+        sqlite3* db = initDatabase(dbPath.c_str());
+        if (!db) return 1;
+        if (pageRank) {
+            long ranked = updatePageRank(db);
+            if (ranked >= 0) std::cout << "PageRank: " << ranked << " pages" << std::endl;
+        }
+        if (index_path_env) {
+            long indexed = buildIndexSegment(db, index_path_env);
+            if (indexed >= 0) std::cout << "Index segment: " << indexed << " pages" << std::endl;
+        }
+        sqlite3_close(db);
+    }
+    std::cout << "Database saved as '" << dbPath << "'" << std::endl;
+    return 0;
 }
 
-// Function to save page data to database
-bool saveToDatabase(sqlite3* db, const PageData& data) {
-    char* errMsg = 0;
-    
-    // Begin transaction
-    int rc = sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to begin transaction: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-        return false;
-    }
-    
-    // Prepare INSERT statement for pages
-    sqlite3_stmt* stmt;
-    const char* sql = "INSERT OR IGNORE INTO pages (url, title, description, content, raw_html, favicon) VALUES (?, ?, ?, ?, ?, ?)";
+int main(void) {
+    // Get database path from environment or use default
+    const char* db_path_env = std::getenv("DB_PATH");
+    std::string db_path = db_path_env ? db_path_env : "crawler_data.db";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << std::endl;
-        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
-        return false;
+    // CRAWLER_SHARDS=N starts N shard processes and merges their databases;
+    // each of them runs the rest of main with CRAWLER_SHARD=i/N
+    const char* shard_env = std::getenv("CRAWLER_SHARD");
+    const char* shards_env = std::getenv("CRAWLER_SHARDS");
+    if (shard_env) {
+        if (!parseShardSpec(shard_env, shard)) {
+            std::cerr << "Invalid CRAWLER_SHARD '" << shard_env << "' (expected i/N with 0 <= i < N)" << std::endl;
+            return 1;
+        }
+        db_path = shardDatabasePath(db_path, shard);
+    } else if (shards_env && std::atoi(shards_env) > 1) {
+        return runShards(std::atoi(shards_env), db_path);
     }
     
-    sqlite3_bind_text(stmt, 1, data.url.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, data.title.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, data.description.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, data.content.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, data.rawHtml.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 6, data.favicon.c_str(), -1, SQLITE_TRANSIENT);
+    // Crawl log level from CRAWLER_LOG_LEVEL (debug, info, warn, error, off)
+    LoggerConfig loggerConfig;
+    loggerConfig.level = parseLogLevel(std::getenv("CRAWLER_LOG_LEVEL"), LOG_INFO);
+    loggerConfig.capacity = LOG_QUEUE_RECORDS;
+    loggerConfig.debugPerSecond = LOG_DEBUG_PER_SEC;
+    logger = std::make_unique<AsyncLogger>(loggerConfig);
     
-    rc = sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    // Initialize libcurl
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    fetchEngine = std::make_unique<FetchEngine>();
     
-    if (rc != SQLITE_DONE) {
-        if (rc == SQLITE_CONSTRAINT) {
-            // URL already exists, skip - commit transaction and return
-            sqlite3_exec(db, "COMMIT", 0, 0, 0);
-            return true;
-        }
-        std::cerr << "Failed to insert page: " << sqlite3_errmsg(db) << std::endl;
-        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
-        return false;
+    // Initialize database
+    sqlite3* db = initDatabase(db_path.c_str(), bulkLoad);
+    if (!db || (bulkLoad && !beginBulkLoad(db))) {
+        if (db) sqlite3_close(db);
+        fetchEngine.reset();
+        curl_global_cleanup();
+        return 1;
     }
     
-    // Get the page ID
-    sqlite3_int64 pageId = sqlite3_last_insert_rowid(db);
-    
-    // Insert images
-    for (const auto& img : data.images) {
-        const char* imgSql = "INSERT INTO images (page_id, image_url) VALUES (?, ?)";
-        rc = sqlite3_prepare_v2(db, imgSql, -1, &stmt, 0);
-        if (rc == SQLITE_OK) {
-            sqlite3_bind_int64(stmt, 1, pageId);
-            sqlite3_bind_text(stmt, 2, img.c_str(), -1, SQLITE_TRANSIENT);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
-        }
+    // All writes go through one writer thread that group-commits pages
+    WriterConfig writerConfig;
+    writerConfig.batchPages = WRITER_BATCH_PAGES;
+    writerConfig.batchMs = WRITER_BATCH_MS;
+    writerConfig.bulkLoad = bulkLoad;
+    DatabaseWriter writer(db_path, writerConfig);
+    if (!writer.ok()) {
+        sqlite3_close(db);
+        fetchEngine.reset();
+        curl_global_cleanup();
+        return 1;
     }
     
-    // Insert tags
-    for (const auto& tag : data.tags) {
-        const char* tagSql = "INSERT INTO tags (page_id, tag) VALUES (?, ?)";
-        rc = sqlite3_prepare_v2(db, tagSql, -1, &stmt, 0);
-        if (rc == SQLITE_OK) {
-            sqlite3_bind_int64(stmt, 1, pageId);
-            sqlite3_bind_text(stmt, 2, tag.c_str(), -1, SQLITE_TRANSIENT);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
+    // URLs seen by earlier runs: the saved filter plus everything in the
+    // pages table. The filter then also holds the URLs claimed by this run.
+    const char* seen_path_env = std::getenv("URL_SEEN_PATH");
+    std::string seen_path = seen_path_env ? seen_path_env : db_path + ".seen";
+    if (seen_path_env && shard.sharded()) seen_path += shardSuffix(shard);
+    // A recrawl visits stored pages again, so it starts from an empty filter
+    // and looks each page up to send its validators
+    UrlSeenFilter seen(URL_SEEN_EXPECTED);
+    size_t storedPages = 0;
+    std::unique_ptr<StoredPages> recrawlPages;
+    if (recrawl) {
+        recrawlPages = std::make_unique<StoredPages>(db_path);
+        if (!recrawlPages->ok()) {
+            writer.stop();
+            sqlite3_close(db);
+            fetchEngine.reset();
+            curl_global_cleanup();
+            return 1;
         }
+    } else {
+        seen.load(seen_path);
+        storedPages = forEachPageUrl(db, [&seen](const std::string& url) { seen.insert(normalizeUrl(url)); });
     }
     
-    // Insert outgoing links (discovered URLs)
-    for (const auto& link : data.outgoingLinks) {
-        const char* linkSql = "INSERT INTO links (source_page_id, target_url) VALUES (?, ?)";
-        rc = sqlite3_prepare_v2(db, linkSql, -1, &stmt, 0);
-        if (rc == SQLITE_OK) {
-            sqlite3_bind_int64(stmt, 1, pageId);
-            sqlite3_bind_text(stmt, 2, link.c_str(), -1, SQLITE_TRANSIENT);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
-        }
+    // SimHashes of the stored pages, checked before each new page is saved
+    NearDuplicateIndex nearDuplicates(SIMHASH_MAX_DISTANCE);
+    forEachPageFingerprint(db, [&nearDuplicates](const std::string& url, uint64_t fingerprint) {
+        nearDuplicates.insert(fingerprint, url);
+    });
+    
+    // Frontier files of every starting website, checkpointed while crawling
+    const char* frontier_dir_env = std::getenv("CRAWLER_FRONTIER_DIR");
+    std::string frontier_dir = frontier_dir_env ? frontier_dir_env : db_path + ".frontier";
+    
+    // Prometheus metrics on 127.0.0.1:<port> while crawling (off unless set)
+    const char* metrics_port_env = std::getenv("CRAWLER_METRICS_PORT");
+    int metrics_port = metrics_port_env ? std::atoi(metrics_port_env) : 0;
+    if (metrics_port > 0) metrics_port += shard.index;  // one port per shard
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metrics_port > 0) {
+        metricsServer = std::make_unique<MetricsServer>(metrics_port);
+        if (!metricsServer->ok()) metricsServer.reset();
     }
     
-    // Commit transaction
-    rc = sqlite3_exec(db, "COMMIT", 0, 0, &errMsg);
-    if (rc != SQLITE_OK) {
-        std::cerr << "Failed to commit transaction: " << errMsg << std::endl;
-        sqlite3_free(errMsg);
-        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
-        return false;
+    // Optional search index segment, written from the database after the crawl
+    // (a shard leaves it, and PageRank, to the merge)
+    const char* index_path_env = std::getenv("CRAWLER_INDEX_PATH");
+    std::string index_path = index_path_env && !shard.sharded() ? index_path_env : "";
+    
+    // robots.txt rules per host, shared by all workers
+    RobotsCache robotsCache(fetchRobotsTxt, std::chrono::seconds(ROBOTS_TTL_SEC),
+                            std::chrono::seconds(ROBOTS_FAILURE_TTL_SEC),
+                            [](const std::string& origin, const std::string& error) {
+                                logger->error("[{}] Failed to fetch robots.txt: {}", origin, error);
+                            });
+    
+    // Group starting websites by host so each host has a single politeness owner
+    std::vector<std::shared_ptr<HostCrawl>> hosts;
+    std::map<std::string, std::shared_ptr<HostCrawl>> hostsByOrigin;
+    size_t resumedSites = 0;
+    size_t sites = 0;
+    for (const auto& startUrl : START_WEBSITES) {
+        if (!shard.owns(startUrl)) continue;
+        sites++;
+        std::string origin = extractOrigin(startUrl);
+        auto& host = hostsByOrigin[origin];
+        if (!host) {
+            host = std::make_shared<HostCrawl>(origin, &robotsCache, &seen, &writer, &nearDuplicates,
+                                              recrawlPages.get(), MAX_PAGES_PER_SITE, MAX_DEPTH);
+            hosts.push_back(host);
+        }
+        if (!host->addSite(startUrl, frontier_dir)) {
+            writer.stop();
+            sqlite3_close(db);
+            fetchEngine.reset();
+            curl_global_cleanup();
+            return 1;
+        }
     }
+    for (const auto& host : hosts) resumedSites += host->resumedSiteCount();
     
-    return true;
-}
-
-// Function to check if URL already exists in database
-bool urlExistsInDatabase(sqlite3* db, const std::string& url) {
-    sqlite3_stmt* stmt;
-    const char* sql = "SELECT COUNT(*) FROM pages WHERE url = ?";
+    WorkStealingPool pool(workerThreadCount());
     
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if (rc != SQLITE_OK) {
-        return false;  // Assume doesn't exist if query fails
+    std::cout << "Starting web crawler..." << std::endl;
+    std::cout << "Database path: " << db_path << std::endl;
+    if (shard.sharded()) {
+        std::cout << "Shard: " << shard.index << "/" << shard.count << " (merged into pages_fts by the parent)"
+                  << std::endl;
     }
+    std::cout << "Total sites to crawl: " << sites << " (" << hosts.size() << " hosts)" << std::endl;
+    std::cout << "Worker threads: " << pool.threadCount() << std::endl;
+    std::cout << "Known URLs: " << seen.size() << " (" << storedPages << " stored pages)" << std::endl;
+    std::cout << "Streaming link extraction: " << (streamParse ? "on" : "off") << std::endl;
+    std::cout << "Recrawl: " << (recrawl ? "on" : "off") << std::endl;
+    std::cout << "Bulk load: "
+              << (shard.sharded() ? "on (pages_fts is built at the merge)"
+                                  : bulkLoad ? "on (pages_fts is rebuilt at the end)" : "off")
+              << std::endl;
+    std::cout << "Near-duplicate index: " << nearDuplicates.size() << " pages" << std::endl;
+    std::cout << "Frontier: " << frontier_dir << " (" << (bfsFrontier ? "BFS" : "best-first") << ", "
+              << resumedSites << " sites resumed)" << std::endl;
+    std::cout << "Sitemaps: "
+              << (noSitemaps ? std::string("off")
+                             : "up to " + std::to_string(SITEMAP_MAX_FILES) + " files and " +
+                                   std::to_string(SITEMAP_MAX_URLS) + " URLs per host")
+              << std::endl;
+    std::cout << "PageRank: " << (pageRank ? (shard.sharded() ? "after the merge" : "on") : "off") << std::endl;
+    std::cout << "Metrics: "
+              << (metricsServer ? "http://127.0.0.1:" + std::to_string(metrics_port) + "/metrics" : std::string("off"))
+              << std::endl;
+    std::cout << "Index segment: " << (index_path.empty() ? "off" : index_path) << std::endl;
+    std::cout << "Log level: " << logLevelName(loggerConfig.level) << std::endl;
+    std::cout << "Max pages per site: " << MAX_PAGES_PER_SITE << std::endl;
+    std::cout << "Max page size: " << MAX_PAGE_BYTES << " bytes (HTML only)" << std::endl;
+    std::cout << "Max depth: " << (MAX_DEPTH == -1 ? "unlimited" : std::to_string(MAX_DEPTH)) << std::endl;
+    std::cout << "-----------------------------------" << std::endl;
     
-    sqlite3_bind_text(stmt, 1, url.c_str(), -1, SQLITE_TRANSIENT);
-    
-    int count = 0;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        count = sqlite3_column_int(stmt, 0);
+    for (const auto& host : hosts) {
+        pool.submit(host);
     }
     
-    sqlite3_finalize(stmt);
-    return count > 0;
-}
-
-// Main crawler function
-void crawl(const std::string& startUrl, sqlite3* db, int maxPages = MAX_PAGES_PER_SITE, int maxDepth = MAX_DEPTH) {
-    std::queue<std::pair<std::string, int>> urlQueue;  // pair of (url, depth)
-    std::set<std::string> visited;
-    
-    // Fetch robots.txt rules
-    std::cout << "Fetching robots.txt..." << std::endl;
-    RobotsRules robotsRules = fetchRobotsTxt(startUrl);
-    int crawlDelay = std::max(robotsRules.crawlDelay * 1000, CRAWL_DELAY_MS);
-    std::cout << "Crawl delay: " << crawlDelay << "ms" << std::endl;
-    std::cout << "Disallowed paths: " << robotsRules.disallowedPaths.size() << std::endl;
-    
-    urlQueue.push({startUrl, 0});  // Start with depth 0
-    int pageCount = 0;
-    
-    while (!urlQueue.empty() && pageCount < maxPages) {
-        auto [currentUrl, currentDepth] = urlQueue.front();
-        urlQueue.pop();
-        
-        // Normalize URL to prevent duplicates
-        std::string normalizedUrl = normalizeUrl(currentUrl);
-        
-        // Skip if already visited
-        if (visited.find(normalizedUrl) != visited.end()) {
-            continue;
-        }
-        
-        // Check robots.txt
-        if (!isAllowedByRobots(currentUrl, robotsRules)) {
-            continue;
-        }
-        
-        visited.insert(normalizedUrl);
-        pageCount++;
-        
-        // Check if URL already exists in database (skip re-crawling)
-        if (urlExistsInDatabase(db, currentUrl)) {
-            std::cout << "Skipping [" << pageCount << "/" << maxPages << "] (already in DB): " << currentUrl << std::endl;
-            continue;
-        }
-        
-        std::cout << "Crawling [" << pageCount << "/" << maxPages << "] (depth: " << currentDepth << "): " << currentUrl << std::endl;
-        
-        // Polite crawl delay
-        if (pageCount > 1) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(crawlDelay));
-        }
-        
-        // Download page
-        std::string html = downloadPage(currentUrl);
-        if (html.empty()) {
-            std::cerr << "Failed to download: " << currentUrl << std::endl;
-            continue;
-        }
-        
-        // Parse HTML and extract data
-        PageData data = parseHTML(html, currentUrl);
-        
-        // Debug output
-        std::cout << "  - Title: \"" << data.title << "\"" << std::endl;
-        std::cout << "  - Content length: " << data.content.length() << " chars" << std::endl;
-        std::cout << "  - Content preview: \"" << data.content.substr(0, std::min((size_t)100, data.content.length())) << "...\"" << std::endl;
-        std::cout << "  - Discovered URLs: " << data.outgoingLinks.size() << std::endl;
-        
-        // Validate page quality before saving
-        if (!isValidPage(data)) {
-            std::cout << "  ✗ Skipped (failed validation)" << std::endl;
-            continue;
-        }
-        
-        // Save to database
-        if (saveToDatabase(db, data)) {
-            std::cout << "  ✓ Saved successfully!" << std::endl;
-            std::cout << "  - Images: " << data.images.size() << std::endl;
-        }
-        
-        // Extract links and add to queue (only if within depth limit)
-        if (maxDepth == -1 || currentDepth < maxDepth) {
-            // Extract base domain from start URL (no subdomains)
-            std::string baseDomain = startUrl;
-            size_t protocolEnd = baseDomain.find("://");
-            if (protocolEnd != std::string::npos) {
-                baseDomain = baseDomain.substr(protocolEnd + 3);
-            }
-            size_t pathStart = baseDomain.find('/');
-            if (pathStart != std::string::npos) {
-                baseDomain = baseDomain.substr(0, pathStart);
-            }
-            // Remove www. prefix if present
-            if (baseDomain.substr(0, 4) == "www.") {
-                baseDomain = baseDomain.substr(4);
+    // Periodic throughput report and frontier checkpoints while the pool runs
+    auto startTime = std::chrono::steady_clock::now();
+    bool done = false;
+    std::mutex reporterMutex;
+    std::condition_variable reporterCv;
+    std::thread reporter([&]() {
+        std::unique_lock<std::mutex> lock(reporterMutex);
+        auto lastCheckpoint = startTime;
+        auto lastDump = startTime;
+        MetricsSnapshot lastMetrics = metricsSnapshot();
+        while (!reporterCv.wait_for(lock, std::chrono::seconds(PROGRESS_INTERVAL_SEC), [&]() { return done; })) {
+            // Each host checkpoints its sites at the start of its next slice
+            if (std::chrono::steady_clock::now() - lastCheckpoint >= std::chrono::seconds(FRONTIER_CHECKPOINT_SEC)) {
+                lastCheckpoint = std::chrono::steady_clock::now();
+                checkpointEpoch++;
             }
-            
-            for (const auto& link : data.outgoingLinks) {
-                // Extract domain from link
-                std::string linkDomain = link;
-                size_t linkProtocolEnd = linkDomain.find("://");
-                if (linkProtocolEnd != std::string::npos) {
-                    linkDomain = linkDomain.substr(linkProtocolEnd + 3);
-                }
-                size_t linkPathStart = linkDomain.find('/');
-                if (linkPathStart != std::string::npos) {
-                    linkDomain = linkDomain.substr(0, linkPathStart);
-                }
-                // Remove www. prefix if present
-                if (linkDomain.substr(0, 4) == "www.") {
-                    linkDomain = linkDomain.substr(4);
-                }
-                
-                // Only crawl if exact domain match (no subdomains)
-                std::string normalizedLink = normalizeUrl(link);
-                if (linkDomain == baseDomain && visited.find(normalizedLink) == visited.end()) {
-                    urlQueue.push({link, currentDepth + 1});
-                }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            logger->info("[progress] {} pages fetched, {} saved, {:.2} pages/sec", pagesFetched.load(),
+                         writer.stats().pagesWritten, pagesFetched / elapsed);
+            // Stage latencies over the last interval, one log line per table row
+            if (std::chrono::steady_clock::now() - lastDump >= std::chrono::seconds(METRICS_DUMP_SEC)) {
+                MetricsSnapshot metrics = metricsSnapshot();
+                logger->info("[metrics] last {:.0}s",
+                             std::chrono::duration<double>(std::chrono::steady_clock::now() - lastDump).count());
+                std::istringstream table(formatMetricsSummary(metrics.since(lastMetrics)));
+                for (std::string row; std::getline(table, row);) logger->info("[metrics] {}", row);
+                lastDump = std::chrono::steady_clock::now();
+                lastMetrics = metrics;
             }
         }
+    });
+    
+    pool.run();
+    {
+        std::lock_guard<std::mutex> lock(reporterMutex);
+        done = true;
     }
+    reporterCv.notify_all();
+    reporter.join();
     
-    std::cout << "\nCrawling completed! Total pages crawled: " << pageCount << std::endl;
-}
-
-int main(void) {
-    // Initialize libcurl
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // Everything after this prints directly
+    logger->stop();
     
-    // Get database path from environment or use default
-    const char* db_path_env = std::getenv("DB_PATH");
-    std::string db_path = db_path_env ? db_path_env : "crawler_data.db";
+    for (const auto& host : hosts) {
+        host->checkpoint(true);
+    }
+    writer.stop();
+    
+    // Only URLs the database holds are skipped by later runs. URLs claimed
+    // in this run but not stored (failed or skipped downloads, rejected
+    // pages) are tried again.
+    {
+        UrlSeenFilter stored(URL_SEEN_EXPECTED);
+        auto add = [&stored](const std::string& url) { stored.insert(normalizeUrl(url)); };
+        forEachPageUrl(db, add);
+        forEachDuplicateUrl(db, add);
+        stored.save(seen_path);
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
     
-    // Initialize database
-    sqlite3* db = initDatabase(db_path.c_str());
-    if (!db) {
-        curl_global_cleanup();
-        return 1;
+    double ftsSeconds = 0;
+    if (bulkLoad && !shard.sharded()) {
+        auto ftsStart = std::chrono::steady_clock::now();
+        if (!finishBulkLoad(db)) std::cerr << "FTS rebuild failed; it is retried at the next start" << std::endl;
+        ftsSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ftsStart).count();
     }
     
-    std::cout << "Starting web crawler..." << std::endl;
-    std::cout << "Database path: " << db_path << std::endl;
-    std::cout << "Total sites to crawl: " << START_WEBSITES.size() << std::endl;
-    std::cout << "Max pages per site: " << MAX_PAGES_PER_SITE << std::endl;
-    std::cout << "Max depth: " << (MAX_DEPTH == -1 ? "unlimited" : std::to_string(MAX_DEPTH)) << std::endl;
-    std::cout << "-----------------------------------" << std::endl;
+    WriterStats writerStats = writer.stats();
+    std::cout << "\nDatabase writer: " << writerStats.pagesWritten << " pages, " << writerStats.rowsWritten
+              << " rows in " << writerStats.transactions << " transactions (" << std::fixed << std::setprecision(0)
+              << writerStats.rowsPerSecond() << " rows/sec, commit latency mean " << std::setprecision(2)
+              << writerStats.meanCommitMs() << "ms, max " << writerStats.maxCommitMs << "ms)" << std::endl;
+    if (bulkLoad && !shard.sharded()) {
+        std::cout << "FTS rebuild and optimize: " << std::setprecision(2) << ftsSeconds << "s" << std::endl;
+    }
+    std::cout << "Near-duplicates skipped: " << writerStats.pagesDuplicate << std::endl;
+    std::cout << "Raw HTML: " << writerStats.htmlBytes << " bytes stored as " << writerStats.compressedHtmlBytes
+              << " (" << writerStats.compressionRatio() << "x)" << std::endl;
+    if (recrawl) {
+        std::cout << "Recrawl: " << pagesNotModified << " not modified (304), " << pagesUnchanged
+                  << " unchanged, " << writerStats.pagesUpdated << " updated, " << writerStats.pagesRevalidated
+                  << " revalidated" << std::endl;
+    }
+    std::cout << "robots.txt fetched: " << robotsCache.fetchCount() << ", cache hits: " << robotsCache.hitCount()
+              << std::endl;
+    std::cout << "Connections opened: " << fetchEngine->newConnectionCount()
+              << ", reused: " << fetchEngine->reusedConnectionCount() << std::endl;
+    MetricsSnapshot metrics = metricsSnapshot();
+    std::cout << "Downloads skipped: " << metrics.counters[COUNTER_SKIPPED_CONTENT_TYPE] << " not HTML, "
+              << metrics.counters[COUNTER_SKIPPED_CONTENT_LENGTH] << " over the Content-Length budget, "
+              << metrics.counters[COUNTER_SKIPPED_BODY_BYTES] << " cut off at " << MAX_PAGE_BYTES << " bytes"
+              << std::endl;
+    std::cout << "URLs queued from sitemaps: " << metrics.counters[COUNTER_SITEMAP_URLS] << std::endl;
+    std::cout << "Body buffers allocated: " << bodyBufferPool().allocatedCount()
+              << ", reused: " << bodyBufferPool().reusedCount() << std::endl;
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        std::cout << "Peak RSS: " << usage.ru_maxrss / 1024 << " MB" << std::endl;  // ru_maxrss is in KB
+    }
     
-    // Crawl each website
-    for (size_t i = 0; i < START_WEBSITES.size(); i++) {
-        std::cout << "\n[SITE " << (i + 1) << "/" << START_WEBSITES.size() << "] " << START_WEBSITES[i] << std::endl;
-        std::cout << "-----------------------------------" << std::endl;
-        crawl(START_WEBSITES[i], db, MAX_PAGES_PER_SITE, MAX_DEPTH);
+    std::cout << "\nStage latencies:\n" << formatMetricsSummary(metrics) << std::endl;
+    
+    if (pageRank && !shard.sharded()) {
+        auto rankStart = std::chrono::steady_clock::now();
+        long ranked = updatePageRank(db);
+        if (ranked >= 0) {
+            std::cout << "PageRank: " << ranked << " pages in " << std::setprecision(1)
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - rankStart).count() << "s"
+                      << std::endl;
+        }
+    }
+    
+    if (!index_path.empty()) {
+        auto indexStart = std::chrono::steady_clock::now();
+        long indexed = buildIndexSegment(db, index_path);
+        if (indexed >= 0) {
+            IndexSegment segment(index_path);
+            std::cout << "Index segment: " << indexed << " pages, " << segment.termCount() << " terms, "
+                      << segment.fileSize() << " bytes in " << std::setprecision(1)
+                      << std::chrono::duration<double>(std::chrono::steady_clock::now() - indexStart).count() << "s"
+                      << std::endl;
+        }
     }
     
     // Cleanup
     sqlite3_close(db);
+    fetchEngine.reset();
     curl_global_cleanup();
     
     std::cout << "\n==================================" << std::endl;
-    std::cout << "All sites crawled successfully!" << std::endl;
+    if (pool.failureCount() > 0) {
+        std::cout << "Crawl finished; " << pool.failureCount() << " host(s) failed, their sites resume next run"
+                  << std::endl;
+    } else {
+        std::cout << "All sites crawled successfully!" << std::endl;
+    }
+    std::cout << "Pages fetched: " << pagesFetched << ", saved: " << writerStats.pagesWritten << std::endl;
+    std::cout << "Elapsed: " << std::fixed << std::setprecision(1) << elapsed << "s, throughput: "
+              << std::setprecision(2) << (elapsed > 0 ? pagesFetched / elapsed : 0.0) << " pages/sec"
+              << " (" << pool.threadCount() << " threads, " << pool.stealCount() << " steals, "
+              << pool.deferCount() << " politeness waits, " << pool.failureCount() << " hosts failed)" << std::endl;
     std::cout << "Database saved as '" << db_path << "'" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,811 @@
+#include "database.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "metrics.hpp"
+
+// Page size of databases created for a bulk load (the default is 4096)
+#define BULK_PAGE_SIZE "16384"
+
+namespace {
+
+// Function to check whether a table has a column
+bool hasColumn(sqlite3* db, const char* table, const char* column) {
+    sqlite3_stmt* stmt;
+    std::string sql = std::string("PRAGMA table_info(") + table + ")";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, 0) != SQLITE_OK) return false;
+    bool found = false;
+    while (!found && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        found = name && std::strcmp(name, column) == 0;
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Bring databases from older versions up to the current schema: add the
+// recrawl, SimHash and PageRank columns to pages and replace a pages_au
+// trigger that fires on every update with one that only fires when indexed
+// text changes
+bool upgradeSchema(sqlite3* db) {
+    struct { const char* name; const char* type; } columns[] = {
+        {"etag", "TEXT"},
+        {"last_modified", "TEXT"},
+        {"content_hash", "INTEGER"},
+        {"simhash", "INTEGER"},
+        {"page_rank", "REAL"},
+    };
+    for (const auto& column : columns) {
+        if (hasColumn(db, "pages", column.name)) continue;
+        std::string sql = std::string("ALTER TABLE pages ADD COLUMN ") + column.name + " " + column.type;
+        char* errMsg = 0;
+        if (sqlite3_exec(db, sql.c_str(), 0, 0, &errMsg) != SQLITE_OK) {
+            std::cerr << "SQL error: " << errMsg << std::endl;
+            sqlite3_free(errMsg);
+            return false;
+        }
+    }
+
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT sql FROM sqlite_master WHERE type = 'trigger' AND name = 'pages_au'";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) return false;
+    bool outdated = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* trigger = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        outdated = trigger && !std::strstr(trigger, " WHEN ");
+    }
+    sqlite3_finalize(stmt);
+    if (outdated) {
+        // createSchema creates it again
+        sqlite3_exec(db, "DROP TRIGGER pages_au", 0, 0, 0);
+    }
+    return true;
+}
+
+bool exec(sqlite3* db, const char* sql) {
+    char* errMsg = 0;
+    if (sqlite3_exec(db, sql, 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool bulkLoadPending(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM bulk_load", -1, &stmt, 0) != SQLITE_OK) return false;
+    bool pending = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return pending;
+}
+
+// Call back with the first column of every row of a URL query
+size_t forEachUrl(sqlite3* db, const char* sql, const char* what,
+                  const std::function<void(const std::string&)>& callback) {
+    sqlite3_stmt* stmt;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+    if (rc != SQLITE_OK) {
+        std::cerr << "Failed to read " << what << " URLs: " << sqlite3_errmsg(db) << std::endl;
+        return 0;
+    }
+    
+    size_t count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* url = sqlite3_column_text(stmt, 0);
+        if (url) {
+            callback(reinterpret_cast<const char*>(url));
+            count++;
+        }
+    }
+    
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+} // namespace
+
+// Function to create any missing tables, indexes and triggers
+bool createSchema(sqlite3* db) {
+    char* errMsg = 0;
+    
+    // Create tables
+    const char* sql = 
+        "CREATE TABLE IF NOT EXISTS pages ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "url TEXT UNIQUE NOT NULL,"
+        "title TEXT,"
+        "description TEXT,"
+        "content TEXT,"
+        "favicon TEXT,"
+        "crawled_at DATETIME DEFAULT CURRENT_TIMESTAMP,"
+        "etag TEXT,"              // validators and body hash for recrawls
+        "last_modified TEXT,"
+        "content_hash INTEGER,"
+        "simhash INTEGER,"        // near-duplicate fingerprint
+        "page_rank REAL"          // written by the PageRank stage (pagerank.cpp)
+        ");"
+        
+        "CREATE TABLE IF NOT EXISTS images ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "page_id INTEGER,"
+        "image_url TEXT,"
+        "FOREIGN KEY(page_id) REFERENCES pages(id)"
+        ");"
+        
+        "CREATE TABLE IF NOT EXISTS tags ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "page_id INTEGER,"
+        "tag TEXT,"
+        "FOREIGN KEY(page_id) REFERENCES pages(id)"
+        ");"
+        
+        "CREATE TABLE IF NOT EXISTS links ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "source_page_id INTEGER,"
+        "target_url TEXT,"
+        "FOREIGN KEY(source_page_id) REFERENCES pages(id)"
+        ");"
+        
+        // Raw HTML, zstd-compressed, kept apart so pages rows stay small
+        "CREATE TABLE IF NOT EXISTS html_dicts ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "dict BLOB NOT NULL,"
+        "created_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ");"
+        
+        "CREATE TABLE IF NOT EXISTS page_html ("
+        "page_id INTEGER PRIMARY KEY,"
+        "dict_id INTEGER NOT NULL,"
+        "raw_size INTEGER NOT NULL,"
+        "data BLOB NOT NULL,"
+        "FOREIGN KEY(page_id) REFERENCES pages(id)"
+        ");"
+        
+        // Pages skipped as near-duplicates of a stored page
+        "CREATE TABLE IF NOT EXISTS duplicates ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "url TEXT UNIQUE NOT NULL,"
+        "original_url TEXT NOT NULL,"
+        "distance INTEGER,"
+        "found_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ");"
+        
+        // FTS5 virtual table for full-text search
+        "CREATE VIRTUAL TABLE IF NOT EXISTS pages_fts USING fts5("
+        "title, "
+        "description, "
+        "content, "
+        "content='pages', "
+        "content_rowid='id'"
+        ");"
+        
+        // Triggers to keep FTS5 table in sync with pages table
+        "CREATE TRIGGER IF NOT EXISTS pages_ai AFTER INSERT ON pages BEGIN "
+        "INSERT INTO pages_fts(rowid, title, description, content) "
+        "VALUES (new.id, new.title, new.description, new.content); "
+        "END;"
+        
+        "CREATE TRIGGER IF NOT EXISTS pages_ad AFTER DELETE ON pages BEGIN "
+        "INSERT INTO pages_fts(pages_fts, rowid, title, description, content) "
+        "VALUES('delete', old.id, old.title, old.description, old.content); "
+        "END;"
+        
+        // Only text changes touch the index; a recrawl that refreshes
+        // validators or crawled_at leaves pages_fts alone
+        "CREATE TRIGGER IF NOT EXISTS pages_au AFTER UPDATE OF title, description, content ON pages "
+        "WHEN old.title IS NOT new.title OR old.description IS NOT new.description "
+        "OR old.content IS NOT new.content BEGIN "
+        "INSERT INTO pages_fts(pages_fts, rowid, title, description, content) "
+        "VALUES('delete', old.id, old.title, old.description, old.content); "
+        "INSERT INTO pages_fts(rowid, title, description, content) "
+        "VALUES (new.id, new.title, new.description, new.content); "
+        "END;"
+        
+        // Present while a bulk load has left pages_fts out of date
+        "CREATE TABLE IF NOT EXISTS bulk_load ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1),"
+        "started_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+        ");"
+        
+        // Create index on URL for faster duplicate checking
+        "CREATE INDEX IF NOT EXISTS idx_pages_url ON pages(url);"
+        "CREATE INDEX IF NOT EXISTS idx_images_page_id ON images(page_id);"
+        "CREATE INDEX IF NOT EXISTS idx_links_source_page_id ON links(source_page_id);";
+    
+    // Existing tables are upgraded first so the statements below see the
+    // current columns
+    sqlite3_stmt* probe;
+    bool hasPages = sqlite3_prepare_v2(db, "SELECT 1 FROM pages LIMIT 0", -1, &probe, 0) == SQLITE_OK;
+    sqlite3_finalize(probe);
+    if (hasPages && !upgradeSchema(db)) return false;
+    
+    int rc = sqlite3_exec(db, sql, 0, 0, &errMsg);
+    if (rc != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Function to initialize SQLite database
+sqlite3* initDatabase(const char* dbName, bool bulkLoad) {
+    sqlite3* db;
+    
+    int rc = sqlite3_open(dbName, &db);
+    if (rc) {
+        std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+        return nullptr;
+    }
+    
+    // Fewer, larger pages make FTS segments and page rows cheaper to write.
+    // Only takes effect before the first table is created: an existing
+    // database keeps its page size.
+    if (bulkLoad) sqlite3_exec(db, "PRAGMA page_size = " BULK_PAGE_SIZE ";", 0, 0, 0);
+    
+    // WAL lets the writer thread commit while this connection (and the
+    // backend) keep reading
+    sqlite3_busy_timeout(db, 5000);
+    sqlite3_exec(db, "PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;", 0, 0, 0);
+    
+    if (!createSchema(db)) {
+        sqlite3_close(db);
+        return nullptr;
+    }
+    
+    // A bulk load that was interrupted left pages_fts behind
+    if (!bulkLoad && bulkLoadPending(db)) {
+        std::cout << "Finishing an interrupted bulk load..." << std::endl;
+        if (!finishBulkLoad(db)) {
+            sqlite3_close(db);
+            return nullptr;
+        }
+    }
+    
+    std::cout << "Database initialized successfully" << std::endl;
+    return db;
+}
+
+bool beginBulkLoad(sqlite3* db) {
+    const char* sql =
+        "BEGIN;"
+        "INSERT OR IGNORE INTO bulk_load (id) VALUES (1);"
+        "DROP TRIGGER IF EXISTS pages_ai;"
+        "DROP TRIGGER IF EXISTS pages_au;"
+        "DROP TRIGGER IF EXISTS pages_ad;"
+        "COMMIT;";
+    return exec(db, sql);
+}
+
+bool finishBulkLoad(sqlite3* db) {
+    // 'rebuild' re-reads every row of the content table (pages). Segments
+    // are not merged while it runs; 'optimize' merges them all once at the end.
+    sqlite3_exec(db, "PRAGMA cache_size = -262144", 0, 0, 0);
+    bool ok = exec(db, "BEGIN;"
+                       "INSERT INTO pages_fts(pages_fts, rank) VALUES ('automerge', 0);"
+                       "INSERT INTO pages_fts(pages_fts) VALUES ('rebuild');"
+                       "INSERT INTO pages_fts(pages_fts) VALUES ('optimize');"
+                       "INSERT INTO pages_fts(pages_fts, rank) VALUES ('automerge', 4);") &&
+              createSchema(db) && exec(db, "DELETE FROM bulk_load; COMMIT;");
+    if (!ok) sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+    sqlite3_exec(db, "PRAGMA cache_size = -2000", 0, 0, 0);
+    return ok;
+}
+
+// Function to check if URL already exists in database
+size_t forEachPageUrl(sqlite3* db, const std::function<void(const std::string&)>& callback) {
+    return forEachUrl(db, "SELECT url FROM pages", "page", callback);
+}
+
+// Function to call back with the URL of every recorded near-duplicate
+size_t forEachDuplicateUrl(sqlite3* db, const std::function<void(const std::string&)>& callback) {
+    return forEachUrl(db, "SELECT url FROM duplicates", "duplicate", callback);
+}
+
+// Function to call back with the URL and SimHash of every fingerprinted page
+size_t forEachPageFingerprint(sqlite3* db, const std::function<void(const std::string&, uint64_t)>& callback) {
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT url, simhash FROM pages WHERE simhash IS NOT NULL";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to read page fingerprints: " << sqlite3_errmsg(db) << std::endl;
+        return 0;
+    }
+
+    size_t count = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* url = sqlite3_column_text(stmt, 0);
+        if (url) {
+            callback(reinterpret_cast<const char*>(url), static_cast<uint64_t>(sqlite3_column_int64(stmt, 1)));
+            count++;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return count;
+}
+
+StoredPages::StoredPages(const std::string& dbPath) {
+    if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Can't open database for lookups: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        db = nullptr;
+        return;
+    }
+    sqlite3_busy_timeout(db, 5000);
+    if (sqlite3_prepare_v2(db, "SELECT id, etag, last_modified, content_hash FROM pages WHERE url = ?", -1,
+                           &selectPage, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT target_url FROM links WHERE source_page_id = ? ORDER BY id", -1,
+                           &selectLinks, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << std::endl;
+    }
+}
+
+StoredPages::~StoredPages() {
+    sqlite3_finalize(selectPage);
+    sqlite3_finalize(selectLinks);
+    if (db) sqlite3_close(db);
+}
+
+bool StoredPages::lookup(const std::string& url, StoredPage& page) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ok()) return false;
+    sqlite3_bind_text(selectPage, 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+    bool found = sqlite3_step(selectPage) == SQLITE_ROW;
+    if (found) {
+        auto text = [&](int column) {
+            const unsigned char* value = sqlite3_column_text(selectPage, column);
+            return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+        };
+        page.id = sqlite3_column_int64(selectPage, 0);
+        page.etag = text(1);
+        page.lastModified = text(2);
+        page.contentHash = static_cast<uint64_t>(sqlite3_column_int64(selectPage, 3));
+    }
+    sqlite3_reset(selectPage);
+    return found;
+}
+
+std::vector<std::string> StoredPages::links(sqlite3_int64 pageId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    if (!ok()) return result;
+    sqlite3_bind_int64(selectLinks, 1, pageId);
+    while (sqlite3_step(selectLinks) == SQLITE_ROW) {
+        const unsigned char* url = sqlite3_column_text(selectLinks, 0);
+        if (url) result.emplace_back(reinterpret_cast<const char*>(url));
+    }
+    sqlite3_reset(selectLinks);
+    return result;
+}
+
+PageStatements::PageStatements(sqlite3* db, const HtmlStoreConfig& htmlConfig) : db(db), compressor(htmlConfig) {
+    struct { sqlite3_stmt** stmt; const char* sql; } statements[] = {
+        {&insertPage, "INSERT OR IGNORE INTO pages (url, title, description, content, favicon, etag, last_modified, "
+                      "content_hash, simhash) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"},
+        {&updatePage, "UPDATE pages SET title = ?2, description = ?3, content = ?4, favicon = ?5, etag = ?6, "
+                      "last_modified = ?7, content_hash = ?8, simhash = ?9, crawled_at = CURRENT_TIMESTAMP "
+                      "WHERE url = ?1"},
+        {&updateValidators, "UPDATE pages SET etag = ?2, last_modified = ?3, crawled_at = CURRENT_TIMESTAMP "
+                            "WHERE url = ?1"},
+        {&selectPageId, "SELECT id FROM pages WHERE url = ?"},
+        {&insertDuplicate, "INSERT OR REPLACE INTO duplicates (url, original_url, distance) VALUES (?, ?, ?)"},
+        {&deleteImages, "DELETE FROM images WHERE page_id = ?"},
+        {&deleteTags, "DELETE FROM tags WHERE page_id = ?"},
+        {&deleteLinks, "DELETE FROM links WHERE source_page_id = ?"},
+        {&deleteHtml, "DELETE FROM page_html WHERE page_id = ?"},
+        {&deletePage, "DELETE FROM pages WHERE id = ?"},
+        {&insertHtml, "INSERT OR REPLACE INTO page_html (page_id, dict_id, raw_size, data) VALUES (?, ?, ?, ?)"},
+        {&insertImage, "INSERT INTO images (page_id, image_url) VALUES (?, ?)"},
+        {&insertTag, "INSERT INTO tags (page_id, tag) VALUES (?, ?)"},
+        {&insertLink, "INSERT INTO links (source_page_id, target_url) VALUES (?, ?)"},
+        {&savepointStmt, "SAVEPOINT page"},
+        {&releaseStmt, "RELEASE page"},
+        {&rollbackStmt, "ROLLBACK TO page"},
+    };
+
+    ready = true;
+    for (auto& s : statements) {
+        if (sqlite3_prepare_v2(db, s.sql, -1, s.stmt, 0) != SQLITE_OK) {
+            std::cerr << "Failed to prepare statement: " << sqlite3_errmsg(db) << std::endl;
+            ready = false;
+        }
+    }
+    if (ready) compressor.loadLatestDictionary(db);
+}
+
+PageStatements::~PageStatements() {
+    // sqlite3_finalize(nullptr) is a no-op
+    sqlite3_finalize(insertPage);
+    sqlite3_finalize(updatePage);
+    sqlite3_finalize(updateValidators);
+    sqlite3_finalize(selectPageId);
+    sqlite3_finalize(insertDuplicate);
+    sqlite3_finalize(deleteImages);
+    sqlite3_finalize(deleteTags);
+    sqlite3_finalize(deleteLinks);
+    sqlite3_finalize(deleteHtml);
+    sqlite3_finalize(deletePage);
+    sqlite3_finalize(insertHtml);
+    sqlite3_finalize(insertImage);
+    sqlite3_finalize(insertTag);
+    sqlite3_finalize(insertLink);
+    sqlite3_finalize(savepointStmt);
+    sqlite3_finalize(releaseStmt);
+    sqlite3_finalize(rollbackStmt);
+}
+
+bool PageStatements::step(sqlite3_stmt* stmt) {
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    return rc == SQLITE_DONE;
+}
+
+bool PageStatements::savepoint() { return step(savepointStmt); }
+bool PageStatements::release() { return step(releaseStmt); }
+bool PageStatements::rollbackToSavepoint() { return step(rollbackStmt); }
+
+// Bind url, title, description, content, favicon, etag, last_modified,
+// content_hash and simhash as parameters 1-9
+void PageStatements::bindPageColumns(sqlite3_stmt* stmt, const PageData& data) {
+    // Strings outlive the step, so SQLite can read them in place
+    auto bindText = [stmt](int index, std::string_view value) {
+        sqlite3_bind_text(stmt, index, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+    };
+    auto bindOptional = [&](int index, std::string_view value) {
+        if (value.empty()) sqlite3_bind_null(stmt, index);
+        else bindText(index, value);
+    };
+    bindText(1, data.url);
+    bindText(2, data.title);
+    bindText(3, data.description);
+    bindText(4, data.content);
+    bindText(5, data.favicon);
+    bindOptional(6, data.etag);
+    bindOptional(7, data.lastModified);
+    auto bindHash = [stmt](int index, uint64_t value) {
+        if (value) sqlite3_bind_int64(stmt, index, static_cast<sqlite3_int64>(value));
+        else sqlite3_bind_null(stmt, index);
+    };
+    bindHash(8, data.contentHash);
+    bindHash(9, data.simhash);
+}
+
+// Update a recrawled page's row and drop its old images, tags and links.
+// Returns 1, 0 if the URL is not stored (yet), or -1 on error.
+int PageStatements::replacePage(const PageData& data, sqlite3_int64& pageId) {
+    bindPageColumns(updatePage, data);
+    if (!step(updatePage)) {
+        std::cerr << "Failed to update page: " << sqlite3_errmsg(db) << std::endl;
+        return -1;
+    }
+    if (sqlite3_changes(db) == 0) return 0;
+
+    sqlite3_bind_text(selectPageId, 1, data.url.data(), static_cast<int>(data.url.size()), SQLITE_STATIC);
+    bool found = sqlite3_step(selectPageId) == SQLITE_ROW;
+    if (found) pageId = sqlite3_column_int64(selectPageId, 0);
+    sqlite3_reset(selectPageId);
+    if (!found) return -1;
+
+    for (sqlite3_stmt* stmt : {deleteImages, deleteTags, deleteLinks}) {
+        sqlite3_bind_int64(stmt, 1, pageId);
+        if (!step(stmt)) {
+            std::cerr << "Failed to clear page details: " << sqlite3_errmsg(db) << std::endl;
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// Delete a stored page with its HTML, images, tags and links (the pages_ad
+// trigger drops its FTS row). A URL that is not stored is not an error.
+bool PageStatements::removePage(std::string_view url) {
+    sqlite3_bind_text(selectPageId, 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+    int rc = sqlite3_step(selectPageId);
+    sqlite3_int64 pageId = rc == SQLITE_ROW ? sqlite3_column_int64(selectPageId, 0) : 0;
+    sqlite3_reset(selectPageId);
+    if (rc == SQLITE_DONE) return true;
+    if (rc != SQLITE_ROW) {
+        std::cerr << "Failed to look up page: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    for (sqlite3_stmt* stmt : {deleteImages, deleteTags, deleteLinks, deleteHtml, deletePage}) {
+        sqlite3_bind_int64(stmt, 1, pageId);
+        if (!step(stmt)) {
+            std::cerr << "Failed to delete page: " << sqlite3_errmsg(db) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int PageStatements::savePage(const PageData& data) {
+    if (data.write == PageWrite::ValidatorsOnly) {
+        sqlite3_bind_text(updateValidators, 1, data.url.data(), static_cast<int>(data.url.size()), SQLITE_STATIC);
+        sqlite3_bind_text(updateValidators, 2, data.etag.data(), static_cast<int>(data.etag.size()), SQLITE_STATIC);
+        sqlite3_bind_text(updateValidators, 3, data.lastModified.data(), static_cast<int>(data.lastModified.size()),
+                          SQLITE_STATIC);
+        if (!step(updateValidators)) {
+            std::cerr << "Failed to update page validators: " << sqlite3_errmsg(db) << std::endl;
+            return -1;
+        }
+        return sqlite3_changes(db);
+    }
+
+    if (data.write == PageWrite::Duplicate) {
+        // A recrawled page that became a near-duplicate must not keep its
+        // stale row (and validators) in pages
+        if (!removePage(data.url)) return -1;
+        sqlite3_bind_text(insertDuplicate, 1, data.url.data(), static_cast<int>(data.url.size()), SQLITE_STATIC);
+        sqlite3_bind_text(insertDuplicate, 2, data.duplicateOf.data(), static_cast<int>(data.duplicateOf.size()),
+                          SQLITE_STATIC);
+        sqlite3_bind_int(insertDuplicate, 3, data.duplicateDistance);
+        if (!step(insertDuplicate)) {
+            std::cerr << "Failed to record duplicate page: " << sqlite3_errmsg(db) << std::endl;
+            return -1;
+        }
+        return 1;
+    }
+
+    sqlite3_int64 pageId = 0;
+    int replaced = data.write == PageWrite::Replace ? replacePage(data, pageId) : 0;
+    if (replaced < 0) return -1;
+
+    if (replaced == 0) {
+        // New page (a recrawled URL that is gone from the table is inserted again)
+        bindPageColumns(insertPage, data);
+        int rc = sqlite3_step(insertPage);
+        sqlite3_reset(insertPage);
+        if (rc != SQLITE_DONE) {
+            std::cerr << "Failed to insert page: " << sqlite3_errmsg(db) << std::endl;
+            return -1;
+        }
+
+        // URL already exists (INSERT OR IGNORE), nothing else to attach
+        if (sqlite3_changes(db) == 0) {
+            return 0;
+        }
+
+        // Get the page ID
+        pageId = sqlite3_last_insert_rowid(db);
+    }
+    int rows = 1;
+
+    if (data.rawHtml && !data.rawHtml->empty()) {
+        if (!saveHtml(pageId, *data.rawHtml)) return -1;
+        rows++;
+    }
+
+    auto insertChildren = [&](sqlite3_stmt* stmt, const std::pmr::vector<std::pmr::string>& values) {
+        for (const auto& value : values) {
+            sqlite3_bind_int64(stmt, 1, pageId);
+            sqlite3_bind_text(stmt, 2, value.data(), static_cast<int>(value.size()), SQLITE_STATIC);
+            if (!step(stmt)) return false;
+            rows++;
+        }
+        return true;
+    };
+
+    // Insert images, tags and outgoing links (discovered URLs)
+    if (!insertChildren(insertImage, data.images) ||
+        !insertChildren(insertTag, data.tags) ||
+        !insertChildren(insertLink, data.outgoingLinks)) {
+        std::cerr << "Failed to insert page details: " << sqlite3_errmsg(db) << std::endl;
+        return -1;
+    }
+    return rows;
+}
+
+bool PageStatements::saveHtml(sqlite3_int64 pageId, const std::string& html) {
+    // The first pages of a crawl train the dictionary used for the rest
+    // (see trainDictionaryIfReady)
+    compressor.addSample(html.data(), html.size());
+    if (!compressor.compress(html.data(), html.size(), compressed)) return false;
+
+    sqlite3_bind_int64(insertHtml, 1, pageId);
+    sqlite3_bind_int64(insertHtml, 2, compressor.dictionaryId());
+    sqlite3_bind_int64(insertHtml, 3, static_cast<sqlite3_int64>(html.size()));
+    sqlite3_bind_blob(insertHtml, 4, compressed.data(), static_cast<int>(compressed.size()), SQLITE_STATIC);
+    if (!step(insertHtml)) {
+        std::cerr << "Failed to insert page HTML: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PageStatements::trainDictionaryIfReady() {
+    if (!compressor.readyToTrain()) return false;
+    return compressor.trainDictionary(db);
+}
+
+DatabaseWriter::DatabaseWriter(const std::string& dbPath, const WriterConfig& config) : config(config) {
+    if (sqlite3_open(dbPath.c_str(), &db) != SQLITE_OK) {
+        std::cerr << "Can't open database for writing: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        db = nullptr;
+        return;
+    }
+    sqlite3_busy_timeout(db, 5000);
+
+    // Durable at checkpoints rather than at every commit; a crash can lose
+    // the last batches but never corrupts the database. A bulk load never
+    // syncs and checkpoints less often: a crashed process loses nothing, but
+    // a power loss can corrupt the file.
+    const char* pragmas = config.bulkLoad ?
+        "PRAGMA journal_mode = WAL;"
+        "PRAGMA synchronous = OFF;"
+        "PRAGMA temp_store = MEMORY;"
+        "PRAGMA cache_size = -262144;"
+        "PRAGMA mmap_size = 1073741824;"
+        "PRAGMA wal_autocheckpoint = 16000;" :
+        "PRAGMA journal_mode = WAL;"
+        "PRAGMA synchronous = NORMAL;"
+        "PRAGMA temp_store = MEMORY;"
+        "PRAGMA cache_size = -65536;"
+        "PRAGMA wal_autocheckpoint = 4000;";
+    char* errMsg = 0;
+    if (sqlite3_exec(db, pragmas, 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "Failed to set pragmas: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+    }
+
+    statements = new PageStatements(db, config.html);
+    if (!statements->ok()) {
+        delete statements;
+        statements = nullptr;
+        sqlite3_close(db);
+        db = nullptr;
+        return;
+    }
+
+    thread = std::thread(&DatabaseWriter::run, this);
+}
+
+DatabaseWriter::~DatabaseWriter() {
+    stop();
+    delete statements;
+    if (db) sqlite3_close(db);
+}
+
+void DatabaseWriter::submit(PageData&& page) {
+    // A page parsed in a worker's arena is gone at the arena's next reset,
+    // so it is copied to the heap (one exact-size allocation per string)
+    if (!page.onHeap()) {
+        PageData copy(page);
+        submit(std::move(copy));
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceCv.wait(lock, [&]() { return queue.size() < config.queueCapacity || stopping; });
+    if (stopping) return;
+    queue.push_back(std::move(page));
+    submitted++;
+    queueCv.notify_one();
+}
+
+void DatabaseWriter::flush() {
+    if (!db) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t target = submitted;
+    flushRequests++;
+    queueCv.notify_one();
+    flushedCv.wait(lock, [&]() { return committed >= target || finished; });
+    flushRequests--;
+}
+
+void DatabaseWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queueCv.notify_all();
+    spaceCv.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+WriterStats DatabaseWriter::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void DatabaseWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queueCv.wait(lock, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty()) break;  // stopping and drained
+        writeBatch(lock);
+    }
+    finished = true;
+    flushedCv.notify_all();
+}
+
+// Write queued pages in one transaction until the batch is full, its time
+// is up, or someone is waiting in flush(). Called with the lock held.
+void DatabaseWriter::writeBatch(std::unique_lock<std::mutex>& lock) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.batchMs);
+
+    lock.unlock();
+    sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, 0);
+    lock.lock();
+
+    size_t inBatch = 0;
+    WriterStats batchStats;
+    while (true) {
+        while (!queue.empty() && inBatch < config.batchPages) {
+            PageData page = std::move(queue.front());
+            queue.pop_front();
+            spaceCv.notify_one();
+            lock.unlock();
+
+            auto writeStart = std::chrono::steady_clock::now();
+            statements->savepoint();
+            int rows = statements->savePage(page);
+            if (rows < 0) {
+                statements->rollbackToSavepoint();
+                batchStats.pagesFailed++;
+            } else if (rows == 0) {
+                batchStats.pagesSkipped++;
+            } else {
+                if (page.write == PageWrite::ValidatorsOnly) batchStats.pagesRevalidated++;
+                else if (page.write == PageWrite::Replace) batchStats.pagesUpdated++;
+                else if (page.write == PageWrite::Duplicate) batchStats.pagesDuplicate++;
+                else batchStats.pagesWritten++;
+                batchStats.rowsWritten += rows;
+            }
+            statements->release();
+            auto written = std::chrono::steady_clock::now() - writeStart;
+            recordStage(STAGE_STORE, written);
+            batchStats.busySeconds += std::chrono::duration<double>(written).count();
+
+            lock.lock();
+            inBatch++;
+        }
+
+        if (inBatch >= config.batchPages || stopping || flushRequests > 0) break;
+        bool more = queueCv.wait_until(lock, deadline, [&]() {
+            return stopping || flushRequests > 0 || !queue.empty();
+        });
+        if (!more) break;  // batch time is up
+    }
+
+    lock.unlock();
+    auto commitStart = std::chrono::steady_clock::now();
+    char* errMsg = 0;
+    if (sqlite3_exec(db, "COMMIT", 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "Failed to commit transaction: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        batchStats.pagesFailed += batchStats.pagesWritten + batchStats.pagesUpdated + batchStats.pagesRevalidated +
+                                  batchStats.pagesDuplicate;
+        batchStats.pagesWritten = 0;
+        batchStats.pagesUpdated = 0;
+        batchStats.pagesRevalidated = 0;
+        batchStats.pagesDuplicate = 0;
+        batchStats.rowsWritten = 0;
+    }
+    auto end = std::chrono::steady_clock::now();
+    recordStage(STAGE_COMMIT, end - commitStart);
+    statements->trainDictionaryIfReady();
+    lock.lock();
+
+    double commitMs = std::chrono::duration<double, std::milli>(end - commitStart).count();
+    counters.pagesWritten += batchStats.pagesWritten;
+    counters.pagesUpdated += batchStats.pagesUpdated;
+    counters.pagesRevalidated += batchStats.pagesRevalidated;
+    counters.pagesDuplicate += batchStats.pagesDuplicate;
+    counters.pagesSkipped += batchStats.pagesSkipped;
+    counters.pagesFailed += batchStats.pagesFailed;
+    counters.rowsWritten += batchStats.rowsWritten;
+    counters.transactions++;
+    counters.htmlBytes = statements->htmlCompressor().rawBytes();
+    counters.compressedHtmlBytes = statements->htmlCompressor().compressedBytes();
+    counters.totalCommitMs += commitMs;
+    counters.maxCommitMs = std::max(counters.maxCommitMs, commitMs);
+    counters.busySeconds += batchStats.busySeconds + commitMs / 1000;
+
+    committed += inBatch;
+    flushedCv.notify_all();
+}
@@ -0,0 +1,216 @@
+#ifndef DATABASE_HPP
+#define DATABASE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sqlite3.h>
+
+#include "html_parser.hpp"
+#include "html_store.hpp"
+
+// Function to create any missing tables, indexes and triggers
+bool createSchema(sqlite3* db);
+
+// Function to initialize SQLite database (creates the schema, returns a
+// connection for reads; writes go through DatabaseWriter). bulkLoad gives a
+// new database larger pages; see beginBulkLoad.
+sqlite3* initDatabase(const char* dbName, bool bulkLoad = false);
+
+// Function to stop maintaining pages_fts on every write: drops the FTS
+// triggers and marks the database as bulk loading
+bool beginBulkLoad(sqlite3* db);
+
+// Function to rebuild and optimize pages_fts from pages in one pass and put
+// the triggers back. initDatabase calls it for a bulk load that never
+// finished.
+bool finishBulkLoad(sqlite3* db);
+
+// Function to call back with the URL of every stored page (returns the count)
+size_t forEachPageUrl(sqlite3* db, const std::function<void(const std::string&)>& callback);
+
+// Function to call back with the URL of every recorded near-duplicate (returns the count)
+size_t forEachDuplicateUrl(sqlite3* db, const std::function<void(const std::string&)>& callback);
+
+// Function to call back with the URL and SimHash of every fingerprinted page
+size_t forEachPageFingerprint(sqlite3* db, const std::function<void(const std::string&, uint64_t)>& callback);
+
+// What the database holds about a page, for conditional recrawls
+struct StoredPage {
+    sqlite3_int64 id = 0;
+    std::string etag;
+    std::string lastModified;
+    uint64_t contentHash = 0;
+};
+
+// Looks up stored pages by URL on its own read-only connection. Shared by
+// all workers; calls are serialized.
+class StoredPages {
+public:
+    explicit StoredPages(const std::string& dbPath);
+    ~StoredPages();
+
+    StoredPages(const StoredPages&) = delete;
+    StoredPages& operator=(const StoredPages&) = delete;
+
+    bool ok() const { return selectPage && selectLinks; }
+
+    // Returns false if the URL is not stored
+    bool lookup(const std::string& url, StoredPage& page);
+
+    // Outgoing links stored for a page (used when it comes back unchanged)
+    std::vector<std::string> links(sqlite3_int64 pageId);
+
+private:
+    sqlite3* db = nullptr;
+    std::mutex mutex;
+    sqlite3_stmt* selectPage = nullptr;
+    sqlite3_stmt* selectLinks = nullptr;
+};
+
+// Prepared statements for storing pages on one connection. Statements are
+// prepared once and reset/rebound for every row.
+class PageStatements {
+public:
+    explicit PageStatements(sqlite3* db, const HtmlStoreConfig& htmlConfig = HtmlStoreConfig());
+    ~PageStatements();
+
+    PageStatements(const PageStatements&) = delete;
+    PageStatements& operator=(const PageStatements&) = delete;
+
+    bool ok() const { return ready; }
+
+    // Store a page with its HTML, images, tags and links inside the caller's
+    // transaction, as data.write says: insert a new page (0 rows if the URL
+    // is already stored), replace a recrawled page in place (its images,
+    // tags and links are rewritten), only refresh its validators, or record
+    // it as a near-duplicate (a stored row for the URL is deleted).
+    // Returns the number of rows written or -1 on error.
+    int savePage(const PageData& data);
+
+    // Savepoints let one bad page be rolled back without losing its batch
+    bool savepoint();
+    bool release();
+    bool rollbackToSavepoint();
+
+    // Compress and store a page's raw HTML in page_html
+    bool saveHtml(sqlite3_int64 pageId, const std::string& html);
+
+    // Train the HTML dictionary once enough pages were sampled and store it
+    // in its own transaction. Call between transactions: a dictionary row
+    // written inside one could be rolled back while pages still use its id.
+    bool trainDictionaryIfReady();
+
+    const HtmlCompressor& htmlCompressor() const { return compressor; }
+
+private:
+    bool step(sqlite3_stmt* stmt);
+    void bindPageColumns(sqlite3_stmt* stmt, const PageData& data);
+    int replacePage(const PageData& data, sqlite3_int64& pageId);
+    bool removePage(std::string_view url);
+
+    sqlite3* db;
+    bool ready = false;
+    HtmlCompressor compressor;
+    std::string compressed;  // reused output buffer
+    sqlite3_stmt* insertPage = nullptr;
+    sqlite3_stmt* updatePage = nullptr;
+    sqlite3_stmt* updateValidators = nullptr;
+    sqlite3_stmt* selectPageId = nullptr;
+    sqlite3_stmt* insertDuplicate = nullptr;
+    sqlite3_stmt* deleteImages = nullptr;
+    sqlite3_stmt* deleteTags = nullptr;
+    sqlite3_stmt* deleteLinks = nullptr;
+    sqlite3_stmt* deleteHtml = nullptr;
+    sqlite3_stmt* deletePage = nullptr;
+    sqlite3_stmt* insertHtml = nullptr;
+    sqlite3_stmt* insertImage = nullptr;
+    sqlite3_stmt* insertTag = nullptr;
+    sqlite3_stmt* insertLink = nullptr;
+    sqlite3_stmt* savepointStmt = nullptr;
+    sqlite3_stmt* releaseStmt = nullptr;
+    sqlite3_stmt* rollbackStmt = nullptr;
+};
+
+struct WriterConfig {
+    size_t batchPages = 64;   // commit after this many pages...
+    int batchMs = 250;        // ...or this long after the transaction began
+    size_t queueCapacity = 256;  // submit() blocks when this many pages wait
+    bool bulkLoad = false;    // no fsync, large mmap and cache (see beginBulkLoad)
+    HtmlStoreConfig html;
+};
+
+struct WriterStats {
+    size_t pagesWritten = 0;  // newly inserted pages
+    size_t pagesUpdated = 0;  // recrawled pages rewritten in place
+    size_t pagesRevalidated = 0;  // recrawled pages that only got new validators
+    size_t pagesDuplicate = 0;  // near-duplicates recorded instead of stored
+    size_t pagesSkipped = 0;  // URL already stored
+    size_t pagesFailed = 0;
+    size_t rowsWritten = 0;   // pages + html + images + tags + links
+    size_t transactions = 0;
+    double totalCommitMs = 0;
+    double maxCommitMs = 0;
+    double busySeconds = 0;   // time spent writing rows and committing
+    size_t htmlBytes = 0;     // raw HTML stored, before and after compression
+    size_t compressedHtmlBytes = 0;
+
+    double rowsPerSecond() const { return busySeconds > 0 ? rowsWritten / busySeconds : 0; }
+    double meanCommitMs() const { return transactions ? totalCommitMs / transactions : 0; }
+    double compressionRatio() const { return compressedHtmlBytes ? static_cast<double>(htmlBytes) / compressedHtmlBytes : 0; }
+};
+
+// Owns the write connection and a thread that drains a queue of pages,
+// grouping many pages into one transaction (group commit).
+class DatabaseWriter {
+public:
+    DatabaseWriter(const std::string& dbPath, const WriterConfig& config = WriterConfig());
+    ~DatabaseWriter();
+
+    DatabaseWriter(const DatabaseWriter&) = delete;
+    DatabaseWriter& operator=(const DatabaseWriter&) = delete;
+
+    bool ok() const { return db != nullptr; }
+
+    // Queue a page for storage; blocks while the queue is full
+    void submit(PageData&& page);
+
+    // Block until every page submitted so far is committed
+    void flush();
+
+    // Commit what is queued and stop the writer thread
+    void stop();
+
+    WriterStats stats();
+
+private:
+    void run();
+    void writeBatch(std::unique_lock<std::mutex>& lock);
+
+    WriterConfig config;
+    sqlite3* db = nullptr;
+    PageStatements* statements = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable queueCv;    // writer waits for pages
+    std::condition_variable spaceCv;    // producers wait for room
+    std::condition_variable flushedCv;  // flush() waits for commits
+    std::deque<PageData> queue;
+    size_t submitted = 0;
+    size_t committed = 0;
+    size_t flushRequests = 0;
+    bool stopping = false;
+    bool finished = false;  // writer thread has exited
+
+    WriterStats counters;
+    std::thread thread;
+};
+
+#endif // DATABASE_HPP
@@ -0,0 +1,479 @@
+#include "fetch_engine.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string_view>
+#include <strings.h>
+
+#include "metrics.hpp"
+
+namespace {
+
+// Most bytes reserved up front from a Content-Length (the server's claim);
+// a bigger body grows the buffer as it arrives
+const size_t MAX_RESERVE_BYTES = 4 * 1024 * 1024;
+
+// Is a Content-Type value (with or without parameters) an HTML document?
+bool isHtmlType(std::string_view contentType) {
+    std::string_view type = contentType.substr(0, contentType.find(';'));
+    while (!type.empty() && (type.back() == ' ' || type.back() == '\t')) type.remove_suffix(1);
+    auto is = [&type](std::string_view expected) {
+        return type.size() == expected.size() && strncasecmp(type.data(), expected.data(), type.size()) == 0;
+    };
+    return is("text/html") || is("application/xhtml+xml");
+}
+
+} // namespace
+
+// Callback function for libcurl to write response data
+size_t FetchEngine::writeCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    Transfer* transfer = static_cast<Transfer*>(userp);
+    size_t length = size * nmemb;
+
+    // A consumer that has not caught up holds the transfer back; curl hands
+    // this chunk over again when resumeReady() unpauses it
+    if (transfer->request.ready && !transfer->request.ready()) {
+        if (!transfer->paused) {
+            transfer->paused = true;
+            transfer->engine->pausedTransfers.push_back(transfer);
+        }
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
+    // Byte budget: stop reading (curl fails the transfer with a write error)
+    size_t maxBytes = transfer->request.limits.maxBytes;
+    if (maxBytes && transfer->received + length > maxBytes) {
+        if (!transfer->request.limits.truncate) {
+            transfer->skipped = SKIP_BODY_BYTES;
+            return 0;
+        }
+        // Keep the part that fits; finish() reports the transfer as complete
+        transfer->truncated = true;
+        length = maxBytes - transfer->received;
+    }
+    transfer->received += length;
+
+    if (transfer->request.limits.keepBody) {
+        // Size the pooled buffer once from Content-Length instead of growing it
+        if (!transfer->sized) {
+            transfer->sized = true;
+            curl_off_t contentLength = -1;
+            curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+            size_t reserve = std::min(static_cast<size_t>(std::max<curl_off_t>(contentLength, 0)),
+                                      maxBytes ? std::min(maxBytes, MAX_RESERVE_BYTES) : MAX_RESERVE_BYTES);
+            if (reserve > transfer->body->capacity()) transfer->body->reserve(reserve);
+        }
+        transfer->body->append(static_cast<char*>(contents), length);
+    }
+    if (transfer->request.observer && length > 0) {
+        transfer->request.observer(static_cast<char*>(contents), length);
+    }
+    return transfer->truncated ? 0 : length;
+}
+
+// Callback function for libcurl to see each response header line
+size_t FetchEngine::headerCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    Transfer* transfer = static_cast<Transfer*>(userp);
+    size_t length = size * nitems;
+    std::string_view line(buffer, length);
+
+    // A status line starts the headers of a new response (after a redirect)
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        transfer->etag.clear();
+        transfer->lastModified.clear();
+        transfer->contentType.clear();
+        transfer->contentLength = -1;
+        transfer->status = 0;
+        size_t space = line.find(' ');
+        if (space != std::string_view::npos) {
+            std::from_chars(line.data() + space + 1, line.data() + line.size(), transfer->status);
+        }
+        return length;
+    }
+
+    // The blank line ends a response's headers: check them before any body
+    // is read. Returning less than length aborts the transfer.
+    if (line == "\r\n" || line == "\n") {
+        transfer->skipped = checkHeaders(transfer);
+        return transfer->skipped == SKIP_NONE ? length : 0;
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos) return length;
+    std::string_view name = line.substr(0, colon);
+    std::string_view value = line.substr(colon + 1);
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+    while (!value.empty() && (value.back() == '\r' || value.back() == '\n' || value.back() == ' ')) {
+        value.remove_suffix(1);
+    }
+
+    if (name.size() == 4 && strncasecmp(name.data(), "etag", 4) == 0) {
+        transfer->etag.assign(value.data(), value.size());
+    } else if (name.size() == 13 && strncasecmp(name.data(), "last-modified", 13) == 0) {
+        transfer->lastModified.assign(value.data(), value.size());
+    } else if (name.size() == 12 && strncasecmp(name.data(), "content-type", 12) == 0) {
+        transfer->contentType.assign(value.data(), value.size());
+    } else if (name.size() == 14 && strncasecmp(name.data(), "content-length", 14) == 0) {
+        curl_off_t contentLength = -1;
+        if (std::from_chars(value.data(), value.data() + value.size(), contentLength).ec == std::errc()) {
+            transfer->contentLength = contentLength;
+        }
+    }
+    return length;
+}
+
+// Apply the request's limits to the headers of a complete response
+SkipReason FetchEngine::checkHeaders(const Transfer* transfer) {
+    // Interim responses and redirects (followed by curl) are not the page
+    long status = transfer->status;
+    if (status < 200 || (status >= 300 && status < 400)) return SKIP_NONE;
+
+    // The type only matters for a successful response; an error page
+    // (4xx/5xx) is returned with its status, not counted as a non-HTML skip
+    const FetchLimits& limits = transfer->request.limits;
+    bool success = status < 300;
+    if (limits.htmlOnly && success && !transfer->contentType.empty() && !isHtmlType(transfer->contentType)) {
+        return SKIP_CONTENT_TYPE;
+    }
+    if (limits.maxBytes && !limits.truncate && transfer->contentLength > 0 &&
+        static_cast<size_t>(transfer->contentLength) > limits.maxBytes) {
+        return SKIP_CONTENT_LENGTH;
+    }
+    return SKIP_NONE;
+}
+
+FetchEngine::FetchEngine(const FetchEngineConfig& config) : config(config) {
+    multi = curl_multi_init();
+
+    // Multiplex requests to the same host over one HTTP/2 connection when possible
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, config.maxHostConnections);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, config.maxTotalConnections);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, config.maxTotalConnections);
+
+    // Add common headers (shared by every transfer)
+    headers = curl_slist_append(headers, "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+    headers = curl_slist_append(headers, "Accept-Language: en-US,en;q=0.9");
+    headers = curl_slist_append(headers, "Cache-Control: no-cache");
+
+    loopThread = std::thread(&FetchEngine::loop, this);
+}
+
+FetchEngine::~FetchEngine() {
+    stop();
+    for (Transfer* transfer : idleTransfers) {
+        curl_easy_cleanup(transfer->easy);
+        curl_slist_free_all(transfer->headers);
+        delete transfer;
+    }
+    curl_multi_cleanup(multi);
+    curl_slist_free_all(headers);
+}
+
+void FetchEngine::fetch(const std::string& url, Callback callback, ChunkObserver observer,
+                        const Validators& validators, const FetchLimits& limits, ReadyCheck ready) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!stopping) {
+            queue.push_back({url, std::move(callback), std::move(observer), validators, limits, std::move(ready)});
+            callback = nullptr;
+        }
+    }
+    if (callback) {
+        FetchResult result;
+        result.url = url;
+        result.code = CURLE_ABORTED_BY_CALLBACK;
+        result.error = "fetch engine stopped";
+        callback(std::move(result));
+        return;
+    }
+    curl_multi_wakeup(multi);
+}
+
+FetchResult FetchEngine::fetchSync(const std::string& url, ChunkObserver observer, const Validators& validators,
+                                   const FetchLimits& limits) {
+    std::promise<FetchResult> promise;
+    std::future<FetchResult> future = promise.get_future();
+    fetch(url, [&promise](FetchResult&& result) { promise.set_value(std::move(result)); }, std::move(observer),
+          validators, limits);
+    return future.get();
+}
+
+void FetchEngine::wake() {
+    curl_multi_wakeup(multi);
+}
+
+void FetchEngine::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopping) return;
+        stopping = true;
+    }
+    curl_multi_wakeup(multi);
+    if (loopThread.joinable()) loopThread.join();
+}
+
+FetchEngine::Transfer* FetchEngine::acquireTransfer() {
+    if (!idleTransfers.empty()) {
+        Transfer* transfer = idleTransfers.back();
+        idleTransfers.pop_back();
+        curl_easy_reset(transfer->easy);
+        return transfer;
+    }
+    Transfer* transfer = new Transfer();
+    transfer->engine = this;
+    transfer->easy = curl_easy_init();
+    return transfer;
+}
+
+void FetchEngine::configure(Transfer* transfer) {
+    CURL* curl = transfer->easy;
+    transfer->errorBuffer[0] = '\0';
+
+    curl_easy_setopt(curl, CURLOPT_URL, transfer->request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer);
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->errorBuffer);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 5L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, config.userAgent.c_str());
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, config.timeoutSec);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, config.connectTimeoutSec);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    // Enable automatic decompression (gzip, deflate, etc.)
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+
+    // Conditional requests get their own copy of the common headers
+    curl_slist_free_all(transfer->headers);
+    transfer->headers = nullptr;
+    const Validators& validators = transfer->request.validators;
+    if (validators.empty()) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    } else {
+        for (curl_slist* header = headers; header; header = header->next) {
+            transfer->headers = curl_slist_append(transfer->headers, header->data);
+        }
+        if (!validators.etag.empty()) {
+            transfer->headers = curl_slist_append(transfer->headers, ("If-None-Match: " + validators.etag).c_str());
+        }
+        if (!validators.lastModified.empty()) {
+            transfer->headers =
+                curl_slist_append(transfer->headers, ("If-Modified-Since: " + validators.lastModified).c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer->headers);
+    }
+
+    // Prefer HTTP/2 over TLS and wait for an existing connection to
+    // multiplex on rather than opening a new one to the same host
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // SSL verification
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+}
+
+// Move queued requests into the multi handle up to the in-flight limit
+void FetchEngine::startQueued() {
+    while (active.load() < config.maxInFlight) {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (queue.empty() || stopping) return;
+            request = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        Transfer* transfer = acquireTransfer();
+        transfer->request = std::move(request);
+        transfer->body = bodyBufferPool().acquire();
+        transfer->sized = false;
+        transfer->received = 0;
+        transfer->etag.clear();
+        transfer->lastModified.clear();
+        transfer->status = 0;
+        transfer->contentType.clear();
+        transfer->contentLength = -1;
+        transfer->skipped = SKIP_NONE;
+        transfer->truncated = false;
+        transfer->paused = false;
+        configure(transfer);
+
+        CURLMcode rc = curl_multi_add_handle(multi, transfer->easy);
+        active++;
+        if (rc != CURLM_OK) {
+            finish(transfer, CURLE_FAILED_INIT);
+        }
+    }
+}
+
+// Unpause the transfers whose ReadyCheck passes now. Resuming delivers the
+// held chunk at once, which may pause the transfer again.
+void FetchEngine::resumeReady() {
+    if (pausedTransfers.empty()) return;
+    std::vector<Transfer*> paused;
+    paused.swap(pausedTransfers);
+    for (Transfer* transfer : paused) {
+        if (!transfer->request.ready()) {
+            pausedTransfers.push_back(transfer);
+            continue;
+        }
+        transfer->paused = false;
+        curl_easy_pause(transfer->easy, CURLPAUSE_CONT);
+    }
+}
+
+namespace {
+
+// Record where a finished transfer spent its time. curl reports each phase
+// as microseconds from the start of the transfer (0 if it did not happen,
+// e.g. no connect or TLS handshake on a reused connection). Transfers cut
+// short by their limits are counted by reason, not as errors.
+void recordTimings(CURL* easy, CURLcode code, long connects, SkipReason skipped) {
+    if (skipped != SKIP_NONE) {
+        addCount(skipped == SKIP_CONTENT_TYPE     ? COUNTER_SKIPPED_CONTENT_TYPE
+                 : skipped == SKIP_CONTENT_LENGTH ? COUNTER_SKIPPED_CONTENT_LENGTH
+                                                  : COUNTER_SKIPPED_BODY_BYTES);
+        return;
+    }
+    if (code != CURLE_OK) {
+        addCount(COUNTER_FETCH_ERRORS);
+        return;
+    }
+    addCount(connects > 0 ? COUNTER_NEW_CONNECTIONS : COUNTER_REUSED_CONNECTIONS);
+
+    curl_off_t dns = 0, connect = 0, tls = 0, firstByte = 0, total = 0;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &firstByte);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+
+    ThreadMetrics& metrics = threadMetrics();
+    curl_off_t ready = std::max(connect, tls);  // connection usable for the request
+    if (connects > 0) {
+        metrics.record(STAGE_DNS, dns);
+        metrics.record(STAGE_CONNECT, std::max<curl_off_t>(0, connect - dns));
+        if (tls > 0) metrics.record(STAGE_TLS, std::max<curl_off_t>(0, tls - connect));
+    }
+    if (firstByte > 0) {
+        metrics.record(STAGE_FIRST_BYTE, std::max<curl_off_t>(0, firstByte - ready));
+        metrics.record(STAGE_TRANSFER, std::max<curl_off_t>(0, total - firstByte));
+    }
+    metrics.record(STAGE_FETCH, total);
+}
+
+} // namespace
+
+void FetchEngine::finish(Transfer* transfer, CURLcode code) {
+    FetchResult result;
+    result.url = std::move(transfer->request.url);
+    // Returning 0 from writeCallback to stop a truncated body is not an error
+    if (transfer->truncated && code == CURLE_WRITE_ERROR) code = CURLE_OK;
+    result.truncated = transfer->truncated;
+    result.code = code;
+    if (code != CURLE_OK) {
+        result.error = transfer->errorBuffer[0] ? transfer->errorBuffer : curl_easy_strerror(code);
+    }
+    if (code != CURLE_OK && transfer->skipped != SKIP_NONE) {
+        result.skipped = transfer->skipped;
+        if (result.skipped == SKIP_CONTENT_TYPE) {
+            result.error = "skipped, not HTML (" + transfer->contentType + ")";
+        } else if (result.skipped == SKIP_CONTENT_LENGTH) {
+            result.error = "skipped, Content-Length " + std::to_string(transfer->contentLength) + " over " +
+                           std::to_string(transfer->request.limits.maxBytes) + " bytes";
+        } else {
+            result.error = "skipped, body over " + std::to_string(transfer->request.limits.maxBytes) + " bytes";
+        }
+    }
+
+    curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &result.status);
+    char* effective = nullptr;
+    curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &effective);
+    if (effective) result.effectiveUrl = effective;
+
+    long connects = 0;
+    curl_easy_getinfo(transfer->easy, CURLINFO_NUM_CONNECTS, &connects);
+    result.reusedConnection = (code == CURLE_OK && connects == 0);
+    if (result.reusedConnection) reusedConnections++;
+    else if (connects > 0) newConnections++;
+    recordTimings(transfer->easy, code, connects, result.skipped);
+    addCount(COUNTER_DOWNLOADED_BYTES, transfer->received);
+
+    result.body = std::move(transfer->body);
+    result.etag = std::move(transfer->etag);
+    result.lastModified = std::move(transfer->lastModified);
+    Callback callback = std::move(transfer->request.callback);
+
+    if (transfer->paused) {
+        pausedTransfers.erase(std::find(pausedTransfers.begin(), pausedTransfers.end(), transfer));
+        transfer->paused = false;
+    }
+    transfer->request = Request();
+    idleTransfers.push_back(transfer);
+    active--;
+    completed++;
+
+    if (callback) {
+        try {
+            callback(std::move(result));
+        } catch (const std::exception& e) {
+            std::cerr << "Fetch callback failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+void FetchEngine::loop() {
+    while (true) {
+        startQueued();
+        resumeReady();
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int remaining;
+        while ((msg = curl_multi_info_read(multi, &remaining))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+            CURLcode code = msg->data.result;
+            curl_multi_remove_handle(multi, msg->easy_handle);
+            finish(transfer, code);
+        }
+
+        bool canStartMore;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (stopping && active.load() == 0) break;
+            canStartMore = !stopping && !queue.empty() && active.load() < config.maxInFlight;
+        }
+
+        // Sleep until a socket is ready, a new request arrives or a timer fires
+        if (!canStartMore) {
+            curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+        }
+    }
+
+    // Fail anything still queued after stop()
+    std::deque<Request> leftover;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        leftover.swap(queue);
+    }
+    for (auto& request : leftover) {
+        FetchResult result;
+        result.url = request.url;
+        result.code = CURLE_ABORTED_BY_CALLBACK;
+        result.error = "fetch engine stopped";
+        if (request.callback) request.callback(std::move(result));
+    }
+}
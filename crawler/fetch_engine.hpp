@@ -0,0 +1,172 @@
+#ifndef FETCH_ENGINE_HPP
+#define FETCH_ENGINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+#include "body_buffer.hpp"
+
+// Why a transfer was cut short by its FetchLimits
+enum SkipReason {
+    SKIP_NONE,
+    SKIP_CONTENT_TYPE,    // the response is not HTML
+    SKIP_CONTENT_LENGTH,  // Content-Length is over the byte budget
+    SKIP_BODY_BYTES,      // the body grew past the budget while streaming
+};
+
+// Outcome of one transfer handed back by the fetch engine
+struct FetchResult {
+    std::string url;           // URL as requested
+    std::string effectiveUrl;  // URL after redirects
+    long status = 0;           // HTTP status code (0 if no response)
+    CURLcode code = CURLE_OK;
+    std::string error;         // curl error text when code != CURLE_OK
+    BodyBuffer body;           // pooled; shared with the parser and storage
+    bool reusedConnection = false;
+    std::string etag;          // validators of the final response, if sent
+    std::string lastModified;
+    SkipReason skipped = SKIP_NONE;  // set when the limits aborted the transfer (code is then an error)
+    bool truncated = false;          // FetchLimits::truncate cut the body at maxBytes (code is OK)
+
+    bool ok() const { return code == CURLE_OK; }
+    bool notModified() const { return status == 304; }
+};
+
+// Validators from an earlier fetch of the same URL. When set, the request is
+// conditional (If-None-Match / If-Modified-Since) and an unchanged page
+// comes back as 304 with no body.
+struct Validators {
+    std::string etag;
+    std::string lastModified;
+
+    bool empty() const { return etag.empty() && lastModified.empty(); }
+};
+
+// What a transfer may download. Checked on the final response headers
+// (redirects and 1xx responses are not checked) and again on every body
+// chunk; a transfer that breaks a limit is aborted without reading the rest.
+struct FetchLimits {
+    bool htmlOnly = false;  // reject a 2xx Content-Type other than text/html or application/xhtml+xml
+    size_t maxBytes = 0;    // reject a larger Content-Length or decoded body (0 for no limit)
+    bool keepBody = true;   // false: chunks only go to the observer and the body stays empty
+    bool truncate = false;  // at maxBytes keep what fits and end the transfer as a success
+};
+
+struct FetchEngineConfig {
+    size_t maxInFlight = 256;       // transfers driven concurrently by the event loop
+    long maxHostConnections = 4;    // per-host connection cap (HTTP/2 streams share these)
+    long maxTotalConnections = 128;
+    long timeoutSec = 15;
+    long connectTimeoutSec = 10;
+    std::string userAgent = "Mozilla/5.0 (compatible; CustomSearchBot/1.0; +http://example.com/bot)";
+};
+
+// Non-blocking HTTP fetcher driven by one curl_multi event loop thread.
+// Requests from any thread are queued and multiplexed over a shared
+// connection cache (keep-alive and HTTP/2 streams to the same host), and
+// each completed transfer is handed to its callback on the loop thread.
+class FetchEngine {
+public:
+    using Callback = std::function<void(FetchResult&&)>;
+    // Sees each body chunk as it arrives (on the loop thread), e.g. to feed
+    // an incremental tokenizer while the rest of the page downloads
+    using ChunkObserver = std::function<void(const char* data, size_t length)>;
+    // Asked (on the loop thread) before each chunk goes to the observer.
+    // While it returns false the transfer is paused and reads nothing more;
+    // the consumer calls wake() once it has caught up.
+    using ReadyCheck = std::function<bool()>;
+
+    explicit FetchEngine(const FetchEngineConfig& config = FetchEngineConfig());
+    ~FetchEngine();
+
+    FetchEngine(const FetchEngine&) = delete;
+    FetchEngine& operator=(const FetchEngine&) = delete;
+
+    // Queue a transfer. Callbacks run on the event loop thread and must
+    // not block; hand heavy work (parsing, storage) to another thread.
+    void fetch(const std::string& url, Callback callback, ChunkObserver observer = nullptr,
+               const Validators& validators = Validators(), const FetchLimits& limits = FetchLimits(),
+               ReadyCheck ready = nullptr);
+
+    // Queue a transfer and wait for it (for callers that are still synchronous)
+    FetchResult fetchSync(const std::string& url, ChunkObserver observer = nullptr,
+                          const Validators& validators = Validators(), const FetchLimits& limits = FetchLimits());
+
+    // Ask paused transfers again whether their consumer is ready
+    void wake();
+
+    // Finish in-flight transfers, fail queued ones and join the loop thread
+    void stop();
+
+    size_t inFlight() const { return active.load(); }
+    size_t completedCount() const { return completed.load(); }
+    size_t newConnectionCount() const { return newConnections.load(); }
+    size_t reusedConnectionCount() const { return reusedConnections.load(); }
+
+private:
+    struct Request {
+        std::string url;
+        Callback callback;
+        ChunkObserver observer;
+        Validators validators;
+        FetchLimits limits;
+        ReadyCheck ready;
+    };
+
+    struct Transfer {
+        FetchEngine* engine = nullptr;
+        CURL* easy = nullptr;
+        Request request;
+        std::shared_ptr<std::string> body;  // from bodyBufferPool()
+        bool sized = false;                 // reserved from Content-Length yet
+        size_t received = 0;                // body bytes so far (kept or not)
+        curl_slist* headers = nullptr;      // common headers plus validators, if any
+        std::string etag;                   // from the response headers
+        std::string lastModified;
+        long status = 0;                    // of the response whose headers are being read
+        std::string contentType;
+        curl_off_t contentLength = -1;
+        SkipReason skipped = SKIP_NONE;
+        bool truncated = false;             // stopped at maxBytes with FetchLimits::truncate
+        bool paused = false;                // waiting for ReadyCheck (in pausedTransfers)
+        char errorBuffer[CURL_ERROR_SIZE];
+    };
+
+    static size_t writeCallback(void* contents, size_t size, size_t nmemb, void* userp);
+    static size_t headerCallback(char* buffer, size_t size, size_t nitems, void* userp);
+    static SkipReason checkHeaders(const Transfer* transfer);
+
+    void loop();
+    void startQueued();
+    void resumeReady();
+    void finish(Transfer* transfer, CURLcode code);
+    Transfer* acquireTransfer();
+    void configure(Transfer* transfer);
+
+    FetchEngineConfig config;
+    CURLM* multi = nullptr;
+    curl_slist* headers = nullptr;
+
+    std::mutex queueMutex;
+    std::deque<Request> queue;
+    bool stopping = false;
+
+    std::vector<Transfer*> idleTransfers;  // reused easy handles (loop thread only)
+    std::vector<Transfer*> pausedTransfers;  // held back by their ReadyCheck (loop thread only)
+
+    std::atomic<size_t> active{0};
+    std::atomic<size_t> completed{0};
+    std::atomic<size_t> newConnections{0};
+    std::atomic<size_t> reusedConnections{0};
+
+    std::thread loopThread;
+};
+
+#endif // FETCH_ENGINE_HPP
@@ -0,0 +1,447 @@
+#include "frontier.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "url_priority.hpp"
+#include "url_seen.hpp"
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'F', 'R', 'O', 'N', 'T', 'I', 'R', '1'};
+
+// Record layout: uint32 URL length, int32 depth, URL bytes (host byte order)
+const size_t RECORD_HEADER = 8;
+
+struct Checkpoint {
+    uint64_t headSegment;
+    uint64_t headOffset;
+    int64_t pageCount;
+};
+
+bool fileSize(const std::string& path, uint64_t& size) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+// mkdir -p
+bool makeDirs(const std::string& path) {
+    for (size_t pos = path.find('/', 1);; pos = path.find('/', pos + 1)) {
+        std::string prefix = path.substr(0, pos);
+        if (!prefix.empty() && mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (pos == std::string::npos) return true;
+    }
+}
+
+// Delete the checkpoint and segment files of a frontier directory (its
+// subdirectories are left alone)
+void removeFrontierFiles(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    while (dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name == "checkpoint" || name == "checkpoint.tmp" ||
+            (name.size() > 4 && name.compare(name.size() - 4, 4, ".seg") == 0)) {
+            std::remove((dir + "/" + name).c_str());
+        }
+    }
+    closedir(d);
+}
+
+// Length of the complete records at the start of data (a crash can leave
+// the last one torn)
+size_t completeRecords(const char* data, size_t size) {
+    size_t offset = 0;
+    while (offset + RECORD_HEADER <= size) {
+        uint32_t length;
+        std::memcpy(&length, data + offset, sizeof(length));
+        if (offset + RECORD_HEADER + length > size) break;
+        offset += RECORD_HEADER + length;
+    }
+    return offset;
+}
+
+} // namespace
+
+DiskFrontier::DiskFrontier(const std::string& dir, const FrontierConfig& config) : dir(dir), config(config) {
+    if (!makeDirs(dir)) {
+        std::cerr << "Cannot create frontier directory " << dir << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    FILE* file = std::fopen((dir + "/checkpoint").c_str(), "rb");
+    if (file) {
+        char magic[sizeof(CHECKPOINT_MAGIC)];
+        Checkpoint saved;
+        if (std::fread(magic, sizeof(magic), 1, file) == 1 && std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0 &&
+            std::fread(&saved, sizeof(saved), 1, file) == 1 && saved.headSegment > 0) {
+            headSegment = saved.headSegment;
+            headOffset = saved.headOffset;
+            savedPages = static_cast<int>(saved.pageCount);
+            restored = true;
+        } else {
+            std::cerr << "Ignoring invalid frontier checkpoint in " << dir << std::endl;
+        }
+        std::fclose(file);
+    }
+
+    // Segments before the head were consumed but not yet removed
+    for (uint64_t s = headSegment - 1; s > 0 && std::remove(segmentPath(s).c_str()) == 0; s--) {}
+    firstSegment = headSegment;
+
+    // The newest segment may end in a record torn by a crash
+    tailSegment = headSegment;
+    uint64_t size = 0;
+    while (fileSize(segmentPath(tailSegment + 1), size)) tailSegment++;
+    uint64_t validBytes = 0;
+    if (fileSize(segmentPath(tailSegment), size) && size > 0) {
+        restored = true;
+        int fd = open(segmentPath(tailSegment).c_str(), O_RDONLY);
+        void* data = fd >= 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if (data != MAP_FAILED) {
+            validBytes = completeRecords(static_cast<const char*>(data), size);
+            munmap(data, size);
+        }
+        if (fd >= 0) close(fd);
+    }
+    if (!openTail(tailSegment, validBytes)) return;
+    mapHead();
+}
+
+DiskFrontier::~DiskFrontier() {
+    flush();
+    unmapHead();
+    if (tail) std::fclose(tail);
+}
+
+std::string DiskFrontier::segmentPath(uint64_t segment) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%08llu.seg", static_cast<unsigned long long>(segment));
+    return dir + name;
+}
+
+bool DiskFrontier::openTail(uint64_t segment, uint64_t validBytes) {
+    if (tail) std::fclose(tail);
+    std::string path = segmentPath(segment);
+    uint64_t size = 0;
+    if (fileSize(path, size) && size > validBytes && truncate(path.c_str(), validBytes) != 0) {
+        std::cerr << "Cannot truncate frontier segment " << path << ": " << std::strerror(errno) << std::endl;
+    }
+    tail = std::fopen(path.c_str(), "ab");
+    if (!tail) {
+        std::cerr << "Cannot open frontier segment " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    tailSegment = segment;
+    tailSize = validBytes;
+    return true;
+}
+
+bool DiskFrontier::mapHead() {
+    unmapHead();
+    std::string path = segmentPath(headSegment);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    // The head may still be the tail, so only map what has been flushed
+    struct stat st;
+    size_t size = fstat(fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+    if (headSegment == tailSegment && size > tailSize) size = tailSize;
+    if (size > 0) {
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            headMap = static_cast<const char*>(data);
+            headSize = size;
+            madvise(data, size, MADV_SEQUENTIAL);
+        } else {
+            std::cerr << "Cannot map frontier segment " << path << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+    close(fd);
+    if (headOffset > headSize) headOffset = headSize;
+    return headMap != nullptr;
+}
+
+void DiskFrontier::unmapHead() {
+    if (headMap) munmap(const_cast<char*>(headMap), headSize);
+    headMap = nullptr;
+    headSize = 0;
+}
+
+void DiskFrontier::push(const std::string& url, int depth) {
+    uint32_t length = static_cast<uint32_t>(url.size());
+    int32_t depth32 = depth;
+    char header[RECORD_HEADER];
+    std::memcpy(header, &length, sizeof(length));
+    std::memcpy(header + sizeof(length), &depth32, sizeof(depth32));
+    pending.append(header, sizeof(header));
+    pending.append(url);
+}
+
+bool DiskFrontier::flush() {
+    if (pending.empty() || !tail) return true;
+
+    // Roll over to a new segment only when there is something to write, so
+    // every segment after the head holds records
+    if (tailSize >= config.segmentBytes && !openTail(tailSegment + 1, 0)) return false;
+
+    if (std::fwrite(pending.data(), 1, pending.size(), tail) != pending.size() || std::fflush(tail) != 0) {
+        std::cerr << "Failed to append to frontier segment " << segmentPath(tailSegment) << std::endl;
+        return false;
+    }
+    tailSize += pending.size();
+    pending.clear();
+    return true;
+}
+
+bool DiskFrontier::pop(std::string& url, int& depth) {
+    if (!flush()) return false;
+
+    while (true) {
+        if (headOffset + RECORD_HEADER <= headSize) {
+            uint32_t length;
+            int32_t depth32;
+            std::memcpy(&length, headMap + headOffset, sizeof(length));
+            std::memcpy(&depth32, headMap + headOffset + sizeof(length), sizeof(depth32));
+            url.assign(headMap + headOffset + RECORD_HEADER, length);
+            depth = depth32;
+            headOffset += RECORD_HEADER + length;
+            return true;
+        }
+
+        // The mapping is used up: map what was appended since, or move on
+        // to the next segment
+        if (headSegment == tailSegment) {
+            if (tailSize <= headSize) return false;
+        } else {
+            uint64_t size = 0;
+            if (!fileSize(segmentPath(headSegment), size) || size <= headSize) {
+                headSegment++;
+                headOffset = 0;
+            }
+        }
+        if (!mapHead()) return false;
+    }
+}
+
+bool DiskFrontier::empty() const {
+    return pending.empty() && headSegment == tailSegment && headOffset >= tailSize;
+}
+
+uint64_t DiskFrontier::queuedBytes() const {
+    uint64_t total = pending.size();
+    for (uint64_t s = headSegment; s <= tailSegment; s++) {
+        uint64_t size = 0;
+        if (s == tailSegment) size = tailSize;
+        else fileSize(segmentPath(s), size);
+        total += size;
+    }
+    return total - std::min(total, headOffset);
+}
+
+bool DiskFrontier::checkpoint(int pageCount) {
+    if (!flush()) return false;
+    if (checkpointedPages == pageCount && checkpointedHead[0] == headSegment && checkpointedHead[1] == headOffset &&
+        checkpointedTail[0] == tailSegment && checkpointedTail[1] == tailSize) {
+        return true;
+    }
+
+    // The records the checkpoint points into must reach the disk first
+    if (tail) fdatasync(fileno(tail));
+
+    // Write to a temporary file and rename, so a crash never leaves a torn file
+    std::string path = dir + "/checkpoint";
+    std::string tmpPath = path + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot write frontier checkpoint: " << tmpPath << std::endl;
+        return false;
+    }
+    Checkpoint saved = {headSegment, headOffset, pageCount};
+    bool ok = std::fwrite(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC), 1, file) == 1 &&
+              std::fwrite(&saved, sizeof(saved), 1, file) == 1 && std::fflush(file) == 0 &&
+              fdatasync(fileno(file)) == 0;
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to save frontier checkpoint: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    for (; firstSegment < headSegment; firstSegment++) std::remove(segmentPath(firstSegment).c_str());
+    checkpointedHead[0] = headSegment;
+    checkpointedHead[1] = headOffset;
+    checkpointedTail[0] = tailSegment;
+    checkpointedTail[1] = tailSize;
+    checkpointedPages = pageCount;
+    return true;
+}
+
+static_assert(LINK_PRIORITY_LEVELS <= 32, "PriorityFrontier keeps one bit per level");
+
+PriorityFrontier::PriorityFrontier(const std::string& dir, const FrontierConfig& config) : config(config) {
+    int levelCount = config.bestFirst ? LINK_PRIORITY_LEVELS : 1;
+    for (int level = 0; level < levelCount; level++) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "/p%02d", level);
+        levels.push_back(std::make_unique<DiskFrontier>(dir + name, config));
+        if (!levels.back()->ok()) return;
+        if (levels.back()->resumed()) {
+            restored = true;
+            savedPages = std::max(savedPages, levels.back()->savedPageCount());
+        }
+        if (!levels.back()->empty()) nonEmpty |= 1u << level;
+    }
+    if (config.bestFirst) inlinks.assign(config.inlinkSlots, 0);
+    migrateFifo(dir);
+    if (!config.bestFirst) mergeLevels(dir);
+}
+
+bool PriorityFrontier::ok() const {
+    for (const auto& level : levels) {
+        if (!level->ok()) return false;
+    }
+    return !levels.empty();
+}
+
+// Queue the URLs of an older single-FIFO frontier by depth alone, save the
+// levels and remove the old files
+bool PriorityFrontier::migrateFifo(const std::string& dir) {
+    uint64_t size = 0;
+    if (!fileSize(dir + "/checkpoint", size) && !fileSize(dir + "/00000001.seg", size)) return true;
+
+    size_t moved = 0;
+    int pageCount = 0;
+    {
+        DiskFrontier fifo(dir, config);
+        if (!fifo.ok()) return false;
+        pageCount = fifo.savedPageCount();
+        std::string url;
+        int depth = 0;
+        while (fifo.pop(url, depth)) {
+            pushToLevel(url, depth, config.bestFirst ? linkPriority(url, {depth, 1, -1}) : 0);
+            moved++;
+        }
+    }
+    if (!checkpoint(pageCount)) return false;
+    restored = true;
+    savedPages = std::max(savedPages, pageCount);
+
+    removeFrontierFiles(dir);
+    std::cerr << "Moved " << moved << " URLs of the FIFO frontier in " << dir << " into priority levels"
+              << std::endl;
+    return true;
+}
+
+// Breadth-first mode only reads p00: queue the URLs a best-first run left in
+// the higher levels there, save it and remove the other levels
+bool PriorityFrontier::mergeLevels(const std::string& dir) {
+    size_t moved = 0;
+    int pageCount = savedPages;
+    std::vector<std::string> merged;
+    for (int level = 1; level < LINK_PRIORITY_LEVELS; level++) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "/p%02d", level);
+        struct stat st;
+        if (stat((dir + name).c_str(), &st) != 0) continue;
+
+        DiskFrontier old(dir + name, config);
+        if (!old.ok()) return false;
+        if (old.resumed()) {
+            restored = true;
+            pageCount = std::max(pageCount, old.savedPageCount());
+        }
+        std::string url;
+        int depth = 0;
+        while (old.pop(url, depth)) {
+            pushToLevel(url, depth, 0);
+            moved++;
+        }
+        merged.push_back(dir + name);
+    }
+    if (merged.empty()) return true;
+    if (!checkpoint(pageCount)) return false;
+    savedPages = pageCount;
+
+    for (const auto& path : merged) {
+        removeFrontierFiles(path);
+        rmdir(path.c_str());
+    }
+    std::cerr << "Moved " << moved << " URLs of the priority levels in " << dir << " into breadth-first order"
+              << std::endl;
+    return true;
+}
+
+void PriorityFrontier::pushToLevel(const std::string& url, int depth, int level) {
+    levels[level]->push(url, depth);
+    nonEmpty |= 1u << level;
+}
+
+void PriorityFrontier::push(const std::string& url, int depth, int linkFlags, time_t lastModified) {
+    if (levels.size() == 1) {
+        pushToLevel(url, depth, 0);
+        return;
+    }
+
+    // A slot holds one URL's count under the top 24 bits of its fingerprint;
+    // a URL that finds another one there takes the slot and starts at 1
+    uint64_t fingerprint = UrlSeenFilter::fingerprint(url);
+    uint32_t& slot = inlinks[fingerprint & (inlinks.size() - 1)];
+    uint32_t tag = static_cast<uint32_t>(fingerprint >> 40) << 8;
+    if ((slot & ~0xffu) != tag) slot = tag;
+    if ((slot & 0xff) < 0xff) slot++;
+    unsigned count = slot & 0xff;
+
+    // Queued when first found, then only when a doubling moves it up a level
+    int level = linkPriority(url, {depth, count, linkFlags, lastModified});
+    if (count > 1) {
+        if ((count & (count - 1)) != 0 || linkPriority(url, {depth, count / 2, linkFlags, lastModified}) >= level) {
+            return;
+        }
+        requeued++;
+    }
+    pushToLevel(url, depth, level);
+}
+
+bool PriorityFrontier::flush() {
+    bool ok = true;
+    for (auto& level : levels) ok = level->flush() && ok;
+    return ok;
+}
+
+bool PriorityFrontier::pop(std::string& url, int& depth) {
+    while (nonEmpty) {
+        int level = 31 - __builtin_clz(nonEmpty);
+        if (levels[level]->pop(url, depth)) return true;
+        nonEmpty &= ~(1u << level);
+    }
+    return false;
+}
+
+bool PriorityFrontier::empty() const {
+    for (const auto& level : levels) {
+        if (!level->empty()) return false;
+    }
+    return true;
+}
+
+uint64_t PriorityFrontier::queuedBytes() const {
+    uint64_t total = 0;
+    for (const auto& level : levels) total += level->queuedBytes();
+    return total;
+}
+
+bool PriorityFrontier::checkpoint(int pageCount) {
+    bool ok = true;
+    for (auto& level : levels) ok = level->checkpoint(pageCount) && ok;
+    return ok;
+}
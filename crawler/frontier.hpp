@@ -0,0 +1,145 @@
+#ifndef FRONTIER_HPP
+#define FRONTIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct FrontierConfig {
+    size_t segmentBytes = 4 << 20;  // start a new segment file past this size
+    bool bestFirst = true;          // PriorityFrontier: order by linkPriority() instead of FIFO
+    size_t inlinkSlots = 1 << 16;   // PriorityFrontier: in-link counters (a power of two)
+};
+
+// Crawl frontier of one site: a FIFO of (url, depth) kept in append-only
+// segment files in its own directory. URLs pushed while a page is crawled
+// are buffered and appended by flush(); they are read back through an mmap
+// of the oldest segment, so memory use does not grow with the queue.
+//
+// checkpoint() records the read position. A frontier opened on the same
+// directory resumes from the last checkpoint: URLs popped after it are
+// popped again, URLs appended after it are kept. Not thread-safe; a site's
+// frontier is only used by the worker crawling its host.
+class DiskFrontier {
+public:
+    explicit DiskFrontier(const std::string& dir, const FrontierConfig& config = FrontierConfig());
+    ~DiskFrontier();
+
+    DiskFrontier(const DiskFrontier&) = delete;
+    DiskFrontier& operator=(const DiskFrontier&) = delete;
+
+    bool ok() const { return tail != nullptr; }
+
+    // A checkpoint was found; savedPageCount() is the count stored with it
+    bool resumed() const { return restored; }
+    int savedPageCount() const { return savedPages; }
+
+    void push(const std::string& url, int depth);
+
+    // Append the pushed URLs to the tail segment. Call before the page that
+    // found them is stored, so a crash cannot lose them.
+    bool flush();
+
+    // Take the oldest URL; returns false when the frontier is empty
+    bool pop(std::string& url, int& depth);
+
+    bool empty() const;
+
+    // Bytes of queued records (on disk and buffered)
+    uint64_t queuedBytes() const;
+
+    // Save the read position with the site's page count and drop the
+    // segments before it (nothing is written if none of them changed)
+    bool checkpoint(int pageCount);
+
+private:
+    std::string segmentPath(uint64_t segment) const;
+    bool openTail(uint64_t segment, uint64_t validBytes);
+    bool mapHead();
+    void unmapHead();
+
+    std::string dir;
+    FrontierConfig config;
+    bool restored = false;
+    int savedPages = 0;
+
+    // Read side: the oldest segment, mapped read-only
+    uint64_t firstSegment = 1;  // oldest file still on disk
+    uint64_t headSegment = 1;
+    uint64_t headOffset = 0;
+    const char* headMap = nullptr;
+    size_t headSize = 0;  // bytes mapped
+
+    // Write side: the newest segment, appended to
+    uint64_t tailSegment = 1;
+    uint64_t tailSize = 0;  // bytes flushed to it
+    FILE* tail = nullptr;
+    std::string pending;  // records pushed since the last flush
+
+    // State at the last checkpoint() that was written
+    uint64_t checkpointedHead[2] = {0, 0};  // segment, offset
+    uint64_t checkpointedTail[2] = {0, 0};  // segment, size
+    int checkpointedPages = -1;
+};
+
+// Best-first crawl frontier of one site: a bucket queue with one
+// DiskFrontier per linkPriority() level (LINK_PRIORITY_LEVELS of them, in
+// subdirectories p00, p01, ... of its directory). push() scores the URL
+// and appends it to its level; pop() takes the oldest URL of the highest
+// non-empty level, found from a bitmask, so both stay O(1) however many
+// URLs are queued. Within a level URLs come out in BFS order, and with
+// bestFirst off everything goes to one level, which is plain BFS.
+//
+// In-links are counted in a fixed table of saturating counters indexed by
+// URL fingerprint. A URL is queued when it is first found and again when a
+// doubling of its count raises its level; the crawler skips the copies
+// whose URL it has already crawled. URLs that share a slot evict each
+// other, which restarts a count (and queues one more copy) but never keeps
+// a new URL out of the frontier. The counts are not checkpointed and start
+// over after a restart.
+//
+// A directory holding a FIFO frontier from an older version (segments at
+// its top level) is moved into the levels when opened. With bestFirst off
+// only p00 is used, and the URLs of any higher level are moved into it.
+class PriorityFrontier {
+public:
+    explicit PriorityFrontier(const std::string& dir, const FrontierConfig& config = FrontierConfig());
+
+    PriorityFrontier(const PriorityFrontier&) = delete;
+    PriorityFrontier& operator=(const PriorityFrontier&) = delete;
+
+    bool ok() const;
+    bool resumed() const { return restored; }
+    int savedPageCount() const { return savedPages; }
+
+    // Queue a URL found at depth; linkFlags are its LinkFlag bits (-1 if
+    // unknown), lastModified a sitemap's <lastmod> for it (0 if none)
+    void push(const std::string& url, int depth, int linkFlags = -1, time_t lastModified = 0);
+    bool flush();
+    bool pop(std::string& url, int& depth);
+    bool empty() const;
+    uint64_t queuedBytes() const;
+    bool checkpoint(int pageCount);
+
+    // URLs queued again after their in-link count raised their level
+    size_t requeuedCount() const { return requeued; }
+
+private:
+    void pushToLevel(const std::string& url, int depth, int level);
+    bool migrateFifo(const std::string& dir);
+    bool mergeLevels(const std::string& dir);
+
+    FrontierConfig config;
+    std::vector<std::unique_ptr<DiskFrontier>> levels;
+    uint32_t nonEmpty = 0;  // bit per level that may hold URLs
+    std::vector<uint32_t> inlinks;  // fingerprint tag << 8 | saturating count
+    bool restored = false;
+    int savedPages = 0;
+    size_t requeued = 0;
+};
+
+#endif // FRONTIER_HPP
@@ -0,0 +1,567 @@
+#include "html_parser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+
+#include "page_arena.hpp"
+#include "text_normalize.hpp"
+
+namespace {
+
+// Content is capped at this many bytes (plus "...")
+const size_t MAX_CONTENT_BYTES = 2000;
+
+// Content areas searched (in this order) when a page has no meta description
+enum ContentArea : unsigned {
+    AREA_ARTICLE = 1u << 0,
+    AREA_MAIN = 1u << 1,
+    AREA_BODY = 1u << 2
+};
+
+struct Paragraph {
+    std::pmr::string text;
+    unsigned areas;  // content areas this paragraph sits in
+};
+
+struct Image {
+    GumboNode* node;
+    unsigned areas;
+};
+
+struct Href {
+    const char* value;  // owned by the Gumbo tree
+    uint8_t flags;      // LinkFlag bits of this anchor
+};
+
+// A text buffer being filled from the text nodes below an element. Text is
+// only taken at the skip depth the capture started at, so script/style
+// inside the element is left out just like extractText does.
+struct Capture {
+    std::pmr::string* buffer;
+    int skipDepth;
+};
+
+// Everything collected during the single traversal of a page, allocated
+// from the same resource as the page
+struct Extraction {
+    PageData& data;
+    std::pmr::memory_resource* resource;
+    std::pmr::map<std::pmr::string, size_t> uniqueLinks;  // Avoid duplicates (value: index in outgoingLinks)
+
+    bool collectLinks = true;
+    bool titleFound = false;
+    bool baseFound = false;
+
+    // Document base URL (the page URL unless there is a <base href>). URLs
+    // are resolved after the traversal so a late <base> still applies; until
+    // then they are kept as the attribute strings owned by the Gumbo tree.
+    std::pmr::string baseUrl;
+    std::pmr::vector<Href> hrefs;
+    const char* faviconHref = nullptr;
+    int boilerplateDepth = 0;  // nav/header/footer/aside elements around the current node
+
+    // First ARTICLE, MAIN and BODY in document order and which of them
+    // the traversal is currently inside
+    GumboNode* areaNodes[3] = {nullptr, nullptr, nullptr};
+    unsigned activeAreas = 0;
+
+    std::pmr::deque<Paragraph> paragraphs;  // deque keeps captured buffers stable
+    std::pmr::vector<Image> images;
+
+    std::pmr::vector<Capture> captures;
+    int skipDepth = 0;
+
+    Extraction(PageData& data, std::pmr::memory_resource* resource)
+        : data(data), resource(resource), uniqueLinks(resource), baseUrl(data.url, resource), hrefs(resource),
+          paragraphs(resource), images(resource), captures(resource) {}
+};
+
+// Attribute value without copying it (nullptr if absent)
+const char* findAttribute(GumboNode* node, const char* name) {
+    GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, name);
+    return attr ? attr->value : nullptr;
+}
+
+bool isSkippedTextTag(GumboTag tag) {
+    return tag == GUMBO_TAG_SCRIPT || tag == GUMBO_TAG_STYLE ||
+           tag == GUMBO_TAG_NOSCRIPT || tag == GUMBO_TAG_IFRAME;
+}
+
+bool attributeIs(GumboNode* node, const char* name, const char* value) {
+    const char* actual = findAttribute(node, name);
+    return actual && std::strcmp(actual, value) == 0;
+}
+
+void handleMeta(GumboNode* node, Extraction& ex) {
+    // Meta description
+    if (ex.data.description.empty()) {
+        if (attributeIs(node, "name", "description") || attributeIs(node, "property", "og:description")) {
+            const char* content = findAttribute(node, "content");
+            if (content) ex.data.description = content;
+        }
+    }
+
+    // Keywords/tags
+    if (attributeIs(node, "name", "keywords")) {
+        const char* content = findAttribute(node, "content");
+        std::string_view keywords = content ? content : "";
+        // Split by comma
+        while (!keywords.empty()) {
+            size_t comma = keywords.find(',');
+            std::string_view tag = keywords.substr(0, comma);
+            keywords = comma == std::string_view::npos ? std::string_view() : keywords.substr(comma + 1);
+
+            // Trim whitespace
+            size_t first = tag.find_first_not_of(" \n\r\t");
+            if (first == std::string_view::npos) continue;
+            ex.data.tags.emplace_back(tag.substr(first, tag.find_last_not_of(" \n\r\t") - first + 1));
+        }
+    }
+}
+
+void handleBase(GumboNode* node, Extraction& ex) {
+    // Only the first <base> with an href counts
+    if (ex.baseFound) return;
+    const char* href = findAttribute(node, "href");
+    if (!href) return;
+    ex.baseFound = true;
+
+    std::string resolved;
+    if (resolveLinkHref(href, ex.data.url, resolved)) ex.baseUrl = resolved;
+}
+
+void handleFavicon(GumboNode* node, Extraction& ex) {
+    if (ex.faviconHref) return;
+    const char* rel = findAttribute(node, "rel");
+    if (!rel || !std::strstr(rel, "icon")) return;
+
+    const char* href = findAttribute(node, "href");
+    if (href && *href) ex.faviconHref = href;
+}
+
+// Does the subtree hold a text node with something other than whitespace?
+bool hasVisibleText(GumboNode* node) {
+    if (node->type == GUMBO_NODE_TEXT) {
+        for (const char* c = node->v.text.text; *c; c++) {
+            if (!std::isspace(static_cast<unsigned char>(*c))) return true;
+        }
+        return false;
+    }
+    if (node->type != GUMBO_NODE_ELEMENT || isSkippedTextTag(node->v.element.tag)) return false;
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        if (hasVisibleText(static_cast<GumboNode*>(children->data[i]))) return true;
+    }
+    return false;
+}
+
+void handleAnchor(GumboNode* node, Extraction& ex) {
+    const char* href = findAttribute(node, "href");
+    if (!href) return;
+    uint8_t flags = 0;
+    if (hasVisibleText(node)) flags |= LINK_HAS_TEXT;
+    if (ex.boilerplateDepth > 0) flags |= LINK_BOILERPLATE;
+    ex.hrefs.push_back({href, flags});
+}
+
+// Turn the collected hrefs into absolute, unique outgoing links. A link
+// found several times has text if any anchor has, and is boilerplate only
+// if every anchor is.
+void resolveLinks(Extraction& ex) {
+    UrlParts base = parseUrl(ex.baseUrl);
+    thread_local std::string link;
+    for (const Href& href : ex.hrefs) {
+        if (!resolveLinkHref(href.value, base, link)) continue;
+        auto inserted = ex.uniqueLinks.emplace(link, ex.data.outgoingLinks.size());
+        if (inserted.second) {
+            ex.data.outgoingLinks.emplace_back(link);
+            ex.data.outgoingLinkFlags.push_back(href.flags);
+        } else {
+            uint8_t& flags = ex.data.outgoingLinkFlags[inserted.first->second];
+            flags = ((flags | href.flags) & LINK_HAS_TEXT) | (flags & href.flags & LINK_BOILERPLATE);
+        }
+    }
+}
+
+bool isBoilerplateTag(GumboTag tag) {
+    return tag == GUMBO_TAG_NAV || tag == GUMBO_TAG_HEADER || tag == GUMBO_TAG_FOOTER || tag == GUMBO_TAG_ASIDE;
+}
+
+// Returns the area bit if this node is the first of its kind, else 0
+unsigned enterArea(GumboNode* node, Extraction& ex, int index, unsigned bit) {
+    if (ex.areaNodes[index]) return 0;
+    ex.areaNodes[index] = node;
+    ex.activeAreas |= bit;
+    return bit;
+}
+
+void visit(GumboNode* node, Extraction& ex) {
+    if (node->type == GUMBO_NODE_TEXT) {
+        for (const Capture& capture : ex.captures) {
+            if (capture.skipDepth == ex.skipDepth) {
+                *capture.buffer += node->v.text.text;
+                *capture.buffer += " ";
+            }
+        }
+        return;
+    }
+    if (node->type != GUMBO_NODE_ELEMENT) {
+        return;
+    }
+
+    GumboTag tag = node->v.element.tag;
+    bool captured = false;
+    unsigned enteredArea = 0;
+
+    switch (tag) {
+    case GUMBO_TAG_TITLE:
+        if (!ex.titleFound) {
+            ex.titleFound = true;
+            ex.captures.push_back({&ex.data.title, ex.skipDepth});
+            captured = true;
+        }
+        break;
+    case GUMBO_TAG_META:
+        handleMeta(node, ex);
+        break;
+    case GUMBO_TAG_BASE:
+        handleBase(node, ex);
+        break;
+    case GUMBO_TAG_LINK:
+        handleFavicon(node, ex);
+        break;
+    case GUMBO_TAG_A:
+        if (ex.collectLinks) handleAnchor(node, ex);
+        break;
+    case GUMBO_TAG_ARTICLE:
+        enteredArea = enterArea(node, ex, 0, AREA_ARTICLE);
+        break;
+    case GUMBO_TAG_MAIN:
+        enteredArea = enterArea(node, ex, 1, AREA_MAIN);
+        break;
+    case GUMBO_TAG_BODY:
+        enteredArea = enterArea(node, ex, 2, AREA_BODY);
+        break;
+    case GUMBO_TAG_P:
+        // Paragraph text is only needed while there is no meta description
+        if (ex.activeAreas != 0 && ex.data.description.empty()) {
+            ex.paragraphs.push_back({std::pmr::string(ex.resource), ex.activeAreas});
+            ex.captures.push_back({&ex.paragraphs.back().text, ex.skipDepth});
+            captured = true;
+        }
+        break;
+    case GUMBO_TAG_IMG:
+        if (ex.activeAreas != 0) {
+            ex.images.push_back({node, ex.activeAreas});
+        }
+        break;
+    default:
+        break;
+    }
+
+    bool skipText = isSkippedTextTag(tag);
+    if (skipText) ex.skipDepth++;
+    bool boilerplate = isBoilerplateTag(tag);
+    if (boilerplate) ex.boilerplateDepth++;
+
+    GumboVector* children = &node->v.element.children;
+    for (unsigned int i = 0; i < children->length; ++i) {
+        visit(static_cast<GumboNode*>(children->data[i]), ex);
+    }
+
+    if (skipText) ex.skipDepth--;
+    if (boilerplate) ex.boilerplateDepth--;
+    if (captured) ex.captures.pop_back();
+    ex.activeAreas &= ~enteredArea;
+}
+
+// Feed the text of a subtree to the normalizer (same text as extractText)
+void normalizeAreaText(GumboNode* node, PmrTextNormalizer& normalizer) {
+    if (node->type == GUMBO_NODE_TEXT) {
+        normalizer.append(node->v.text.text, std::strlen(node->v.text.text));
+        normalizer.separator();
+    } else if (node->type == GUMBO_NODE_ELEMENT && !isSkippedTextTag(node->v.element.tag)) {
+        GumboVector* children = &node->v.element.children;
+        for (unsigned int i = 0; i < children->length && !normalizer.full(); ++i) {
+            normalizeAreaText(static_cast<GumboNode*>(children->data[i]), normalizer);
+        }
+    }
+}
+
+// Build content from the paragraphs of the chosen content area
+void buildContent(Extraction& ex, GumboNode* areaNode, unsigned area) {
+    PageData& data = ex.data;
+    std::pmr::string paragraphsText(ex.resource);
+
+    // Extract text from first few paragraphs (skip navigation/table of contents)
+    for (const Paragraph& p : ex.paragraphs) {
+        if (!(p.areas & area)) continue;
+        const std::pmr::string& paraText = p.text;
+
+        // Skip short paragraphs (likely navigation/UI elements)
+        if (paraText.length() < 50) continue;
+
+        // Skip if it looks like navigation (contains "Toggle", "languages", etc.)
+        if (paraText.find("Toggle") != std::string::npos ||
+            paraText.find("languages") != std::string::npos ||
+            paraText.find("Jump to") != std::string::npos) {
+            continue;
+        }
+
+        paragraphsText += paraText;
+        paragraphsText += ' ';
+
+        // Get first 1-3 paragraphs of real content
+        if (paragraphsText.length() > 500) break;
+    }
+
+    // Collapse whitespace, trim and cap at 2000 bytes in one pass
+    PmrTextNormalizer normalizer(data.content, MAX_CONTENT_BYTES);
+
+    // If still no good content, fallback to full text of the area
+    // (the only case that walks part of the tree a second time; it stops
+    // as soon as enough text is collected)
+    if (paragraphsText.length() < 100) {
+        normalizeAreaText(areaNode, normalizer);
+    } else {
+        normalizer.append(paragraphsText);
+    }
+    normalizer.finish();
+}
+
+// Extract images from main content area (Google-style)
+void buildImages(Extraction& ex, unsigned area) {
+    PageData& data = ex.data;
+    std::pmr::set<std::pmr::string> seenImages(ex.resource);
+    UrlParts base = parseUrl(ex.baseUrl);
+    thread_local std::string src;
+
+    for (const Image& image : ex.images) {
+        if (!(image.areas & area)) continue;
+
+        // Convert relative URLs to absolute
+        const char* value = findAttribute(image.node, "src");
+        if (!value || !resolveLinkHref(value, base, src)) continue;
+
+        // Only add valid, unique images
+        if (isValidImageUrl(src) && seenImages.emplace(src).second) {
+            data.images.emplace_back(src);
+        }
+    }
+}
+
+} // namespace
+
+PageData::PageData(const allocator_type& alloc)
+    : url(alloc), title(alloc), description(alloc), images(alloc), tags(alloc), content(alloc),
+      outgoingLinks(alloc), outgoingLinkFlags(alloc), favicon(alloc), etag(alloc), lastModified(alloc), duplicateOf(alloc) {}
+
+PageData::PageData(const PageData& other, const allocator_type& alloc)
+    : url(other.url, alloc), title(other.title, alloc), description(other.description, alloc),
+      images(other.images, alloc), tags(other.tags, alloc), content(other.content, alloc), rawHtml(other.rawHtml),
+      outgoingLinks(other.outgoingLinks, alloc), outgoingLinkFlags(other.outgoingLinkFlags, alloc),
+      favicon(other.favicon, alloc), etag(other.etag, alloc),
+      lastModified(other.lastModified, alloc), contentHash(other.contentHash), write(other.write),
+      simhash(other.simhash), duplicateOf(other.duplicateOf, alloc), duplicateDistance(other.duplicateDistance) {}
+
+// Function to extract text from a Gumbo node (excluding script and style tags)
+void extractText(GumboNode* node, std::string& text) {
+    if (node->type == GUMBO_NODE_TEXT) {
+        text += node->v.text.text;
+        text += " ";
+    } else if (node->type == GUMBO_NODE_ELEMENT) {
+        // Skip script, style, and noscript tags
+        if (isSkippedTextTag(node->v.element.tag)) {
+            return;
+        }
+
+        GumboVector* children = &node->v.element.children;
+        for (unsigned int i = 0; i < children->length; ++i) {
+            extractText(static_cast<GumboNode*>(children->data[i]), text);
+        }
+    }
+}
+
+// Function to get attribute value from a node
+std::string getAttribute(GumboNode* node, const char* attr_name) {
+    GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, attr_name);
+    if (attr) {
+        return std::string(attr->value);
+    }
+    return "";
+}
+
+// Function to check if URL has a valid image extension and is not an icon
+bool isValidImageUrl(const std::string& url) {
+    // Convert to lowercase for comparison, without query parameters for the
+    // extension check (the buffer is reused across calls)
+    thread_local std::string lowerUrl;
+    lowerUrl.assign(url, 0, url.find('?'));
+    std::transform(lowerUrl.begin(), lowerUrl.end(), lowerUrl.begin(), ::tolower);
+
+    // Exclude only obvious non-image formats
+    if (lowerUrl.find(".ico") != std::string::npos ||
+        lowerUrl.find(".gif") != std::string::npos ||
+        lowerUrl.find("favicon") != std::string::npos) {
+        return false;
+    }
+
+    // Accept standard image formats
+    return (lowerUrl.find(".jpg") != std::string::npos ||
+            lowerUrl.find(".jpeg") != std::string::npos ||
+            lowerUrl.find(".png") != std::string::npos ||
+            lowerUrl.find(".webp") != std::string::npos ||
+            lowerUrl.find(".svg") != std::string::npos );
+}
+
+// Function to turn an href/src value into an absolute crawlable URL
+bool resolveLinkHref(std::string_view href, const UrlParts& base, std::string& out) {
+    // Browsers ignore surrounding whitespace and any tab or newline inside
+    while (!href.empty() && static_cast<unsigned char>(href.front()) <= ' ') href.remove_prefix(1);
+    while (!href.empty() && static_cast<unsigned char>(href.back()) <= ' ') href.remove_suffix(1);
+
+    // Skip anchors within the page
+    if (href.empty() || href[0] == '#') return false;
+
+    thread_local std::string cleaned;
+    if (href.find_first_of("\t\n\r") != std::string_view::npos) {
+        cleaned.assign(href.data(), href.size());
+        cleaned.erase(std::remove_if(cleaned.begin(), cleaned.end(),
+                                     [](char c) { return c == '\t' || c == '\n' || c == '\r'; }),
+                      cleaned.end());
+        href = cleaned;
+    }
+
+    // Skip mailto, javascript, etc. (decided before building the URL)
+    UrlParts ref = parseUrl(href);
+    const UrlParts& target = (ref.hasScheme || ref.hasAuthority) ? ref : base;
+    if (!isHttpScheme(ref.hasScheme ? ref.scheme : base.scheme) || !target.hasAuthority || target.host.empty()) {
+        return false;
+    }
+
+    // Resolve relative URLs, dropping the fragment (#section)
+    ref.hasFragment = false;
+    return resolveUrl(base, ref, out);
+}
+
+bool resolveLinkHref(std::string_view href, std::string_view baseUrl, std::string& out) {
+    return resolveLinkHref(href, parseUrl(baseUrl), out);
+}
+
+// Function to parse HTML and extract page data
+PageData parseHTML(const BodyBuffer& html, const std::string& url, const ParseOptions& options) {
+    std::pmr::memory_resource* resource = options.arena ? options.arena->resource() : std::pmr::get_default_resource();
+    PageData data(resource);
+    data.url = url;
+    data.rawHtml = html;  // Keep a reference to the raw HTML (no copy)
+
+    // A tree built in the arena is freed with the arena
+    const GumboOptions* gumboOptions = &kGumboDefaultOptions;
+#ifdef HAVE_GUMBO_ALLOCATOR
+    if (options.arena) gumboOptions = options.arena->gumboOptions();
+#endif
+    GumboOutput* output = gumbo_parse_with_options(gumboOptions, html->data(), html->size());
+
+    // One pass collects title, meta, favicon, links, paragraphs and images
+    Extraction ex(data, resource);
+    ex.collectLinks = options.extractLinks;
+    visit(output->root, ex);
+    resolveLinks(ex);
+
+    // Trim title whitespace
+    data.title.erase(0, data.title.find_first_not_of(" \n\r\t"));
+    data.title.erase(data.title.find_last_not_of(" \n\r\t") + 1);
+
+    // Favicon from <link rel="icon">, else the default /favicon.ico
+    thread_local std::string favicon;
+    if (!ex.faviconHref || !resolveLinkHref(ex.faviconHref, ex.baseUrl, favicon)) {
+        if (!resolveLinkHref("/favicon.ico", url, favicon)) favicon.clear();
+    }
+    data.favicon = favicon;
+
+    // Pick the content area: first ARTICLE, else MAIN, else BODY
+    GumboNode* areaNode = nullptr;
+    unsigned area = 0;
+    const unsigned areaBits[3] = {AREA_ARTICLE, AREA_MAIN, AREA_BODY};
+    for (int i = 0; i < 3; i++) {
+        if (ex.areaNodes[i]) {
+            areaNode = ex.areaNodes[i];
+            area = areaBits[i];
+            break;
+        }
+    }
+
+    if (!data.description.empty()) {
+        // Use meta description as content (like Google does)
+        data.content = data.description;
+    } else if (areaNode) {
+        buildContent(ex, areaNode, area);
+    }
+
+    if (areaNode) {
+        buildImages(ex, area);
+    }
+
+    if (gumboOptions == &kGumboDefaultOptions) gumbo_destroy_output(gumboOptions, output);
+    return data;
+}
+
+PageData parseHTML(const std::string& html, const std::string& url) {
+    return parseHTML(makeBodyBuffer(html), url);
+}
+
+// Function to extract links from HTML
+std::vector<std::string> extractLinks(const std::string& html, const std::string& baseUrl) {
+    PageData data;
+    data.url = baseUrl;
+
+    GumboOutput* output = gumbo_parse_with_options(&kGumboDefaultOptions, html.data(), html.size());
+    Extraction ex(data, std::pmr::get_default_resource());
+    visit(output->root, ex);
+    resolveLinks(ex);
+    gumbo_destroy_output(&kGumboDefaultOptions, output);
+
+    return std::vector<std::string>(data.outgoingLinks.begin(), data.outgoingLinks.end());
+}
+
+// Function to validate page quality (filter out Cloudflare, bot checks, low-quality pages)
+bool isValidPage(const PageData& data) {
+    // Check for Cloudflare or bot protection pages
+    if (data.title.find("Just a moment") != std::string::npos ||
+        data.title.find("Attention Required") != std::string::npos ||
+        data.title.find("Please verify you are human") != std::string::npos ||
+        data.title.find("Access denied") != std::string::npos ||
+        data.title.find("403 Forbidden") != std::string::npos ||
+        data.title.find("404 Not Found") != std::string::npos) {
+        return false;
+    }
+
+    // Check for minimal content length (reduced for dynamic sites like IMDB)
+    if (data.content.length() < 20) {
+        return false;
+    }
+
+    // Check if title is empty (but allow short titles)
+    if (data.title.empty()) {
+        return false;
+    }
+
+    // Relax JavaScript check - only filter if heavily dominated by JS
+    size_t jsIndicators = 0;
+    if (data.content.find("window.ytcsi") != std::string::npos) jsIndicators++;
+    if (data.content.find("document.getElementById") != std::string::npos) jsIndicators++;
+    if (data.content.find("addEventListener") != std::string::npos) jsIndicators++;
+    if (data.content.find("var ") != std::string::npos) jsIndicators++;
+    if (data.content.find("const ") != std::string::npos) jsIndicators++;
+
+    // Only reject if 4 or more JS indicators (very strict)
+    if (jsIndicators >= 4) {
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef HTML_PARSER_HPP
+#define HTML_PARSER_HPP
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <gumbo.h>
+
+#include "body_buffer.hpp"
+#include "url_utils.hpp"
+
+// How the database writer stores a page
+enum class PageWrite {
+    Insert,          // new page; skipped if the URL is already stored
+    Replace,         // recrawled page that changed: its row is updated in place
+    ValidatorsOnly,  // recrawled page with an unchanged body: only ETag/Last-Modified
+    Duplicate        // near-duplicate of a stored page: only recorded in duplicates (an old row is deleted)
+};
+
+// What the parser saw around an outgoing link (bits of PageData::outgoingLinkFlags)
+enum LinkFlag : uint8_t {
+    LINK_HAS_TEXT = 1 << 0,     // some anchor has visible text (not just an image)
+    LINK_BOILERPLATE = 1 << 1,  // every anchor sits in a nav, header, footer or aside
+};
+
+// Strings and lists of a page live in the memory resource it was created
+// with: the heap by default, or a worker's PageArena while it is parsed.
+// Copies (without an allocator argument) always go to the heap.
+struct PageData {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    PageData() = default;
+    explicit PageData(const allocator_type& alloc);
+    PageData(const PageData& other, const allocator_type& alloc);
+    PageData(const PageData&) = default;
+    PageData(PageData&&) = default;
+    PageData& operator=(const PageData&) = default;
+    PageData& operator=(PageData&&) = default;
+
+    // True if the page lives in the default (heap) resource
+    bool onHeap() const { return url.get_allocator().resource()->is_equal(*std::pmr::get_default_resource()); }
+
+    std::pmr::string url;
+    std::pmr::string title;
+    std::pmr::string description;
+    std::pmr::vector<std::pmr::string> images;
+    std::pmr::vector<std::pmr::string> tags;
+    std::pmr::string content;
+    BodyBuffer rawHtml;  // the downloaded body itself, shared rather than copied
+    std::pmr::vector<std::pmr::string> outgoingLinks;
+    std::pmr::vector<uint8_t> outgoingLinkFlags;  // LinkFlag bits per outgoing link (empty for streamed links)
+    std::pmr::string favicon;
+
+    // Filled in by the crawler: response validators and body hash, kept for
+    // the next recrawl, and how the row is written
+    std::pmr::string etag;
+    std::pmr::string lastModified;
+    uint64_t contentHash = 0;
+    PageWrite write = PageWrite::Insert;
+
+    // SimHash of the content (0 if too short), and for a near-duplicate the
+    // page it repeats and how many bits apart they are
+    uint64_t simhash = 0;
+    std::pmr::string duplicateOf;
+    int duplicateDistance = 0;
+};
+
+// Function to extract text from a Gumbo node (excluding script and style tags)
+void extractText(GumboNode* node, std::string& text);
+
+// Function to get attribute value from a node
+std::string getAttribute(GumboNode* node, const char* attr_name);
+
+// Function to check if URL has a valid image extension and is not an icon
+bool isValidImageUrl(const std::string& url);
+
+class PageArena;
+
+struct ParseOptions {
+    // Off when outgoing links were already collected while streaming the body
+    bool extractLinks = true;
+
+    // Build the Gumbo tree, scratch data and PageData in this arena (reset
+    // by the caller once the page is handled) instead of the heap
+    PageArena* arena = nullptr;
+};
+
+// Function to turn an href/src value into an absolute crawlable URL, resolved
+// against the document base (the page URL or its <base href>) with the
+// fragment dropped. Returns false for same-document anchors and for targets
+// that are not http(s), such as mailto: or javascript:.
+bool resolveLinkHref(std::string_view href, const UrlParts& base, std::string& out);
+bool resolveLinkHref(std::string_view href, std::string_view baseUrl, std::string& out);
+
+// Function to parse HTML and extract page data.
+// Parses once and fills every PageData field in a single tree traversal.
+PageData parseHTML(const BodyBuffer& html, const std::string& url, const ParseOptions& options = ParseOptions());
+PageData parseHTML(const std::string& html, const std::string& url);
+
+// Function to extract links from HTML (standalone; parseHTML already fills outgoingLinks)
+std::vector<std::string> extractLinks(const std::string& html, const std::string& baseUrl);
+
+// Function to validate page quality (filter out Cloudflare, bot checks, low-quality pages)
+bool isValidPage(const PageData& data);
+
+#endif // HTML_PARSER_HPP
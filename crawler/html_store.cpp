@@ -0,0 +1,183 @@
+#include "html_store.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <zdict.h>
+
+HtmlCompressor::HtmlCompressor(const HtmlStoreConfig& config) : config(config), cctx(ZSTD_createCCtx()) {}
+
+HtmlCompressor::~HtmlCompressor() {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeCCtx(cctx);
+}
+
+bool HtmlCompressor::loadLatestDictionary(sqlite3* db) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, dict FROM html_dicts ORDER BY id DESC LIMIT 1", -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to read HTML dictionary: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    bool found = false;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const void* blob = sqlite3_column_blob(stmt, 1);
+        int size = sqlite3_column_bytes(stmt, 1);
+        ZSTD_CDict* loaded = blob ? ZSTD_createCDict(blob, size, config.level) : nullptr;
+        if (loaded) {
+            ZSTD_freeCDict(cdict);
+            cdict = loaded;
+            dictId = sqlite3_column_int64(stmt, 0);
+            trainingDone = true;
+            found = true;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool HtmlCompressor::compress(const char* data, size_t size, std::string& out) {
+    out.resize(ZSTD_compressBound(size));
+    size_t written = cdict
+        ? ZSTD_compress_usingCDict(cctx, &out[0], out.size(), data, size, cdict)
+        : ZSTD_compressCCtx(cctx, &out[0], out.size(), data, size, config.level);
+    if (ZSTD_isError(written)) {
+        std::cerr << "Failed to compress HTML: " << ZSTD_getErrorName(written) << std::endl;
+        return false;
+    }
+    out.resize(written);
+    totalRaw += size;
+    totalCompressed += written;
+    return true;
+}
+
+void HtmlCompressor::addSample(const char* data, size_t size) {
+    if (trainingDone || size == 0) return;
+    size = std::min(size, config.dictSampleBytes);
+    samples.append(data, size);
+    sampleSizes.push_back(size);
+}
+
+bool HtmlCompressor::trainDictionary(sqlite3* db) {
+    trainingDone = true;  // one attempt per run, whatever the outcome
+
+    std::string dict(config.dictSize, '\0');
+    size_t size = ZDICT_trainFromBuffer(&dict[0], dict.size(), samples.data(), sampleSizes.data(),
+                                        static_cast<unsigned>(sampleSizes.size()));
+    std::string().swap(samples);
+    std::vector<size_t>().swap(sampleSizes);
+    if (ZDICT_isError(size)) {
+        std::cerr << "Failed to train HTML dictionary: " << ZDICT_getErrorName(size) << std::endl;
+        return false;
+    }
+    dict.resize(size);
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "INSERT INTO html_dicts (dict) VALUES (?)", -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to store HTML dictionary: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_blob(stmt, 1, dict.data(), static_cast<int>(dict.size()), SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        std::cerr << "Failed to store HTML dictionary: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+
+    ZSTD_freeCDict(cdict);
+    cdict = ZSTD_createCDict(dict.data(), dict.size(), config.level);
+    dictId = cdict ? sqlite3_last_insert_rowid(db) : 0;
+    return cdict != nullptr;
+}
+
+HtmlReader::HtmlReader(sqlite3* db) : db(db), dctx(ZSTD_createDCtx()) {
+    if (sqlite3_prepare_v2(db, "SELECT dict_id, raw_size, data FROM page_html WHERE page_id = ?", -1, &selectHtml, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT id FROM pages WHERE url = ?", -1, &selectPageId, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "SELECT dict FROM html_dicts WHERE id = ?", -1, &selectDict, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare HTML reader: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_finalize(selectHtml);
+        selectHtml = nullptr;
+    }
+    // Only databases that predate page_html have this column
+    if (sqlite3_prepare_v2(db, "SELECT raw_html FROM pages WHERE id = ?", -1, &selectLegacy, 0) != SQLITE_OK) {
+        selectLegacy = nullptr;
+    }
+}
+
+HtmlReader::~HtmlReader() {
+    sqlite3_finalize(selectHtml);
+    sqlite3_finalize(selectPageId);
+    sqlite3_finalize(selectDict);
+    sqlite3_finalize(selectLegacy);
+    for (auto& entry : dicts) {
+        ZSTD_freeDDict(entry.second);
+    }
+    ZSTD_freeDCtx(dctx);
+}
+
+const ZSTD_DDict* HtmlReader::dictionary(sqlite3_int64 id) {
+    auto it = dicts.find(id);
+    if (it != dicts.end()) return it->second;
+
+    ZSTD_DDict* ddict = nullptr;
+    sqlite3_bind_int64(selectDict, 1, id);
+    if (sqlite3_step(selectDict) == SQLITE_ROW) {
+        ddict = ZSTD_createDDict(sqlite3_column_blob(selectDict, 0), sqlite3_column_bytes(selectDict, 0));
+    }
+    sqlite3_reset(selectDict);
+    if (ddict) dicts[id] = ddict;
+    return ddict;
+}
+
+bool HtmlReader::readByPageId(sqlite3_int64 pageId, std::string& html) {
+    if (!selectHtml) return false;
+
+    bool found = false;
+    sqlite3_bind_int64(selectHtml, 1, pageId);
+    if (sqlite3_step(selectHtml) == SQLITE_ROW) {
+        sqlite3_int64 dictId = sqlite3_column_int64(selectHtml, 0);
+        size_t rawSize = static_cast<size_t>(sqlite3_column_int64(selectHtml, 1));
+        const void* data = sqlite3_column_blob(selectHtml, 2);
+        size_t size = sqlite3_column_bytes(selectHtml, 2);
+
+        const ZSTD_DDict* ddict = dictId ? dictionary(dictId) : nullptr;
+        if (dictId && !ddict) {
+            std::cerr << "Missing HTML dictionary " << dictId << " for page " << pageId << std::endl;
+        } else {
+            html.resize(rawSize);
+            size_t n = ddict
+                ? ZSTD_decompress_usingDDict(dctx, &html[0], html.size(), data, size, ddict)
+                : ZSTD_decompressDCtx(dctx, &html[0], html.size(), data, size);
+            if (ZSTD_isError(n) || n != rawSize) {
+                std::cerr << "Failed to decompress HTML of page " << pageId << std::endl;
+            } else {
+                found = true;
+            }
+        }
+        sqlite3_reset(selectHtml);
+        return found;
+    }
+    sqlite3_reset(selectHtml);
+
+    // Not migrated yet: read the uncompressed column
+    if (selectLegacy) {
+        sqlite3_bind_int64(selectLegacy, 1, pageId);
+        if (sqlite3_step(selectLegacy) == SQLITE_ROW && sqlite3_column_type(selectLegacy, 0) != SQLITE_NULL) {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(selectLegacy, 0));
+            html.assign(text, sqlite3_column_bytes(selectLegacy, 0));
+            found = true;
+        }
+        sqlite3_reset(selectLegacy);
+    }
+    return found;
+}
+
+bool HtmlReader::readByUrl(const std::string& url, std::string& html) {
+    if (!selectHtml) return false;
+
+    sqlite3_bind_text(selectPageId, 1, url.data(), static_cast<int>(url.size()), SQLITE_STATIC);
+    bool found = sqlite3_step(selectPageId) == SQLITE_ROW;
+    sqlite3_int64 pageId = found ? sqlite3_column_int64(selectPageId, 0) : 0;
+    sqlite3_reset(selectPageId);
+    return found && readByPageId(pageId, html);
+}
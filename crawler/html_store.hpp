@@ -0,0 +1,91 @@
+#ifndef HTML_STORE_HPP
+#define HTML_STORE_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+#include <zstd.h>
+
+// Raw HTML is kept out of the pages table, zstd-compressed, in
+//   page_html(page_id, dict_id, raw_size, data)
+// where dict_id points at a dictionary in html_dicts (0 = no dictionary).
+// Pages of one crawl share most of their markup, so a dictionary trained on
+// the first pages makes later pages compress several times smaller.
+
+struct HtmlStoreConfig {
+    int level = 3;                     // zstd compression level
+    size_t dictSamplePages = 1000;     // pages sampled before training a dictionary
+    size_t dictSampleBytes = 32 * 1024;  // bytes taken from the start of each sample
+    size_t dictSize = 112 * 1024;
+};
+
+// Compresses pages for page_html (one per writing connection; not thread-safe)
+class HtmlCompressor {
+public:
+    explicit HtmlCompressor(const HtmlStoreConfig& config = HtmlStoreConfig());
+    ~HtmlCompressor();
+
+    HtmlCompressor(const HtmlCompressor&) = delete;
+    HtmlCompressor& operator=(const HtmlCompressor&) = delete;
+
+    // Use the newest dictionary stored in html_dicts, if any
+    bool loadLatestDictionary(sqlite3* db);
+
+    // Compress with the current dictionary; dictionaryId() tells which one
+    bool compress(const char* data, size_t size, std::string& out);
+    sqlite3_int64 dictionaryId() const { return dictId; }
+
+    // Collect pages until there are enough to train a dictionary
+    void addSample(const char* data, size_t size);
+    bool readyToTrain() const { return !trainingDone && sampleSizes.size() >= config.dictSamplePages; }
+
+    // Train from the samples, store the result in html_dicts and start using it.
+    // Call outside any transaction that may still roll back the row.
+    bool trainDictionary(sqlite3* db);
+
+    size_t rawBytes() const { return totalRaw; }
+    size_t compressedBytes() const { return totalCompressed; }
+
+private:
+    HtmlStoreConfig config;
+    ZSTD_CCtx* cctx = nullptr;
+    ZSTD_CDict* cdict = nullptr;
+    sqlite3_int64 dictId = 0;
+    bool trainingDone = false;  // a dictionary exists or training gave up
+    std::string samples;
+    std::vector<size_t> sampleSizes;
+    size_t totalRaw = 0;
+    size_t totalCompressed = 0;
+};
+
+// Reads raw HTML back, decompressing on demand. Pages stored before the
+// migration (pages.raw_html) are still returned. One reader per thread.
+class HtmlReader {
+public:
+    explicit HtmlReader(sqlite3* db);
+    ~HtmlReader();
+
+    HtmlReader(const HtmlReader&) = delete;
+    HtmlReader& operator=(const HtmlReader&) = delete;
+
+    bool ok() const { return selectHtml != nullptr; }
+
+    // Returns false if the page or its HTML is not stored
+    bool readByPageId(sqlite3_int64 pageId, std::string& html);
+    bool readByUrl(const std::string& url, std::string& html);
+
+private:
+    const ZSTD_DDict* dictionary(sqlite3_int64 id);
+
+    sqlite3* db;
+    sqlite3_stmt* selectHtml = nullptr;
+    sqlite3_stmt* selectPageId = nullptr;
+    sqlite3_stmt* selectDict = nullptr;
+    sqlite3_stmt* selectLegacy = nullptr;  // null once raw_html is gone from pages
+    ZSTD_DCtx* dctx = nullptr;
+    std::map<sqlite3_int64, ZSTD_DDict*> dicts;
+};
+
+#endif // HTML_STORE_HPP
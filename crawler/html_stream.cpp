@@ -0,0 +1,242 @@
+#include "html_stream.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "html_parser.hpp"
+
+namespace {
+
+// Tags longer than this are dropped rather than buffered
+const size_t MAX_TAG_BYTES = 16 * 1024;
+
+bool isRawTextTag(const std::string& tag) {
+    return tag == "script" || tag == "style" || tag == "textarea" || tag == "title" ||
+           tag == "iframe" || tag == "xmp" || tag == "noembed" || tag == "noframes";
+}
+
+void appendUtf8(std::string& out, unsigned long cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x110000) {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Decode the character references that show up in attribute values
+std::string decodeEntities(const char* s, size_t length) {
+    std::string out;
+    out.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        if (s[i] != '&') {
+            out += s[i];
+            continue;
+        }
+        const char* semi = static_cast<const char*>(memchr(s + i, ';', std::min<size_t>(length - i, 12)));
+        if (!semi) {
+            out += '&';
+            continue;
+        }
+        std::string name(s + i + 1, semi);
+        if (name == "amp") out += '&';
+        else if (name == "lt") out += '<';
+        else if (name == "gt") out += '>';
+        else if (name == "quot") out += '"';
+        else if (name == "apos") out += '\'';
+        else if (name.size() > 1 && name[0] == '#') {
+            unsigned long cp = (name[1] == 'x' || name[1] == 'X')
+                ? std::strtoul(name.c_str() + 2, nullptr, 16)
+                : std::strtoul(name.c_str() + 1, nullptr, 10);
+            appendUtf8(out, cp);
+        } else {
+            out += '&';
+            continue;
+        }
+        i = semi - s;
+    }
+    return out;
+}
+
+} // namespace
+
+void HtmlTagStream::feed(const char* data, size_t length) {
+    const char* p = data;
+    const char* end = data + length;
+
+    while (p < end) {
+        switch (state) {
+        case State::Text: {
+            const char* lt = static_cast<const char*>(memchr(p, '<', end - p));
+            if (!lt) return;
+            p = lt + 1;
+            state = State::Tag;
+            tagBuffer.clear();
+            quote = 0;
+            break;
+        }
+
+        case State::Tag: {
+            char c = *p++;
+            if (tagBuffer.empty() && !std::isalpha(static_cast<unsigned char>(c)) &&
+                c != '/' && c != '!' && c != '?') {
+                state = State::Text;  // a stray '<' in text
+                break;
+            }
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '>') {
+                emitTag();
+                break;
+            } else if ((c == '"' || c == '\'') && tagBuffer.find('=') != std::string::npos) {
+                quote = c;
+            }
+            tagBuffer += c;
+            if (tagBuffer.size() == 3 && tagBuffer == "!--") {
+                state = State::Comment;
+                commentDashes = 0;
+            } else if (tagBuffer.size() > MAX_TAG_BYTES) {
+                state = State::Text;
+            }
+            break;
+        }
+
+        case State::Comment: {
+            char c = *p++;
+            if (c == '-') {
+                commentDashes++;
+            } else if (c == '>' && commentDashes >= 2) {
+                state = State::Text;
+            } else {
+                commentDashes = 0;
+            }
+            break;
+        }
+
+        case State::RawTextEnd: {
+            const char* gt = static_cast<const char*>(memchr(p, '>', end - p));
+            if (!gt) return;
+            p = gt + 1;
+            state = State::Text;
+            break;
+        }
+
+        case State::RawText: {
+            if (rawTextMatched == 0) {
+                const char* lt = static_cast<const char*>(memchr(p, '<', end - p));
+                if (!lt) return;
+                p = lt + 1;
+                rawTextMatched = 1;
+                break;
+            }
+            char c = static_cast<char>(std::tolower(static_cast<unsigned char>(*p++)));
+            if (c == rawTextEnd[rawTextMatched]) {
+                if (++rawTextMatched == rawTextEnd.size()) {
+                    rawTextMatched = 0;
+                    state = State::RawTextEnd;
+                }
+            } else {
+                rawTextMatched = (c == '<') ? 1 : 0;
+            }
+            break;
+        }
+        }
+    }
+}
+
+void HtmlTagStream::emitTag() {
+    state = State::Text;
+    const std::string& t = tagBuffer;
+    if (t.empty() || t[0] == '/' || t[0] == '!' || t[0] == '?') return;
+
+    size_t i = 0;
+    std::string name;
+    while (i < t.size() && !std::isspace(static_cast<unsigned char>(t[i])) && t[i] != '/') {
+        name += static_cast<char>(std::tolower(static_cast<unsigned char>(t[i])));
+        i++;
+    }
+
+    Attributes attributes;
+    while (i < t.size()) {
+        while (i < t.size() && (std::isspace(static_cast<unsigned char>(t[i])) || t[i] == '/')) i++;
+        if (i >= t.size()) break;
+
+        std::string attrName;
+        while (i < t.size() && !std::isspace(static_cast<unsigned char>(t[i])) && t[i] != '=' && t[i] != '/') {
+            attrName += static_cast<char>(std::tolower(static_cast<unsigned char>(t[i])));
+            i++;
+        }
+        while (i < t.size() && std::isspace(static_cast<unsigned char>(t[i]))) i++;
+
+        std::string value;
+        if (i < t.size() && t[i] == '=') {
+            i++;
+            while (i < t.size() && std::isspace(static_cast<unsigned char>(t[i]))) i++;
+            if (i < t.size() && (t[i] == '"' || t[i] == '\'')) {
+                char q = t[i++];
+                size_t close = t.find(q, i);
+                if (close == std::string::npos) close = t.size();
+                value = decodeEntities(t.data() + i, close - i);
+                i = close + 1;
+            } else {
+                size_t start = i;
+                while (i < t.size() && !std::isspace(static_cast<unsigned char>(t[i]))) i++;
+                value = decodeEntities(t.data() + start, i - start);
+            }
+        }
+        if (!attrName.empty()) attributes.emplace_back(std::move(attrName), std::move(value));
+    }
+
+    handler(name, attributes);
+
+    if (isRawTextTag(name) && (t.empty() || t.back() != '/')) {
+        state = State::RawText;
+        rawTextEnd = "</" + name;
+        rawTextMatched = 0;
+    }
+}
+
+StreamingLinkExtractor::StreamingLinkExtractor(const std::string& baseUrl)
+    : pageUrl(baseUrl),
+      baseUrl(baseUrl),
+      stream([this](const std::string& tag, const HtmlTagStream::Attributes& attributes) {
+          if (tag != "a" && tag != "base") return;
+          for (const auto& attr : attributes) {
+              if (attr.first != "href") continue;
+              if (tag == "a") {
+                  hrefs.push_back(attr.second);
+              } else if (!baseFound) {
+                  // Only the first <base> with an href counts
+                  baseFound = true;
+                  std::string resolved;
+                  if (resolveLinkHref(attr.second, pageUrl, resolved)) this->baseUrl = std::move(resolved);
+              }
+              break;  // the first href wins, as in the DOM
+          }
+      }) {}
+
+std::vector<std::string> StreamingLinkExtractor::takeLinks() {
+    // Resolved at the end, like parseHTML, so a late <base> still applies
+    UrlParts base = parseUrl(baseUrl);
+    std::set<std::string> uniqueLinks;
+    std::vector<std::string> links;
+    std::string link;
+    for (const auto& href : hrefs) {
+        if (resolveLinkHref(href, base, link) && uniqueLinks.insert(link).second) {
+            links.push_back(link);
+        }
+    }
+    hrefs.clear();
+    return links;
+}
@@ -0,0 +1,57 @@
+#ifndef HTML_STREAM_HPP
+#define HTML_STREAM_HPP
+
+#include <cstddef>
+#include <functional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Incremental HTML start-tag tokenizer. It is fed the body chunk by chunk
+// as it downloads and reports every start tag with its attributes; only the
+// bytes of the tag currently being read are buffered, so a tag split across
+// two chunks is handled without keeping the document. Comments and the
+// contents of script/style/textarea/title are skipped.
+class HtmlTagStream {
+public:
+    using Attributes = std::vector<std::pair<std::string, std::string>>;
+    // Tag and attribute names are lowercase, attribute values entity-decoded
+    using TagHandler = std::function<void(const std::string& tag, const Attributes& attributes)>;
+
+    explicit HtmlTagStream(TagHandler handler) : handler(std::move(handler)) {}
+
+    void feed(const char* data, size_t length);
+
+private:
+    enum class State { Text, Tag, Comment, RawText, RawTextEnd };
+
+    void emitTag();
+
+    TagHandler handler;
+    State state = State::Text;
+    std::string tagBuffer;
+    char quote = 0;           // open quote inside a tag, if any
+    size_t commentDashes = 0; // consecutive '-' seen inside a comment
+    std::string rawTextEnd;   // "</script" etc. while in raw text
+    size_t rawTextMatched = 0;
+};
+
+// Collects outgoing links from <a href> while the page downloads, using the
+// same rules as parseHTML, so parsing can skip link extraction afterwards.
+class StreamingLinkExtractor {
+public:
+    explicit StreamingLinkExtractor(const std::string& baseUrl);
+
+    void feed(const char* data, size_t length) { stream.feed(data, length); }
+    std::vector<std::string> takeLinks();
+
+private:
+    std::string pageUrl;
+    std::string baseUrl;  // the page URL unless there is a <base href>
+    bool baseFound = false;
+    std::vector<std::string> hrefs;  // as written in the page
+    HtmlTagStream stream;
+};
+
+#endif // HTML_STREAM_HPP
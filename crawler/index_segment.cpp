@@ -0,0 +1,787 @@
+#include "index_segment.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char SEGMENT_MAGIC[8] = {'C', 'R', 'W', 'L', 'I', 'D', 'X', '1'};
+
+struct IndexSegment::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t docCount;
+    uint32_t termCount;
+    float avgFieldLength[FIELD_COUNT];
+    uint64_t docTableOffset;
+    uint64_t storedOffset;
+    uint64_t postingsOffset;
+    uint64_t termStringsOffset;
+    uint64_t termTableOffset;
+    uint64_t fileSize;
+};
+
+struct IndexSegment::DocEntry {
+    int64_t pageId;
+    uint64_t storedOffset;  // URL then title
+    uint32_t fieldLength[FIELD_COUNT];
+    uint32_t urlLength;
+    uint32_t titleLength;
+    uint32_t reserved;
+};
+
+struct IndexSegment::TermEntry {
+    uint64_t postingsOffset;  // skip entries, then block data
+    uint64_t stringOffset;    // into the term strings
+    uint32_t stringLength;
+    uint32_t docFreq;
+    uint32_t blockCount;
+    float maxScore;
+};
+
+namespace {
+
+const uint32_t SEGMENT_VERSION = 1;
+const size_t BLOCK_SIZE = 128;
+const uint32_t END_DOC = UINT32_MAX;
+
+// BM25F: term frequencies are weighted per field and normalized by the
+// field's length before saturation
+const float BM25_K1 = 1.2f;
+const float FIELD_WEIGHT[FIELD_COUNT] = {3.0f, 1.5f, 1.0f};
+const float FIELD_B[FIELD_COUNT] = {0.75f, 0.75f, 0.75f};
+
+// Skip entry of one postings block
+struct BlockInfo {
+    uint32_t lastDoc;
+    uint32_t offset;  // from the end of the skip entries
+    float maxScore;   // no posting in the block scores higher
+    uint32_t count;
+};
+
+float inverseDocFreq(uint32_t docFreq, uint32_t docCount) {
+    return std::log(1.0f + (docCount - docFreq + 0.5f) / (docFreq + 0.5f));
+}
+
+float termScore(float idf, const uint32_t freq[FIELD_COUNT], const uint32_t fieldLength[FIELD_COUNT],
+                const float avgFieldLength[FIELD_COUNT]) {
+    float tf = 0;
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        if (!freq[f]) continue;
+        float norm = avgFieldLength[f] > 0 ? 1 - FIELD_B[f] + FIELD_B[f] * fieldLength[f] / avgFieldLength[f] : 1;
+        tf += FIELD_WEIGHT[f] * freq[f] / norm;
+    }
+    return idf * tf * (BM25_K1 + 1) / (tf + BM25_K1);
+}
+
+inline bool isTermByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+void putVarint(std::string& out, uint32_t v) {
+    while (v >= 0x80) {
+        out += static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    out += static_cast<char>(v);
+}
+
+const uint8_t* getVarint(const uint8_t* p, uint32_t& v) {
+    uint32_t result = 0;
+    int shift = 0;
+    while (*p & 0x80) {
+        result |= static_cast<uint32_t>(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    v = result | static_cast<uint32_t>(*p++) << shift;
+    return p;
+}
+
+size_t varintLength(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+// PFOR: the values are bit-packed at the width that makes the block
+// smallest. Values too wide for it keep their low bits in place and are
+// patched with their high bits, stored as exceptions after the packed bits.
+void encodePfor(const uint32_t* values, size_t n, std::string& out) {
+    int bits = 32;
+    size_t bestSize = SIZE_MAX;
+    for (int width = 0; width <= 32; width++) {
+        size_t size = (n * width + 7) / 8;
+        for (size_t i = 0; i < n && size < bestSize; i++) {
+            if (width < 32 && (values[i] >> width)) size += 1 + varintLength(values[i] >> width);
+        }
+        if (size < bestSize) {
+            bestSize = size;
+            bits = width;
+        }
+    }
+
+    out += static_cast<char>(bits);
+    size_t exceptionCountAt = out.size();
+    out += '\0';
+
+    uint32_t mask = bits == 32 ? UINT32_MAX : (1u << bits) - 1;
+    uint64_t buffer = 0;
+    int filled = 0;
+    for (size_t i = 0; i < n; i++) {
+        buffer |= static_cast<uint64_t>(values[i] & mask) << filled;
+        filled += bits;
+        while (filled >= 8) {
+            out += static_cast<char>(buffer & 0xff);
+            buffer >>= 8;
+            filled -= 8;
+        }
+    }
+    if (filled > 0) out += static_cast<char>(buffer & 0xff);
+
+    int exceptions = 0;
+    for (size_t i = 0; i < n && bits < 32; i++) {
+        if (values[i] >> bits) {
+            out += static_cast<char>(i);
+            putVarint(out, values[i] >> bits);
+            exceptions++;
+        }
+    }
+    out[exceptionCountAt] = static_cast<char>(exceptions);
+}
+
+const uint8_t* decodePfor(const uint8_t* in, size_t n, uint32_t* values) {
+    int bits = *in++;
+    int exceptions = *in++;
+    if (bits == 0) {
+        std::fill(values, values + n, 0);
+    } else {
+        uint32_t mask = bits == 32 ? UINT32_MAX : (1u << bits) - 1;
+        uint64_t buffer = 0;
+        int filled = 0;
+        for (size_t i = 0; i < n; i++) {
+            while (filled < bits) {
+                buffer |= static_cast<uint64_t>(*in++) << filled;
+                filled += 8;
+            }
+            values[i] = static_cast<uint32_t>(buffer) & mask;
+            buffer >>= bits;
+            filled -= bits;
+        }
+    }
+    for (int e = 0; e < exceptions; e++) {
+        uint8_t index = *in++;
+        uint32_t high;
+        in = getVarint(in, high);
+        values[index] |= high << bits;
+    }
+    return in;
+}
+
+// Walks one term's postings in document order, a block at a time. The skip
+// entries let it move to the block that may hold a document, and read that
+// block's score bound, without decoding anything.
+class PostingCursor {
+public:
+    PostingCursor(const char* segment, const IndexSegment::TermEntry& term, const IndexSegment::DocEntry* docs,
+                  const float* avgFieldLength, uint32_t docCount, SearchStats* stats)
+        : docs(docs), avgFieldLength(avgFieldLength), stats(stats), termMax(term.maxScore),
+          blockCount(term.blockCount) {
+        blocks = reinterpret_cast<const BlockInfo*>(segment + term.postingsOffset);
+        blockData = reinterpret_cast<const uint8_t*>(blocks + blockCount);
+        idf = inverseDocFreq(term.docFreq, docCount);
+        if (blockCount > 0) {
+            decode(0);
+            current = docIds[0];
+        }
+    }
+
+    uint32_t doc() const { return current; }
+    float maxScore() const { return termMax; }
+
+    // Move the block pointer (not the posting) to the block that may hold
+    // target. Targets only ever grow.
+    void shallowSeek(uint32_t target) {
+        while (block < blockCount && blocks[block].lastDoc < target) block++;
+    }
+    float blockMaxScore() const { return block < blockCount ? blocks[block].maxScore : 0; }
+    uint32_t blockLastDoc() const { return block < blockCount ? blocks[block].lastDoc : END_DOC; }
+
+    // Move to the first posting at or after target
+    void seek(uint32_t target) {
+        if (current >= target) return;
+        shallowSeek(target);
+        if (block >= blockCount) {
+            current = END_DOC;
+            return;
+        }
+        if (block != decodedBlock) decode(block);
+        while (docIds[index] < target) index++;
+        current = docIds[index];
+    }
+
+    void next() {
+        if (current != END_DOC) seek(current + 1);
+    }
+
+    float score() const {
+        uint32_t freq[FIELD_COUNT] = {freqs[0][index], freqs[1][index], freqs[2][index]};
+        if (stats) stats->documentsScored++;
+        return termScore(idf, freq, docs[current].fieldLength, avgFieldLength);
+    }
+
+    // Positions of the term in the current document
+    void positions(std::vector<uint32_t>& out) {
+        if (positionsIndex > index) {
+            positionsAt = positionsStart;
+            positionsIndex = 0;
+        }
+        uint32_t v;
+        for (; positionsIndex < index; positionsIndex++) {
+            for (uint32_t n = postingFreq(positionsIndex); n > 0; n--) positionsAt = getVarint(positionsAt, v);
+        }
+        out.clear();
+        const uint8_t* p = positionsAt;
+        uint32_t position = 0;
+        for (uint32_t n = postingFreq(index); n > 0; n--) {
+            p = getVarint(p, v);
+            position += v;
+            out.push_back(position);
+        }
+    }
+
+private:
+    uint32_t postingFreq(uint32_t i) const { return freqs[0][i] + freqs[1][i] + freqs[2][i]; }
+
+    void decode(uint32_t b) {
+        const uint8_t* p = blockData + blocks[b].offset;
+        uint32_t count = blocks[b].count;
+        p = decodePfor(p, count, docIds);
+        uint32_t previous = b > 0 ? blocks[b - 1].lastDoc : 0;
+        for (uint32_t i = 0; i < count; i++) {
+            previous += docIds[i];
+            docIds[i] = previous;
+        }
+        for (int f = 0; f < FIELD_COUNT; f++) p = decodePfor(p, count, freqs[f]);
+        positionsStart = positionsAt = p;
+        positionsIndex = 0;
+        decodedBlock = b;
+        index = 0;
+        if (stats) stats->blocksDecoded++;
+    }
+
+    const IndexSegment::DocEntry* docs;
+    const float* avgFieldLength;
+    SearchStats* stats;
+    float idf;
+    float termMax;
+
+    const BlockInfo* blocks;
+    const uint8_t* blockData;
+    uint32_t blockCount;
+    uint32_t block = 0;  // shallow position
+
+    uint32_t decodedBlock = END_DOC;
+    uint32_t index = 0;
+    uint32_t current = END_DOC;
+    uint32_t docIds[BLOCK_SIZE];
+    uint32_t freqs[FIELD_COUNT][BLOCK_SIZE];
+    const uint8_t* positionsStart = nullptr;
+    const uint8_t* positionsAt = nullptr;  // positions of posting positionsIndex
+    uint32_t positionsIndex = 0;
+};
+
+// Top k by score (ties go to the lower document)
+class TopK {
+public:
+    explicit TopK(size_t k) : k(k) {}
+
+    // A document must score above this to enter
+    float threshold() const { return heap.size() < k ? 0 : heap.top().first; }
+
+    void push(float score, uint32_t doc) {
+        if (k == 0) return;
+        if (heap.size() < k) {
+            heap.push({score, doc});
+        } else if (score > heap.top().first) {
+            heap.pop();
+            heap.push({score, doc});
+        }
+    }
+
+    std::vector<std::pair<float, uint32_t>> sorted() {
+        std::vector<std::pair<float, uint32_t>> result;
+        while (!heap.empty()) {
+            result.push_back(heap.top());
+            heap.pop();
+        }
+        std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        return result;
+    }
+
+private:
+    size_t k;
+    std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>,
+                        std::greater<std::pair<float, uint32_t>>> heap;
+};
+
+} // namespace
+
+bool Tokenizer::next(std::string& term) {
+    size_t n = text.size();
+    while (pos < n && !isTermByte(static_cast<unsigned char>(text[pos]))) pos++;
+    if (pos == n) return false;
+    term.clear();
+    for (; pos < n && isTermByte(static_cast<unsigned char>(text[pos])); pos++) {
+        char c = text[pos];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        if (term.size() < MAX_TERM_BYTES) term += c;
+    }
+    return true;
+}
+
+void IndexSegmentWriter::addDocument(int64_t pageId, const std::string& url, const std::string& title,
+                                     const std::string& description, const std::string& content) {
+    uint32_t doc = static_cast<uint32_t>(documents.size());
+    Document document;
+    document.pageId = pageId;
+    document.storedOffset = stored.size();
+    document.urlLength = static_cast<uint32_t>(url.size());
+    document.titleLength = static_cast<uint32_t>(title.size());
+    stored += url;
+    stored += title;
+
+    // Positions run on across fields, with a gap so phrases stay in one field
+    docTerms.clear();
+    const std::string* fields[FIELD_COUNT] = {&title, &description, &content};
+    uint32_t position = 0;
+    std::string term;
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        Tokenizer tokenizer(*fields[f]);
+        uint32_t length = 0;
+        while (tokenizer.next(term)) {
+            DocTerm& entry = docTerms[term];
+            entry.freq[f]++;
+            entry.positions.push_back(position++);
+            length++;
+        }
+        document.fieldLength[f] = length;
+        totalFieldLength[f] += length;
+        position++;
+    }
+    documents.push_back(document);
+
+    for (const auto& [text, entry] : docTerms) {
+        TermPostings& postings = terms[text];
+        putVarint(postings.data, doc - postings.lastDoc);
+        for (int f = 0; f < FIELD_COUNT; f++) putVarint(postings.data, entry.freq[f]);
+        uint32_t previous = 0;
+        for (uint32_t p : entry.positions) {
+            putVarint(postings.data, p - previous);
+            previous = p;
+        }
+        postings.lastDoc = doc;
+        postings.docFreq++;
+    }
+}
+
+bool IndexSegmentWriter::write(const std::string& path) const {
+    // Write to a temporary file and rename, so readers never map a torn file
+    std::string tmpPath = path + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot write index segment: " << tmpPath << std::endl;
+        return false;
+    }
+
+    uint32_t docCount = static_cast<uint32_t>(documents.size());
+    IndexSegment::Header header = {};
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    header.version = SEGMENT_VERSION;
+    header.docCount = docCount;
+    header.termCount = static_cast<uint32_t>(terms.size());
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        header.avgFieldLength[f] = docCount ? static_cast<float>(totalFieldLength[f]) / docCount : 0;
+    }
+
+    bool ok = true;
+    uint64_t offset = 0;
+    auto put = [&](const void* p, size_t n) {
+        ok = ok && (n == 0 || std::fwrite(p, 1, n, file) == n);
+        offset += n;
+    };
+    auto align = [&]() {
+        static const char zeros[8] = {};
+        put(zeros, (8 - offset % 8) % 8);
+    };
+
+    put(&header, sizeof(header));  // rewritten once the offsets are known
+
+    header.docTableOffset = offset;
+    for (const auto& document : documents) {
+        IndexSegment::DocEntry entry = {};
+        entry.pageId = document.pageId;
+        entry.storedOffset = document.storedOffset;
+        std::memcpy(entry.fieldLength, document.fieldLength, sizeof(entry.fieldLength));
+        entry.urlLength = document.urlLength;
+        entry.titleLength = document.titleLength;
+        put(&entry, sizeof(entry));
+    }
+    header.storedOffset = offset;
+    put(stored.data(), stored.size());
+    align();
+
+    std::vector<const std::pair<const std::string, TermPostings>*> sorted;
+    sorted.reserve(terms.size());
+    for (const auto& term : terms) sorted.push_back(&term);
+    std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    header.postingsOffset = offset;
+    std::vector<IndexSegment::TermEntry> entries;
+    entries.reserve(sorted.size());
+    std::string termStrings;
+    std::vector<BlockInfo> blocks;
+    std::string blockData;
+    std::string positions;
+    uint32_t docGaps[BLOCK_SIZE];
+    uint32_t freqs[FIELD_COUNT][BLOCK_SIZE];
+
+    for (const auto* term : sorted) {
+        const TermPostings& postings = term->second;
+        float idf = inverseDocFreq(postings.docFreq, docCount);
+        blocks.clear();
+        blockData.clear();
+        positions.clear();
+
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(postings.data.data());
+        uint32_t doc = 0;
+        uint32_t previousLast = 0;
+        uint32_t count = 0;
+        float blockMax = 0;
+        for (uint32_t i = 0; i < postings.docFreq; i++) {
+            uint32_t gap;
+            p = getVarint(p, gap);
+            doc += gap;
+            docGaps[count] = count == 0 ? doc - previousLast : gap;
+            uint32_t freq[FIELD_COUNT];
+            uint32_t total = 0;
+            for (int f = 0; f < FIELD_COUNT; f++) {
+                p = getVarint(p, freq[f]);
+                freqs[f][count] = freq[f];
+                total += freq[f];
+            }
+            const uint8_t* positionsBegin = p;
+            uint32_t v;
+            for (uint32_t n = 0; n < total; n++) p = getVarint(p, v);
+            positions.append(reinterpret_cast<const char*>(positionsBegin), p - positionsBegin);
+
+            blockMax = std::max(blockMax, termScore(idf, freq, documents[doc].fieldLength, header.avgFieldLength));
+            count++;
+
+            if (count == BLOCK_SIZE || i + 1 == postings.docFreq) {
+                // The bound is rounded up so a query can never score a posting
+                // a hair above it
+                BlockInfo info = {doc, static_cast<uint32_t>(blockData.size()), std::nextafter(blockMax, 1e30f), count};
+                blocks.push_back(info);
+                encodePfor(docGaps, count, blockData);
+                for (int f = 0; f < FIELD_COUNT; f++) encodePfor(freqs[f], count, blockData);
+                blockData += positions;
+                positions.clear();
+                previousLast = doc;
+                count = 0;
+                blockMax = 0;
+            }
+        }
+
+        IndexSegment::TermEntry entry = {};
+        entry.postingsOffset = offset;
+        entry.stringOffset = termStrings.size();
+        entry.stringLength = static_cast<uint32_t>(term->first.size());
+        entry.docFreq = postings.docFreq;
+        entry.blockCount = static_cast<uint32_t>(blocks.size());
+        for (const auto& block : blocks) entry.maxScore = std::max(entry.maxScore, block.maxScore);
+        entries.push_back(entry);
+        termStrings += term->first;
+
+        put(blocks.data(), blocks.size() * sizeof(BlockInfo));
+        put(blockData.data(), blockData.size());
+        align();
+    }
+
+    header.termStringsOffset = offset;
+    put(termStrings.data(), termStrings.size());
+    align();
+    header.termTableOffset = offset;
+    put(entries.data(), entries.size() * sizeof(IndexSegment::TermEntry));
+    header.fileSize = offset;
+
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write index segment: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to write a segment over every page in the database
+long buildIndexSegment(sqlite3* db, const std::string& path) {
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT id, url, title, description, content FROM pages ORDER BY id";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to read pages: " << sqlite3_errmsg(db) << std::endl;
+        return -1;
+    }
+
+    auto text = [stmt](int column) {
+        const unsigned char* value = sqlite3_column_text(stmt, column);
+        return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+    };
+    IndexSegmentWriter writer;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        writer.addDocument(sqlite3_column_int64(stmt, 0), text(1), text(2), text(3), text(4));
+    }
+    sqlite3_finalize(stmt);
+
+    if (!writer.write(path)) return -1;
+    return static_cast<long>(writer.documentCount());
+}
+
+struct IndexSegment::Query {
+    std::vector<const TermEntry*> terms;       // distinct terms found in the segment
+    std::vector<std::vector<size_t>> phrases;  // indexes into terms, in phrase order
+    std::vector<size_t> required;              // single quoted terms, indexes into terms
+
+    bool quoted() const { return !phrases.empty() || !required.empty(); }
+};
+
+IndexSegment::IndexSegment(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open index segment: " << path << std::endl;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            size = static_cast<size_t>(st.st_size);
+        }
+    }
+    close(fd);
+
+    const Header* candidate = reinterpret_cast<const Header*>(data);
+    if (!data || std::memcmp(candidate->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 ||
+        candidate->version != SEGMENT_VERSION || candidate->fileSize != size) {
+        std::cerr << "Invalid index segment: " << path << std::endl;
+        return;
+    }
+    header = candidate;
+    docs = reinterpret_cast<const DocEntry*>(data + header->docTableOffset);
+    terms = reinterpret_cast<const TermEntry*>(data + header->termTableOffset);
+}
+
+IndexSegment::~IndexSegment() {
+    if (data) munmap(const_cast<char*>(data), size);
+}
+
+uint32_t IndexSegment::documentCount() const {
+    return header ? header->docCount : 0;
+}
+
+uint32_t IndexSegment::termCount() const {
+    return header ? header->termCount : 0;
+}
+
+const IndexSegment::TermEntry* IndexSegment::findTerm(std::string_view term) const {
+    const char* strings = data + header->termStringsOffset;
+    auto termAt = [&](const TermEntry& entry) { return std::string_view(strings + entry.stringOffset, entry.stringLength); };
+    const TermEntry* end = terms + header->termCount;
+    const TermEntry* found = std::lower_bound(terms, end, term, [&](const TermEntry& entry, std::string_view value) {
+        return termAt(entry) < value;
+    });
+    return found != end && termAt(*found) == term ? found : nullptr;
+}
+
+// Split a query into terms and "quoted phrases". Returns false if nothing
+// can match (no known term, or a phrase with an unknown term).
+bool IndexSegment::parseQuery(const std::string& text, Query& query) const {
+    auto addTerm = [&](const TermEntry* entry) {
+        auto existing = std::find(query.terms.begin(), query.terms.end(), entry);
+        if (existing != query.terms.end()) return static_cast<size_t>(existing - query.terms.begin());
+        query.terms.push_back(entry);
+        return query.terms.size() - 1;
+    };
+
+    bool quoted = false;
+    size_t start = 0;
+    for (size_t i = 0; i <= text.size(); i++) {
+        if (i < text.size() && text[i] != '"') continue;
+        Tokenizer tokenizer(std::string_view(text).substr(start, i - start));
+        std::vector<size_t> phrase;
+        std::string term;
+        while (tokenizer.next(term)) {
+            const TermEntry* entry = findTerm(term);
+            if (entry) phrase.push_back(addTerm(entry));
+            else if (quoted) return false;
+        }
+        if (quoted && phrase.size() == 1) query.required.push_back(phrase[0]);
+        if (quoted && phrase.size() > 1) query.phrases.push_back(std::move(phrase));
+        quoted = !quoted;
+        start = i + 1;
+    }
+    return !query.terms.empty();
+}
+
+SearchHit IndexSegment::makeHit(uint32_t doc, float score) const {
+    const DocEntry& entry = docs[doc];
+    const char* stored = data + header->storedOffset + entry.storedOffset;
+    return {doc, score, entry.pageId, std::string_view(stored, entry.urlLength),
+            std::string_view(stored + entry.urlLength, entry.titleLength)};
+}
+
+namespace {
+
+// Whether every quoted term and phrase occurs in doc (all their cursors
+// must be on doc)
+bool matchesQuoted(const std::vector<size_t>& required, const std::vector<std::vector<size_t>>& phrases,
+                   std::vector<PostingCursor>& cursors, uint32_t doc) {
+    for (size_t slot : required) {
+        if (cursors[slot].doc() != doc) return false;
+    }
+    std::vector<uint32_t> candidates, positions;
+    for (const auto& phrase : phrases) {
+        for (size_t slot : phrase) {
+            if (cursors[slot].doc() != doc) return false;
+        }
+        cursors[phrase[0]].positions(candidates);
+        for (size_t i = 1; i < phrase.size() && !candidates.empty(); i++) {
+            cursors[phrase[i]].positions(positions);
+            auto kept = std::remove_if(candidates.begin(), candidates.end(), [&](uint32_t start) {
+                return !std::binary_search(positions.begin(), positions.end(), start + static_cast<uint32_t>(i));
+            });
+            candidates.erase(kept, candidates.end());
+        }
+        if (candidates.empty()) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<SearchHit> IndexSegment::search(const std::string& text, size_t k, SearchStats* stats) const {
+    std::vector<SearchHit> hits;
+    Query query;
+    if (!ok() || !parseQuery(text, query)) return hits;
+
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(query.terms.size());
+    for (const TermEntry* term : query.terms) {
+        cursors.emplace_back(data, *term, docs, header->avgFieldLength, header->docCount, stats);
+    }
+    std::vector<PostingCursor*> order;
+    for (auto& cursor : cursors) order.push_back(&cursor);
+    auto byDoc = [](const PostingCursor* a, const PostingCursor* b) { return a->doc() < b->doc(); };
+
+    // Block-max WAND (Ding & Suel, 2011)
+    TopK top(k);
+    while (true) {
+        std::sort(order.begin(), order.end(), byDoc);
+        float threshold = top.threshold();
+
+        // Pivot: the first cursor at which the terms' bounds add up past the threshold
+        float bound = 0;
+        size_t pivot = order.size();
+        for (size_t i = 0; i < order.size() && order[i]->doc() != END_DOC; i++) {
+            bound += order[i]->maxScore();
+            if (bound > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) break;
+        uint32_t pivotDoc = order[pivot]->doc();
+        while (pivot + 1 < order.size() && order[pivot + 1]->doc() == pivotDoc) pivot++;
+
+        // Refine the bound with the blocks that would hold the pivot document
+        float blockBound = 0;
+        for (size_t i = 0; i <= pivot; i++) {
+            order[i]->shallowSeek(pivotDoc);
+            blockBound += order[i]->blockMaxScore();
+        }
+
+        if (blockBound <= threshold) {
+            // Nothing up to the end of the nearest of these blocks can make it
+            uint32_t next = END_DOC;
+            for (size_t i = 0; i <= pivot; i++) next = std::min(next, order[i]->blockLastDoc());
+            next = next == END_DOC ? END_DOC : next + 1;
+            if (pivot + 1 < order.size()) next = std::min(next, order[pivot + 1]->doc());
+            for (size_t i = 0; i <= pivot; i++) {
+                if (order[i]->doc() < next) order[i]->seek(next);
+            }
+            continue;
+        }
+
+        if (order[0]->doc() == pivotDoc) {
+            // Summed in query order, like searchExhaustive(), so both agree to the bit
+            float score = 0;
+            for (auto& cursor : cursors) {
+                if (cursor.doc() == pivotDoc) score += cursor.score();
+            }
+            if (score > threshold &&
+                (!query.quoted() || matchesQuoted(query.required, query.phrases, cursors, pivotDoc))) {
+                top.push(score, pivotDoc);
+            }
+            for (size_t i = 0; i <= pivot; i++) order[i]->next();
+        } else {
+            for (size_t i = 0; i < pivot; i++) {
+                if (order[i]->doc() < pivotDoc) order[i]->seek(pivotDoc);
+            }
+        }
+    }
+
+    for (const auto& [score, doc] : top.sorted()) hits.push_back(makeHit(doc, score));
+    return hits;
+}
+
+std::vector<SearchHit> IndexSegment::searchExhaustive(const std::string& text, size_t k, SearchStats* stats) const {
+    std::vector<SearchHit> hits;
+    Query query;
+    if (!ok() || !parseQuery(text, query)) return hits;
+
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(query.terms.size());
+    for (const TermEntry* term : query.terms) {
+        cursors.emplace_back(data, *term, docs, header->avgFieldLength, header->docCount, stats);
+    }
+
+    TopK top(k);
+    while (true) {
+        uint32_t doc = END_DOC;
+        for (const auto& cursor : cursors) doc = std::min(doc, cursor.doc());
+        if (doc == END_DOC) break;
+        float score = 0;
+        for (auto& cursor : cursors) {
+            if (cursor.doc() == doc) score += cursor.score();
+        }
+        if (!query.quoted() || matchesQuoted(query.required, query.phrases, cursors, doc)) top.push(score, doc);
+        for (auto& cursor : cursors) {
+            if (cursor.doc() == doc) cursor.next();
+        }
+    }
+
+    for (const auto& [score, doc] : top.sorted()) hits.push_back(makeHit(doc, score));
+    return hits;
+}
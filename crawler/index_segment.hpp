@@ -0,0 +1,144 @@
+#ifndef INDEX_SEGMENT_HPP
+#define INDEX_SEGMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+
+// Fields of a page, in the order their lengths and term counts are stored
+enum IndexField { FIELD_TITLE = 0, FIELD_DESCRIPTION = 1, FIELD_CONTENT = 2, FIELD_COUNT = 3 };
+
+// Splits text into lowercased terms: runs of ASCII letters and digits, with
+// bytes of multibyte UTF-8 characters counted as letters. Terms longer than
+// MAX_TERM_BYTES are cut.
+class Tokenizer {
+public:
+    static const size_t MAX_TERM_BYTES = 64;
+
+    explicit Tokenizer(std::string_view text) : text(text) {}
+
+    // Store the next term in term; false at the end of the text
+    bool next(std::string& term);
+
+private:
+    std::string_view text;
+    size_t pos = 0;
+};
+
+// Builds an immutable index segment in memory and writes it to one file.
+// Documents are numbered in the order they are added.
+//
+// File layout (host byte order, sections 8-byte aligned): header, document
+// table (page id, field lengths, URL and title), stored URLs and titles,
+// postings, term strings and the term table sorted by term. Each term's
+// postings are blocks of up to 128 documents, preceded by one skip entry
+// per block (last document, offset and the block's highest BM25F score).
+// A block holds PFOR-coded document gaps and per-field term frequencies,
+// followed by varint-coded positions.
+class IndexSegmentWriter {
+public:
+    // pageId is returned with search hits so they can be joined with pages
+    void addDocument(int64_t pageId, const std::string& url, const std::string& title,
+                     const std::string& description, const std::string& content);
+
+    size_t documentCount() const { return documents.size(); }
+    size_t termCount() const { return terms.size(); }
+
+    // Write the segment to a temporary file and rename it into place
+    bool write(const std::string& path) const;
+
+private:
+    struct Document {
+        int64_t pageId;
+        uint64_t storedOffset;
+        uint32_t fieldLength[FIELD_COUNT];
+        uint32_t urlLength;
+        uint32_t titleLength;
+    };
+
+    // Postings of one term while building: per document the gap from the
+    // previous document, the three field frequencies and the position gaps,
+    // all as varints
+    struct TermPostings {
+        uint32_t docFreq = 0;
+        uint32_t lastDoc = 0;
+        std::string data;
+    };
+
+    struct DocTerm {
+        uint32_t freq[FIELD_COUNT] = {};
+        std::vector<uint32_t> positions;
+    };
+
+    std::vector<Document> documents;
+    std::string stored;  // URL and title of every document
+    std::unordered_map<std::string, TermPostings> terms;
+    uint64_t totalFieldLength[FIELD_COUNT] = {};
+    std::unordered_map<std::string, DocTerm> docTerms;  // reused per document
+};
+
+// Function to write a segment over every page in the database. Returns the
+// number of documents indexed, or -1 on error.
+long buildIndexSegment(sqlite3* db, const std::string& path);
+
+struct SearchHit {
+    uint32_t doc;
+    float score;
+    int64_t pageId;
+    std::string_view url;    // point into the mapped segment
+    std::string_view title;
+};
+
+struct SearchStats {
+    size_t blocksDecoded = 0;
+    size_t documentsScored = 0;
+};
+
+// A segment file mapped read-only. Queries are a list of terms, scored with
+// BM25F over title, description and content; any term may match. A quoted
+// "phrase" must appear in a document, with its terms next to each other in
+// one field; a single quoted "term" must appear in it. search() finds the top k with block-max WAND, which skips the
+// blocks whose score bound cannot reach the current top k. Thread-safe.
+class IndexSegment {
+public:
+    explicit IndexSegment(const std::string& path);
+    ~IndexSegment();
+
+    IndexSegment(const IndexSegment&) = delete;
+    IndexSegment& operator=(const IndexSegment&) = delete;
+
+    bool ok() const { return header != nullptr; }
+
+    uint32_t documentCount() const;
+    uint32_t termCount() const;
+    size_t fileSize() const { return size; }
+
+    std::vector<SearchHit> search(const std::string& query, size_t k = 10, SearchStats* stats = nullptr) const;
+
+    // Scores every posting of every query term (for checking search())
+    std::vector<SearchHit> searchExhaustive(const std::string& query, size_t k = 10,
+                                            SearchStats* stats = nullptr) const;
+
+    struct Header;
+    struct DocEntry;
+    struct TermEntry;
+
+private:
+    struct Query;
+
+    bool parseQuery(const std::string& text, Query& query) const;
+    const TermEntry* findTerm(std::string_view term) const;
+    SearchHit makeHit(uint32_t doc, float score) const;
+
+    const char* data = nullptr;
+    size_t size = 0;
+    const Header* header = nullptr;
+    const DocEntry* docs = nullptr;
+    const TermEntry* terms = nullptr;
+};
+
+#endif // INDEX_SEGMENT_HPP
@@ -0,0 +1,256 @@
+#include "logger.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <strings.h>
+
+namespace {
+
+// How long the drain thread sleeps when the ring is empty
+const auto DRAIN_IDLE = std::chrono::milliseconds(2);
+
+const char* const LEVEL_NAMES[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+
+size_t roundUpToPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+LogLevel parseLogLevel(const char* name, LogLevel fallback) {
+    if (!name) return fallback;
+    if (strcasecmp(name, "debug") == 0) return LOG_DEBUG;
+    if (strcasecmp(name, "info") == 0) return LOG_INFO;
+    if (strcasecmp(name, "warn") == 0 || strcasecmp(name, "warning") == 0) return LOG_WARN;
+    if (strcasecmp(name, "error") == 0) return LOG_ERROR;
+    if (strcasecmp(name, "off") == 0) return LOG_OFF;
+    return fallback;
+}
+
+const char* logLevelName(LogLevel level) {
+    static const char* const names[] = {"debug", "info", "warn", "error", "off"};
+    return names[level];
+}
+
+AsyncLogger::AsyncLogger(const LoggerConfig& config) : config(config) {
+    size_t capacity = roundUpToPowerOfTwo(std::max<size_t>(config.capacity, 2));
+    mask = capacity - 1;
+    slots.reset(new Slot[capacity]);
+    for (size_t i = 0; i < capacity; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+    drainThread = std::thread(&AsyncLogger::drain, this);
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+}
+
+// Take the next free slot (bounded MPMC queue after Dmitry Vyukov). A slot
+// is free for position pos when its sequence is pos; publish() sets it to
+// pos + 1 and the drain thread hands it back as pos + capacity.
+AsyncLogger::Slot* AsyncLogger::claim() {
+    if (stopping.load(std::memory_order_relaxed)) {
+        dropped++;
+        return nullptr;
+    }
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &slots[pos & mask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return slot;
+        } else if (diff < 0) {
+            dropped++;  // full
+            return nullptr;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncLogger::publish(Slot* slot) {
+    slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// At most debugPerSecond debug lines per wall-clock second, over all threads
+bool AsyncLogger::allowDebug() {
+    uint64_t second = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    uint64_t state = debugWindow.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t next;
+        if ((state >> 32) != (second & 0xffffffff)) {
+            next = (second << 32) | 1;
+        } else if ((state & 0xffffffff) >= config.debugPerSecond) {
+            suppressed++;
+            return false;
+        } else {
+            next = state + 1;
+        }
+        if (debugWindow.compare_exchange_weak(state, next, std::memory_order_relaxed)) return true;
+    }
+}
+
+void AsyncLogger::flush() {
+    uint64_t target = enqueuePos.load();
+    std::unique_lock<std::mutex> lock(waitMutex);
+    flushedCv.wait(lock, [&]() { return consumed.load() >= target || drainFinished; });
+}
+
+void AsyncLogger::stop() {
+    if (stopping.exchange(true)) return;
+    if (drainThread.joinable()) drainThread.join();
+}
+
+// Render one record as a line
+void AsyncLogger::formatRecord(const Slot& slot, std::string& out) {
+    const Header& header = slot.header;
+    if (config.timestamps) {
+        // Lines come in time order, so the clock part changes once a second
+        int64_t second = header.timeNs / 1000000000;
+        if (second != stampSecond) {
+            time_t seconds = static_cast<time_t>(second);
+            struct tm local;
+            localtime_r(&seconds, &local);
+            std::strftime(stamp, sizeof(stamp), "%H:%M:%S.", &local);
+            stampSecond = second;
+        }
+        char millis[5];
+        int ms = static_cast<int>(header.timeNs / 1000000 % 1000);
+        millis[0] = static_cast<char>('0' + ms / 100);
+        millis[1] = static_cast<char>('0' + ms / 10 % 10);
+        millis[2] = static_cast<char>('0' + ms % 10);
+        millis[3] = ' ';
+        millis[4] = '\0';
+        out += stamp;
+        out += millis;
+        out += LEVEL_NAMES[header.level];
+        out += ' ';
+    }
+
+    const char* args = slot.args;
+    const char* argsEnd = slot.args + header.argBytes;
+    char number[64];
+    for (const char* p = header.format; *p; p++) {
+        if (p[0] != '{' || (p[1] != '}' && p[1] != ':')) {
+            out += *p;
+            continue;
+        }
+        const char* close = std::strchr(p, '}');
+        if (!close) {
+            out += p;
+            break;
+        }
+        int decimals = -1;
+        if (p[1] == ':' && p[2] == '.') decimals = std::atoi(p + 3);
+        p = close;
+
+        if (args >= argsEnd) {
+            out += "?";  // argument did not fit in the record
+            continue;
+        }
+        char type = *args++;
+        switch (type) {
+        case ARG_INT: {
+            int64_t v;
+            std::memcpy(&v, args, sizeof(v));
+            args += sizeof(v);
+            out.append(number, std::to_chars(number, number + sizeof(number), v).ptr);
+            break;
+        }
+        case ARG_UINT: {
+            uint64_t v;
+            std::memcpy(&v, args, sizeof(v));
+            args += sizeof(v);
+            out.append(number, std::to_chars(number, number + sizeof(number), v).ptr);
+            break;
+        }
+        case ARG_DOUBLE: {
+            double v;
+            std::memcpy(&v, args, sizeof(v));
+            args += sizeof(v);
+            if (decimals >= 0) std::snprintf(number, sizeof(number), "%.*f", decimals, v);
+            else std::snprintf(number, sizeof(number), "%g", v);
+            out += number;
+            break;
+        }
+        case ARG_BOOL:
+            out += *args++ ? "true" : "false";
+            break;
+        case ARG_CHAR:
+            out += *args++;
+            break;
+        case ARG_STRING: {
+            uint16_t length;
+            std::memcpy(&length, args, 2);
+            out.append(args + 2, length);
+            args += 2 + length;
+            break;
+        }
+        default:
+            args = argsEnd;
+        }
+    }
+    out += '\n';
+}
+
+// Background thread: take published records in order, format them and
+// write each batch with one fwrite per stream
+void AsyncLogger::drain() {
+    std::string text, errorText;
+    size_t reportedSuppressed = 0;
+    size_t reportedDropped = 0;
+    while (true) {
+        bool finishing = stopping.load();
+        size_t batch = 0;
+        while (true) {
+            Slot& slot = slots[dequeuePos & mask];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) break;
+            formatRecord(slot, slot.header.level >= LOG_WARN ? errorText : text);
+            slot.sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+            dequeuePos++;
+            batch++;
+        }
+
+        // Lines lost to the rate limit or a full ring since the last report
+        size_t nowSuppressed = suppressed.load();
+        size_t nowDropped = dropped.load();
+        if (nowSuppressed != reportedSuppressed && (batch == 0 || finishing)) {
+            text += "(" + std::to_string(nowSuppressed - reportedSuppressed) + " debug lines over " +
+                    std::to_string(config.debugPerSecond) + "/sec not shown)\n";
+            reportedSuppressed = nowSuppressed;
+        }
+        if (nowDropped != reportedDropped && (batch == 0 || finishing)) {
+            errorText += "(" + std::to_string(nowDropped - reportedDropped) + " log lines dropped, queue full)\n";
+            reportedDropped = nowDropped;
+        }
+
+        if (!text.empty()) {
+            std::fwrite(text.data(), 1, text.size(), config.out);
+            std::fflush(config.out);
+            text.clear();
+        }
+        if (!errorText.empty()) {
+            std::fwrite(errorText.data(), 1, errorText.size(), config.errorOut);
+            std::fflush(config.errorOut);
+            errorText.clear();
+        }
+        if (batch > 0) {
+            written += batch;
+            consumed.store(dequeuePos);
+            std::lock_guard<std::mutex> lock(waitMutex);
+            flushedCv.notify_all();
+        }
+
+        if (finishing && batch == 0) break;
+        if (batch == 0) std::this_thread::sleep_for(DRAIN_IDLE);
+    }
+
+    std::lock_guard<std::mutex> lock(waitMutex);
+    drainFinished = true;
+    flushedCv.notify_all();
+}
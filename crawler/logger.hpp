@@ -0,0 +1,194 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+enum LogLevel { LOG_DEBUG = 0, LOG_INFO, LOG_WARN, LOG_ERROR, LOG_OFF };
+
+// Function to read a level name ("debug", "info", "warn", "error", "off");
+// returns fallback for anything else
+LogLevel parseLogLevel(const char* name, LogLevel fallback = LOG_INFO);
+
+// Function to get the lowercase name of a level
+const char* logLevelName(LogLevel level);
+
+struct LoggerConfig {
+    LogLevel level = LOG_INFO;
+    size_t capacity = 4096;         // records in the ring (rounded up to a power of two)
+    unsigned debugPerSecond = 20;   // debug lines let through per second; the rest are counted
+    FILE* out = stdout;             // debug and info
+    FILE* errorOut = stderr;        // warn and error
+    bool timestamps = true;
+};
+
+// Leveled logger that keeps formatting and I/O off the calling thread.
+// A call copies its arguments in binary form (integers, floating point,
+// bools, chars and strings) into one fixed-size record of a bounded
+// lock-free ring and returns. A background thread turns records into text
+// ("{}" in the format is replaced by the next argument, "{:.N}" prints a
+// floating point argument with N decimals) and writes them in batches.
+//
+// Callers never block: when the ring is full the line is dropped and
+// counted. Strings that do not fit in a record are cut short. The format
+// string is not copied, so it must be a literal (or otherwise outlive the
+// logger).
+class AsyncLogger {
+public:
+    static const size_t RECORD_BYTES = 512;
+
+    explicit AsyncLogger(const LoggerConfig& config = LoggerConfig());
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    bool enabled(LogLevel level) const { return level >= config.level; }
+
+    template <typename... Args>
+    void debug(const char* format, const Args&... args) {
+        if (enabled(LOG_DEBUG) && allowDebug()) log(LOG_DEBUG, format, args...);
+    }
+    template <typename... Args>
+    void info(const char* format, const Args&... args) {
+        if (enabled(LOG_INFO)) log(LOG_INFO, format, args...);
+    }
+    template <typename... Args>
+    void warn(const char* format, const Args&... args) {
+        if (enabled(LOG_WARN)) log(LOG_WARN, format, args...);
+    }
+    template <typename... Args>
+    void error(const char* format, const Args&... args) {
+        if (enabled(LOG_ERROR)) log(LOG_ERROR, format, args...);
+    }
+
+    // Wait until every line logged before the call has been written
+    void flush();
+
+    // Write what is queued and end the background thread (later lines are dropped)
+    void stop();
+
+    size_t writtenCount() const { return written.load(); }
+    size_t droppedCount() const { return dropped.load(); }
+    size_t suppressedCount() const { return suppressed.load(); }  // debug lines over the rate limit
+
+private:
+    enum ArgType : char { ARG_INT = 'i', ARG_UINT = 'u', ARG_DOUBLE = 'd', ARG_BOOL = 'b', ARG_CHAR = 'c',
+                          ARG_STRING = 's' };
+
+    struct Header {
+        const char* format;
+        int64_t timeNs;     // wall clock
+        LogLevel level;
+        uint16_t argBytes;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence;
+        Header header;
+        char args[RECORD_BYTES - sizeof(std::atomic<uint64_t>) - sizeof(Header)];
+    };
+
+    // Appends arguments to a slot's args area
+    struct Encoder {
+        char* data;
+        size_t capacity;
+        size_t size = 0;
+
+        void put(ArgType type, const void* value, size_t length) {
+            if (size + 1 + length > capacity) return;
+            data[size++] = type;
+            std::memcpy(data + size, value, length);
+            size += length;
+        }
+        void putString(std::string_view s) {
+            if (size + 3 > capacity) return;
+            uint16_t length = static_cast<uint16_t>(std::min(s.size(), capacity - size - 3));
+            data[size++] = ARG_STRING;
+            std::memcpy(data + size, &length, 2);
+            std::memcpy(data + size + 2, s.data(), length);
+            size += 2 + length;
+        }
+    };
+
+    template <typename T>
+    static void encode(Encoder& encoder, const T& value) {
+        if constexpr (std::is_same_v<T, bool>) {
+            encoder.put(ARG_BOOL, &value, 1);
+        } else if constexpr (std::is_same_v<T, char>) {
+            encoder.put(ARG_CHAR, &value, 1);
+        } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+            if constexpr (std::is_signed_v<T>) {
+                int64_t v = static_cast<int64_t>(value);
+                encoder.put(ARG_INT, &v, sizeof(v));
+            } else {
+                uint64_t v = static_cast<uint64_t>(value);
+                encoder.put(ARG_UINT, &v, sizeof(v));
+            }
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double v = static_cast<double>(value);
+            encoder.put(ARG_DOUBLE, &v, sizeof(v));
+        } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+            const char* s = value;
+            encoder.putString(s ? std::string_view(s) : std::string_view("(null)"));
+        } else {
+            // std::string, std::pmr::string, std::string_view, ...
+            encoder.putString(std::string_view(value.data(), value.size()));
+        }
+    }
+
+    template <typename... Args>
+    void log(LogLevel level, const char* format, const Args&... args) {
+        Slot* slot = claim();
+        if (!slot) return;
+        Encoder encoder{slot->args, sizeof(slot->args)};
+        (encode(encoder, args), ...);
+        slot->header.format = format;
+        timespec now;
+        clock_gettime(CLOCK_REALTIME_COARSE, &now);  // a few ms resolution, much cheaper than a precise read
+        slot->header.timeNs = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+        slot->header.level = level;
+        slot->header.argBytes = static_cast<uint16_t>(encoder.size);
+        publish(slot);
+    }
+
+    Slot* claim();
+    void publish(Slot* slot);
+    bool allowDebug();
+    void drain();
+    void formatRecord(const Slot& slot, std::string& out);
+
+    LoggerConfig config;
+    size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<uint64_t> enqueuePos{0};
+    uint64_t dequeuePos = 0;  // drain thread only
+    int64_t stampSecond = -1; // drain thread only: the second formatted in stamp
+    char stamp[16] = {};
+
+    std::atomic<uint64_t> debugWindow{0};  // second << 32 | debug lines in it
+    std::atomic<size_t> written{0};
+    std::atomic<size_t> dropped{0};
+    std::atomic<size_t> suppressed{0};
+    std::atomic<uint64_t> consumed{0};      // records taken out of the ring
+
+    std::mutex waitMutex;
+    std::condition_variable flushedCv;
+    bool drainFinished = false;  // guarded by waitMutex
+    std::atomic<bool> stopping{false};
+    std::thread drainThread;
+};
+
+#endif // LOGGER_HPP
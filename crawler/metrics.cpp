@@ -0,0 +1,278 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "dns", "connect", "tls", "first_byte", "transfer", "fetch", "parse", "validate", "store", "commit",
+};
+
+struct CounterInfo {
+    const char* name;  // without the crawler_ prefix and _total suffix
+    const char* help;
+};
+
+const CounterInfo COUNTERS[COUNTER_COUNT] = {
+    {"fetch_errors", "Transfers that failed (DNS, connect, TLS, timeout, ...)"},
+    {"downloaded_bytes", "Response body bytes received"},
+    {"new_connections", "Transfers that opened a new connection"},
+    {"reused_connections", "Transfers that reused a cached connection"},
+    {"pages_invalid", "Pages that failed the quality check"},
+    {"pages_duplicate", "Pages recorded as near-duplicates"},
+    {"skipped_content_type", "Downloads aborted because the Content-Type was not HTML"},
+    {"skipped_content_length", "Downloads aborted because the Content-Length was over the byte budget"},
+    {"skipped_body_bytes", "Downloads aborted when the body grew past the byte budget"},
+    {"sitemap_urls", "URLs queued into the frontier from sitemaps"},
+};
+
+const double QUANTILES[] = {0.5, 0.9, 0.99};
+
+// Every thread's metrics, in registration order
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadMetrics>>& registry() {
+    static std::vector<std::unique_ptr<ThreadMetrics>> threads;
+    return threads;
+}
+
+// Number of significant bits (0 for 0)
+int bitLength(uint64_t value) {
+    return value ? 64 - __builtin_clzll(value) : 0;
+}
+
+} // namespace
+
+const char* stageName(MetricStage stage) {
+    return STAGE_NAMES[stage];
+}
+
+const char* counterName(MetricCounter counter) {
+    return COUNTERS[counter].name;
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t micros) {
+    if (micros < SUB_BUCKETS) return static_cast<size_t>(micros);
+    int bits = bitLength(micros);
+    if (bits > MAX_BITS) return BUCKET_COUNT - 1;
+    int shift = bits - SUB_BUCKET_BITS - 1;
+    return static_cast<size_t>((shift + 1) * SUB_BUCKETS + ((micros >> shift) & (SUB_BUCKETS - 1)));
+}
+
+uint64_t LatencyHistogram::bucketLow(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+    return (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+uint64_t LatencyHistogram::bucketHigh(size_t bucket) {
+    return bucket + 1 < BUCKET_COUNT ? bucketLow(bucket + 1) - 1 : UINT64_MAX;
+}
+
+void LatencyHistogram::record(uint64_t micros) {
+    buckets[bucketOf(micros)]++;
+    total++;
+    sum += micros;
+    max = std::max(max, micros);
+}
+
+uint64_t LatencyHistogram::quantile(double q) const {
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; b++) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(bucketHigh(b), max);
+    }
+    return max;
+}
+
+LatencyHistogram LatencyHistogram::since(const LatencyHistogram& earlier) const {
+    LatencyHistogram delta;
+    for (size_t b = 0; b < BUCKET_COUNT; b++) delta.buckets[b] = buckets[b] - earlier.buckets[b];
+    delta.total = total - earlier.total;
+    delta.sum = sum - earlier.sum;
+    // The interval's max lies in its highest non-empty bucket; the overall
+    // max bounds it when that bucket also holds the overall max
+    for (size_t b = BUCKET_COUNT; b-- > 0;) {
+        if (delta.buckets[b] > 0) {
+            delta.max = std::min(bucketHigh(b), max);
+            break;
+        }
+    }
+    return delta;
+}
+
+MetricsSnapshot MetricsSnapshot::since(const MetricsSnapshot& earlier) const {
+    MetricsSnapshot delta;
+    for (int s = 0; s < STAGE_COUNT; s++) delta.stages[s] = stages[s].since(earlier.stages[s]);
+    for (int c = 0; c < COUNTER_COUNT; c++) delta.counters[c] = counters[c] - earlier.counters[c];
+    return delta;
+}
+
+void ThreadMetrics::record(MetricStage stage, uint64_t micros) {
+    // Single writer: plain load + store instead of read-modify-write
+    auto bump = [](std::atomic<uint64_t>& value, uint64_t n) {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    };
+    Stage& s = stages[stage];
+    bump(s.buckets[LatencyHistogram::bucketOf(micros)], 1);
+    bump(s.total, 1);
+    bump(s.sum, micros);
+    if (micros > s.max.load(std::memory_order_relaxed)) s.max.store(micros, std::memory_order_relaxed);
+}
+
+void ThreadMetrics::addTo(MetricsSnapshot& snapshot) const {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const Stage& s = stages[i];
+        LatencyHistogram& h = snapshot.stages[i];
+        for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+            h.buckets[b] += s.buckets[b].load(std::memory_order_relaxed);
+        }
+        h.total += s.total.load(std::memory_order_relaxed);
+        h.sum += s.sum.load(std::memory_order_relaxed);
+        h.max = std::max(h.max, s.max.load(std::memory_order_relaxed));
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) snapshot.counters[c] += counters[c].load(std::memory_order_relaxed);
+}
+
+ThreadMetrics& threadMetrics() {
+    thread_local ThreadMetrics* metrics = nullptr;
+    if (!metrics) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry().push_back(std::make_unique<ThreadMetrics>());
+        metrics = registry().back().get();
+    }
+    return *metrics;
+}
+
+MetricsSnapshot metricsSnapshot() {
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& metrics : registry()) metrics->addTo(snapshot);
+    return snapshot;
+}
+
+std::string formatPrometheus(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    out << std::setprecision(9);
+    out << "# HELP crawler_stage_seconds Time spent in each stage of crawling a page\n";
+    out << "# TYPE crawler_stage_seconds summary\n";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const LatencyHistogram& h = snapshot.stages[s];
+        const char* stage = STAGE_NAMES[s];
+        for (double q : QUANTILES) {
+            out << "crawler_stage_seconds{stage=\"" << stage << "\",quantile=\"" << q << "\"} "
+                << h.quantile(q) / 1e6 << "\n";
+        }
+        out << "crawler_stage_seconds_sum{stage=\"" << stage << "\"} " << h.sumMicros() / 1e6 << "\n";
+        out << "crawler_stage_seconds_count{stage=\"" << stage << "\"} " << h.count() << "\n";
+    }
+    out << "# HELP crawler_stage_max_seconds Longest time seen in each stage\n";
+    out << "# TYPE crawler_stage_max_seconds gauge\n";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        out << "crawler_stage_max_seconds{stage=\"" << STAGE_NAMES[s] << "\"} "
+            << snapshot.stages[s].maxMicros() / 1e6 << "\n";
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << "# HELP crawler_" << COUNTERS[c].name << "_total " << COUNTERS[c].help << "\n";
+        out << "# TYPE crawler_" << COUNTERS[c].name << "_total counter\n";
+        out << "crawler_" << COUNTERS[c].name << "_total " << snapshot.counters[c] << "\n";
+    }
+    return out.str();
+}
+
+std::string formatMetricsSummary(const MetricsSnapshot& snapshot) {
+    auto ms = [](uint64_t micros) { return micros / 1000.0; };
+    std::ostringstream out;
+    out << std::left << std::setw(12) << "stage" << std::right << std::setw(10) << "count" << std::setw(11)
+        << "mean ms" << std::setw(11) << "p50 ms" << std::setw(11) << "p90 ms" << std::setw(11) << "p99 ms"
+        << std::setw(11) << "max ms" << "\n";
+    out << std::fixed << std::setprecision(2);
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const LatencyHistogram& h = snapshot.stages[s];
+        if (h.count() == 0) continue;
+        out << std::left << std::setw(12) << STAGE_NAMES[s] << std::right << std::setw(10) << h.count()
+            << std::setw(11) << h.meanMicros() / 1000 << std::setw(11) << ms(h.quantile(0.5)) << std::setw(11)
+            << ms(h.quantile(0.9)) << std::setw(11) << ms(h.quantile(0.99)) << std::setw(11) << ms(h.maxMicros())
+            << "\n";
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        out << (c ? ", " : "") << COUNTERS[c].name << " " << snapshot.counters[c];
+    }
+    out << "\n";
+    return out.str();
+}
+
+MetricsServer::MetricsServer(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Metrics server: socket failed: " << std::strerror(errno) << std::endl;
+        return;
+    }
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        std::cerr << "Metrics server: cannot listen on 127.0.0.1:" << port << ": " << std::strerror(errno)
+                  << std::endl;
+        close(fd);
+        return;
+    }
+    listenFd = fd;
+    thread = std::thread(&MetricsServer::serve, this);
+}
+
+MetricsServer::~MetricsServer() {
+    stopping = true;
+    if (thread.joinable()) thread.join();
+    if (listenFd >= 0) close(listenFd);
+}
+
+// Answer one request per connection; the poll timeout bounds how long
+// stopping takes
+void MetricsServer::serve() {
+    while (!stopping) {
+        pollfd waiting = {listenFd, POLLIN, 0};
+        if (poll(&waiting, 1, 200) <= 0) continue;
+        int client = accept(listenFd, nullptr, nullptr);
+        if (client < 0) continue;
+
+        timeval timeout = {1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        char request[1024];
+        ssize_t received = recv(client, request, sizeof(request) - 1, 0);
+        bool get = received >= 4 && std::memcmp(request, "GET ", 4) == 0;
+
+        std::string body = get ? formatPrometheus(metricsSnapshot()) : "Only GET is supported\n";
+        std::ostringstream response;
+        response << (get ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 405 Method Not Allowed\r\n")
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+        std::string bytes = response.str();
+        for (size_t sent = 0; sent < bytes.size();) {
+            ssize_t n = send(client, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        close(client);
+        requests++;
+    }
+}
@@ -0,0 +1,180 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// Stages of a page whose durations are recorded. The network stages come
+// from curl's transfer timings (summed over redirects); fetch is the whole
+// transfer as curl saw it.
+enum MetricStage {
+    STAGE_DNS,
+    STAGE_CONNECT,
+    STAGE_TLS,
+    STAGE_FIRST_BYTE,  // request sent until the first response byte
+    STAGE_TRANSFER,    // first byte until the body is complete
+    STAGE_FETCH,
+    STAGE_PARSE,
+    STAGE_VALIDATE,    // quality check, SimHash and the near-duplicate lookup
+    STAGE_STORE,       // savePage in the writer thread
+    STAGE_COMMIT,      // one writer transaction commit
+    STAGE_COUNT
+};
+
+enum MetricCounter {
+    COUNTER_FETCH_ERRORS,
+    COUNTER_DOWNLOADED_BYTES,
+    COUNTER_NEW_CONNECTIONS,
+    COUNTER_REUSED_CONNECTIONS,
+    COUNTER_PAGES_INVALID,
+    COUNTER_PAGES_DUPLICATE,
+    COUNTER_SKIPPED_CONTENT_TYPE,    // downloads aborted by FetchLimits, by reason
+    COUNTER_SKIPPED_CONTENT_LENGTH,
+    COUNTER_SKIPPED_BODY_BYTES,
+    COUNTER_SITEMAP_URLS,            // URLs queued from sitemaps
+    COUNTER_COUNT
+};
+
+const char* stageName(MetricStage stage);
+const char* counterName(MetricCounter counter);
+
+// Durations in microseconds, bucketed HDR-style: values below 16 exactly,
+// larger ones in 16 linear sub-buckets per power of two, so every bucket
+// is within 1/16 of its values. Covers up to 2^40 us (about 12 days).
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int MAX_BITS = 40;
+    static const size_t BUCKET_COUNT = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucketOf(uint64_t micros);
+    static uint64_t bucketLow(size_t bucket);   // smallest value in the bucket
+    static uint64_t bucketHigh(size_t bucket);  // largest value in the bucket
+
+    void record(uint64_t micros);
+
+    uint64_t count() const { return total; }
+    uint64_t sumMicros() const { return sum; }
+    uint64_t maxMicros() const { return max; }
+    double meanMicros() const { return total ? static_cast<double>(sum) / total : 0; }
+
+    // Upper bound of the bucket holding the q-th value (0 <= q <= 1)
+    uint64_t quantile(double q) const;
+
+    // Values recorded here but not in an earlier copy of the same histogram
+    // (the max is the bound of the highest bucket the interval reached)
+    LatencyHistogram since(const LatencyHistogram& earlier) const;
+
+private:
+    friend class ThreadMetrics;
+
+    uint64_t buckets[BUCKET_COUNT] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
+
+// Totals over every thread at one moment
+struct MetricsSnapshot {
+    LatencyHistogram stages[STAGE_COUNT];
+    uint64_t counters[COUNTER_COUNT] = {};
+
+    MetricsSnapshot since(const MetricsSnapshot& earlier) const;
+};
+
+// One thread's histograms and counters. Only the owning thread writes to
+// them (relaxed stores, no locked instructions); snapshot() may read them
+// from any thread at any time.
+class ThreadMetrics {
+public:
+    void record(MetricStage stage, uint64_t micros);
+    void add(MetricCounter counter, uint64_t n) {
+        counters[counter].store(counters[counter].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void addTo(MetricsSnapshot& snapshot) const;
+
+private:
+    struct Stage {
+        std::atomic<uint64_t> buckets[LatencyHistogram::BUCKET_COUNT] = {};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+    };
+
+    Stage stages[STAGE_COUNT];
+    std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+};
+
+// The calling thread's metrics (registered on first use and kept after the
+// thread exits, so its numbers stay in the totals)
+ThreadMetrics& threadMetrics();
+
+inline void recordStage(MetricStage stage, std::chrono::steady_clock::duration elapsed) {
+    threadMetrics().record(stage, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+inline void addCount(MetricCounter counter, uint64_t n = 1) {
+    threadMetrics().add(counter, n);
+}
+
+// Records the time from construction to stop() (or destruction) for a stage
+class StageTimer {
+public:
+    explicit StageTimer(MetricStage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+    ~StageTimer() { stop(); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    void stop() {
+        if (stopped) return;
+        stopped = true;
+        recordStage(stage, std::chrono::steady_clock::now() - start);
+    }
+
+private:
+    MetricStage stage;
+    std::chrono::steady_clock::time_point start;
+    bool stopped = false;
+};
+
+// Function to add up the metrics of every thread
+MetricsSnapshot metricsSnapshot();
+
+// Function to render a snapshot in the Prometheus text format: one summary
+// per stage (crawler_stage_seconds) and one counter per MetricCounter
+std::string formatPrometheus(const MetricsSnapshot& snapshot);
+
+// Function to render a table of count, mean, p50, p90, p99 and max per
+// stage, followed by the counters
+std::string formatMetricsSummary(const MetricsSnapshot& snapshot);
+
+// Serves formatPrometheus(metricsSnapshot()) over HTTP on 127.0.0.1:port
+// from its own thread, for any GET (/metrics by convention).
+class MetricsServer {
+public:
+    explicit MetricsServer(int port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool ok() const { return listenFd >= 0; }
+    size_t requestCount() const { return requests.load(); }
+
+private:
+    void serve();
+
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> requests{0};
+    std::thread thread;
+};
+
+#endif // METRICS_HPP
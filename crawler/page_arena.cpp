@@ -0,0 +1,54 @@
+#include "page_arena.hpp"
+
+#include <algorithm>
+
+PageArena::PageArena(size_t initialBytes, size_t maxRetainedBytes)
+    : blockSize(initialBytes), maxRetainedBytes(std::max(initialBytes, maxRetainedBytes)),
+      block(new char[initialBytes]) {
+    arena.emplace(block.get(), blockSize, &upstream);
+#ifdef HAVE_GUMBO_ALLOCATOR
+    options = kGumboDefaultOptions;
+    options.allocator = gumboAllocate;
+    options.deallocator = gumboDeallocate;
+    options.userdata = this;
+#endif
+}
+
+void PageArena::reset() {
+    resets++;
+    size_t needed = blockSize + upstream.bytes;
+    if (upstream.bytes > 0 && blockSize < maxRetainedBytes) {
+        arena.reset();  // gives the extra blocks back first
+        blockSize = std::min(needed, maxRetainedBytes);
+        block.reset(new char[blockSize]);
+        arena.emplace(block.get(), blockSize, &upstream);
+    } else {
+        arena->release();
+    }
+    upstream.bytes = 0;
+}
+
+void* PageArena::Upstream::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    blocks++;
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void PageArena::Upstream::do_deallocate(void* p, size_t size, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+}
+
+#ifdef HAVE_GUMBO_ALLOCATOR
+void* PageArena::gumboAllocate(void* userdata, size_t size) {
+    return static_cast<PageArena*>(userdata)->resource()->allocate(size, alignof(std::max_align_t));
+}
+
+void PageArena::gumboDeallocate(void*, void*) {
+    // Freed with the rest of the page at the next reset()
+}
+#endif
+
+PageArena& threadPageArena() {
+    thread_local PageArena arena;
+    return arena;
+}
@@ -0,0 +1,74 @@
+#ifndef PAGE_ARENA_HPP
+#define PAGE_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <gumbo.h>
+
+// The first block of a worker's arena, and the most it keeps between pages
+// (a page that needs more gets extra blocks that are freed at the reset)
+const size_t PAGE_ARENA_INITIAL_BYTES = 256 * 1024;
+const size_t PAGE_ARENA_MAX_RETAINED_BYTES = 8 * 1024 * 1024;
+
+// Monotonic arena for everything one page needs while it is processed: the
+// Gumbo tree, the parser's scratch containers and the PageData fields
+// (std::pmr). Nothing is freed piece by piece. reset() drops it all at
+// once and keeps the block for the next page. Used by one thread at a time.
+class PageArena {
+public:
+    explicit PageArena(size_t initialBytes = PAGE_ARENA_INITIAL_BYTES,
+                       size_t maxRetainedBytes = PAGE_ARENA_MAX_RETAINED_BYTES);
+
+    PageArena(const PageArena&) = delete;
+    PageArena& operator=(const PageArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &*arena; }
+
+    // Release everything allocated since the last reset. When the page
+    // outgrew the block, the block is enlarged (up to maxRetainedBytes) so
+    // the next page like it fits.
+    void reset();
+
+#ifdef HAVE_GUMBO_ALLOCATOR
+    // Options that make Gumbo allocate from the arena (its frees do nothing,
+    // and the output need not be destroyed)
+    const GumboOptions* gumboOptions() const { return &options; }
+#endif
+
+    size_t blockBytes() const { return blockSize; }
+    size_t resetCount() const { return resets; }
+    size_t extraBlockCount() const { return upstream.blocks; }  // heap blocks beyond the first, over all pages
+
+private:
+    // Hands the arena its extra blocks from the heap and counts them
+    class Upstream : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;   // since the last reset
+        size_t blocks = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* p, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+#ifdef HAVE_GUMBO_ALLOCATOR
+    static void* gumboAllocate(void* userdata, size_t size);
+    static void gumboDeallocate(void* userdata, void* ptr);
+    GumboOptions options;
+#endif
+
+    size_t blockSize;
+    size_t maxRetainedBytes;
+    std::unique_ptr<char[]> block;
+    Upstream upstream;
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+    size_t resets = 0;
+};
+
+// The calling thread's arena
+PageArena& threadPageArena();
+
+#endif // PAGE_ARENA_HPP
@@ -0,0 +1,224 @@
+#include "pagerank.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "url_utils.hpp"
+
+namespace {
+
+// Nodes per unit of parallel work. Partial sums are kept per chunk and
+// added in chunk order, so the thread count does not change the result.
+const size_t CHUNK_NODES = 16384;
+
+unsigned threadCount(unsigned requested) {
+    if (requested > 0) return requested;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run body(chunk, begin, end) for every chunk of [0, n), spread over threads
+template <typename Body>
+void parallelChunks(size_t n, unsigned threads, Body&& body) {
+    size_t chunks = (n + CHUNK_NODES - 1) / CHUNK_NODES;
+    std::atomic<size_t> next{0};
+    auto run = [&]() {
+        for (size_t chunk; (chunk = next.fetch_add(1)) < chunks;) {
+            body(chunk, chunk * CHUNK_NODES, std::min(n, (chunk + 1) * CHUNK_NODES));
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads && t < chunks; t++) workers.emplace_back(run);
+    run();
+    for (auto& worker : workers) worker.join();
+}
+
+} // namespace
+
+void buildLinkGraph(LinkGraph& graph, size_t nodes, const std::vector<LinkEdge>& edges, unsigned threads) {
+    threads = threadCount(threads);
+
+    // Counting sort by target
+    std::vector<uint64_t>& offsets = graph.offsets;
+    offsets.assign(nodes + 1, 0);
+    for (const auto& edge : edges) {
+        if (edge.source != edge.target) offsets[edge.target + 1]++;
+    }
+    for (size_t v = 0; v < nodes; v++) offsets[v + 1] += offsets[v];
+    std::vector<uint32_t>& sources = graph.sources;
+    sources.resize(offsets[nodes]);
+    {
+        std::vector<uint64_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (const auto& edge : edges) {
+            if (edge.source != edge.target) sources[cursor[edge.target]++] = edge.source;
+        }
+    }
+
+    // Sort each node's sources and drop repeats, then close the gaps
+    std::vector<uint64_t> length(nodes);
+    parallelChunks(nodes, threads, [&](size_t, size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            uint32_t* first = sources.data() + offsets[v];
+            uint32_t* last = sources.data() + offsets[v + 1];
+            std::sort(first, last);
+            length[v] = std::unique(first, last) - first;
+        }
+    });
+    uint64_t kept = 0;
+    for (size_t v = 0; v < nodes; v++) {
+        uint64_t from = offsets[v];
+        offsets[v] = kept;
+        if (kept != from) std::memmove(sources.data() + kept, sources.data() + from, length[v] * sizeof(uint32_t));
+        kept += length[v];
+    }
+    offsets[nodes] = kept;
+    sources.resize(kept);
+    sources.shrink_to_fit();
+
+    graph.outDegree.assign(nodes, 0);
+    for (uint32_t source : sources) graph.outDegree[source]++;
+}
+
+bool loadLinkGraph(sqlite3* db, LinkGraph& graph, size_t* linksRead, unsigned threads) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, url FROM pages ORDER BY id", -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to read pages: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    // Stored URL and its normalized form -> node
+    std::unordered_map<std::string, uint32_t> nodes;
+    graph.pageIds.clear();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char* url = sqlite3_column_text(stmt, 1);
+        if (!url) continue;
+        uint32_t node = static_cast<uint32_t>(graph.pageIds.size());
+        graph.pageIds.push_back(sqlite3_column_int64(stmt, 0));
+        std::string stored(reinterpret_cast<const char*>(url));
+        nodes.emplace(normalizeUrl(stored), node);
+        nodes.emplace(std::move(stored), node);
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db, "SELECT source_page_id, target_url FROM links", -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to read links: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    std::vector<LinkEdge> edges;
+    std::string target;
+    size_t rows = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        rows++;
+        const unsigned char* url = sqlite3_column_text(stmt, 1);
+        auto source = std::lower_bound(graph.pageIds.begin(), graph.pageIds.end(), sqlite3_column_int64(stmt, 0));
+        if (!url || source == graph.pageIds.end() || *source != sqlite3_column_int64(stmt, 0)) continue;
+
+        target.assign(reinterpret_cast<const char*>(url), sqlite3_column_bytes(stmt, 1));
+        auto found = nodes.find(target);
+        if (found == nodes.end()) {
+            found = nodes.find(normalizeUrl(target));
+            if (found == nodes.end()) continue;
+            uint32_t node = found->second;
+            found = nodes.emplace(target, node).first;  // later links spelled the same way hit directly
+        }
+        edges.push_back({static_cast<uint32_t>(source - graph.pageIds.begin()), found->second});
+    }
+    sqlite3_finalize(stmt);
+    if (linksRead) *linksRead = rows;
+
+    nodes = {};
+    buildLinkGraph(graph, graph.pageIds.size(), edges, threads);
+    return true;
+}
+
+PageRankResult computePageRank(const LinkGraph& graph, const PageRankOptions& options) {
+    PageRankResult result;
+    size_t n = graph.nodeCount();
+    if (n == 0) {
+        result.converged = true;
+        return result;
+    }
+    unsigned threads = threadCount(options.threads);
+    double d = options.damping;
+
+    std::vector<double>& rank = result.rank;
+    rank.assign(n, 1.0 / n);
+    std::vector<double> next(n);
+    std::vector<double> share(n);  // rank / out-degree of every node
+    size_t chunks = (n + CHUNK_NODES - 1) / CHUNK_NODES;
+    std::vector<double> chunkDangling(chunks);
+    std::vector<double> chunkChange(chunks);
+
+    while (result.iterations < options.maxIterations) {
+        parallelChunks(n, threads, [&](size_t chunk, size_t begin, size_t end) {
+            double dangling = 0;
+            for (size_t u = begin; u < end; u++) {
+                uint32_t degree = graph.outDegree[u];
+                share[u] = degree ? rank[u] / degree : 0;
+                if (!degree) dangling += rank[u];
+            }
+            chunkDangling[chunk] = dangling;
+        });
+        double dangling = 0;
+        for (double sum : chunkDangling) dangling += sum;
+        double base = (1 - d) / n + d * dangling / n;
+
+        parallelChunks(n, threads, [&](size_t chunk, size_t begin, size_t end) {
+            double change = 0;
+            const uint32_t* sources = graph.sources.data();
+            for (size_t v = begin; v < end; v++) {
+                double sum = 0;
+                for (uint64_t i = graph.offsets[v], e = graph.offsets[v + 1]; i < e; i++) sum += share[sources[i]];
+                next[v] = base + d * sum;
+                change += std::fabs(next[v] - rank[v]);
+            }
+            chunkChange[chunk] = change;
+        });
+        rank.swap(next);
+        result.iterations++;
+        result.change = 0;
+        for (double sum : chunkChange) result.change += sum;
+        if (result.change < options.tolerance) {
+            result.converged = true;
+            break;
+        }
+    }
+    return result;
+}
+
+bool savePageRank(sqlite3* db, const LinkGraph& graph, const std::vector<double>& rank) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_exec(db, "BEGIN", 0, 0, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "UPDATE pages SET page_rank = ? WHERE id = ?", -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "Failed to store page ranks: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        return false;
+    }
+    double scale = static_cast<double>(rank.size());
+    bool ok = true;
+    for (size_t v = 0; ok && v < rank.size(); v++) {
+        sqlite3_bind_double(stmt, 1, rank[v] * scale);
+        sqlite3_bind_int64(stmt, 2, graph.pageIds[v]);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (!ok || sqlite3_exec(db, "COMMIT", 0, 0, 0) != SQLITE_OK) {
+        std::cerr << "Failed to store page ranks: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        return false;
+    }
+    return true;
+}
+
+long updatePageRank(sqlite3* db, const PageRankOptions& options) {
+    LinkGraph graph;
+    if (!loadLinkGraph(db, graph, nullptr, options.threads)) return -1;
+    PageRankResult result = computePageRank(graph, options);
+    if (!savePageRank(db, graph, result.rank)) return -1;
+    return static_cast<long>(graph.nodeCount());
+}
@@ -0,0 +1,67 @@
+#ifndef PAGERANK_HPP
+#define PAGERANK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sqlite3.h>
+
+// One link between two nodes of a LinkGraph
+struct LinkEdge {
+    uint32_t source;
+    uint32_t target;
+};
+
+// Link graph in compressed sparse row form, stored by incoming link: the
+// nodes linking to node v are sources[offsets[v]] .. sources[offsets[v + 1] - 1],
+// sorted and without repeats. Nodes are numbered 0..n-1 and pageIds maps
+// them back to pages.id (ascending).
+struct LinkGraph {
+    std::vector<sqlite3_int64> pageIds;
+    std::vector<uint64_t> offsets;    // nodeCount() + 1 entries
+    std::vector<uint32_t> sources;
+    std::vector<uint32_t> outDegree;  // distinct nodes each node links to
+
+    size_t nodeCount() const { return outDegree.size(); }
+    size_t edgeCount() const { return sources.size(); }
+};
+
+// Function to build the graph of `nodes` nodes from an edge list in any
+// order (self-links and repeated links are dropped)
+void buildLinkGraph(LinkGraph& graph, size_t nodes, const std::vector<LinkEdge>& edges, unsigned threads = 0);
+
+// Function to load the pages and links tables as a graph. A link's
+// target_url is matched against the stored page URLs, as is or normalized;
+// links to pages that were not crawled are left out. linksRead counts every
+// row of links.
+bool loadLinkGraph(sqlite3* db, LinkGraph& graph, size_t* linksRead = nullptr, unsigned threads = 0);
+
+struct PageRankOptions {
+    double damping = 0.85;
+    double tolerance = 1e-7;  // stop when the ranks change less than this in total (L1)
+    int maxIterations = 100;
+    unsigned threads = 0;     // 0: one per hardware thread
+};
+
+struct PageRankResult {
+    std::vector<double> rank;  // per node, summing to 1
+    int iterations = 0;
+    double change = 0;         // L1 change in the last iteration
+    bool converged = false;
+};
+
+// Function to run PageRank by power iteration. Each iteration every node
+// pulls the shares of the nodes linking to it; the rank of nodes without
+// outgoing links is spread over all nodes. Results do not depend on the
+// thread count.
+PageRankResult computePageRank(const LinkGraph& graph, const PageRankOptions& options = PageRankOptions());
+
+// Function to store ranks in pages.page_rank, scaled so that an average
+// page has 1.0, in one transaction
+bool savePageRank(sqlite3* db, const LinkGraph& graph, const std::vector<double>& rank);
+
+// Function to load the graph, rank it and save the result. Returns the
+// number of pages ranked, or -1 on error.
+long updatePageRank(sqlite3* db, const PageRankOptions& options = PageRankOptions());
+
+#endif // PAGERANK_HPP
@@ -0,0 +1,251 @@
+#include "robots.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+#include "url_utils.hpp"
+
+void RobotsMatcher::addRule(const std::string& pattern, bool allow) {
+    if (pattern.empty()) return;  // "Disallow:" with no path allows everything
+
+    size_t prefixEnd = pattern.find('*');
+    if (prefixEnd == std::string::npos) {
+        prefixEnd = pattern.back() == '$' ? pattern.size() - 1 : pattern.size();
+    }
+
+    int node = 0;
+    for (size_t i = 0; i < prefixEnd; i++) {
+        int next = child(node, pattern[i]);
+        if (next < 0) {
+            next = static_cast<int>(nodes.size());
+            nodes.emplace_back();
+            auto& children = nodes[node].children;
+            auto pos = std::lower_bound(children.begin(), children.end(), std::make_pair(pattern[i], 0));
+            children.insert(pos, {pattern[i], next});
+        }
+        node = next;
+    }
+
+    nodes[node].rules.push_back(static_cast<int>(rules.size()));
+    rules.push_back({pattern.substr(prefixEnd), pattern.size(), allow});
+    (allow ? allows : disallows)++;
+}
+
+int RobotsMatcher::child(int node, char c) const {
+    for (const auto& edge : nodes[node].children) {
+        if (edge.first == c) return edge.second;
+        if (edge.first > c) break;
+    }
+    return -1;
+}
+
+// Match the rest of a pattern ("*a*b", "*.pdf$", "$") against the rest of
+// the path. Each literal segment takes its leftmost occurrence, which is
+// enough when '*' is the only operator.
+bool RobotsMatcher::matchTail(const std::string& tail, const char* text, size_t length) {
+    if (tail.empty()) return true;
+    bool anchored = tail.back() == '$';
+    size_t end = anchored ? tail.size() - 1 : tail.size();
+    if (end == 0) return length == 0;  // '$' right after the literal prefix
+
+    // Here the tail starts with '*'
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < end) {
+        if (tail[i] == '*') {
+            i++;
+            continue;
+        }
+        size_t next = std::min(tail.find('*', i), end);
+        const char* segment = tail.data() + i;
+        size_t segmentLength = next - i;
+        if (anchored && next == end) {
+            // The last segment before '$' must end the path
+            return length - pos >= segmentLength &&
+                   std::memcmp(text + length - segmentLength, segment, segmentLength) == 0;
+        }
+        const char* found = static_cast<const char*>(memmem(text + pos, length - pos, segment, segmentLength));
+        if (!found) return false;
+        pos = (found - text) + segmentLength;
+        i = next;
+    }
+    return true;  // the pattern ends in '*'
+}
+
+bool RobotsMatcher::isAllowed(const char* path, size_t length) const {
+    const Rule* best = nullptr;
+    auto consider = [&](int node, size_t consumed) {
+        for (int index : nodes[node].rules) {
+            const Rule& rule = rules[index];
+            if (best && (rule.length < best->length || (rule.length == best->length && !rule.allow))) continue;
+            if (matchTail(rule.tail, path + consumed, length - consumed)) best = &rule;
+        }
+    };
+
+    int node = 0;
+    consider(node, 0);
+    for (size_t i = 0; i < length; i++) {
+        node = child(node, path[i]);
+        if (node < 0) break;
+        consider(node, i + 1);
+    }
+    return !best || best->allow;
+}
+
+namespace {
+
+std::string lowercase(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+std::string trim(const std::string& s) {
+    size_t start = s.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    return s.substr(start, s.find_last_not_of(" \t\r\n") - start + 1);
+}
+
+const size_t MAX_SITEMAPS = 1000;  // Sitemap lines kept from one robots.txt
+
+struct Group {
+    std::vector<std::pair<std::string, bool>> rules;  // (pattern, allow)
+    int crawlDelay = 0;
+    bool seen = false;
+};
+
+} // namespace
+
+RobotsRules parseRobotsTxt(const std::string& body, const std::string& productToken) {
+    std::string token = lowercase(productToken);
+    Group wildcard, specific;
+    std::vector<Group*> current;  // groups the current block of rules applies to
+    std::vector<std::string> sitemaps;
+    bool inUserAgents = false;    // consecutive User-agent lines form one group
+
+    std::istringstream stream(body);
+    std::string line;
+    while (std::getline(stream, line)) {
+        // Strip comments and whitespace
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string key = lowercase(trim(line.substr(0, colon)));
+        std::string value = trim(line.substr(colon + 1));
+
+        // Sitemap lines stand outside the groups (and do not end one)
+        if (key == "sitemap") {
+            if (!value.empty() && sitemaps.size() < MAX_SITEMAPS) sitemaps.push_back(value);
+            continue;
+        }
+
+        if (key == "user-agent") {
+            if (!inUserAgents) current.clear();
+            inUserAgents = true;
+            std::string agent = lowercase(value);
+            Group* group = nullptr;
+            if (agent == "*") {
+                group = &wildcard;
+            } else if (!token.empty() && agent.compare(0, token.size(), token) == 0) {
+                group = &specific;
+            }
+            if (group) {
+                group->seen = true;
+                current.push_back(group);
+            }
+            continue;
+        }
+        inUserAgents = false;
+
+        for (Group* group : current) {
+            if (key == "allow" || key == "disallow") {
+                group->rules.push_back({value, key == "allow"});
+            } else if (key == "crawl-delay") {
+                try {
+                    group->crawlDelay = std::stoi(value);
+                } catch (...) {}
+            }
+        }
+    }
+
+    // A group for our own token replaces the "*" group entirely
+    const Group& group = specific.seen ? specific : wildcard;
+    RobotsRules rules;
+    rules.crawlDelay = group.crawlDelay;
+    for (const auto& rule : group.rules) {
+        rules.matcher.addRule(rule.first, rule.second);
+    }
+    rules.allowAll = rules.matcher.disallowCount() == 0;
+    rules.sitemaps = std::move(sitemaps);
+    return rules;
+}
+
+bool isAllowedByRobots(const std::string& url, const RobotsRules& rules) {
+    if (rules.allowAll) return true;
+
+    // Match path and query as they appear in the URL
+    UrlParts parts = parseUrl(url);
+    if (!parts.hasScheme || !parts.hasAuthority) return false;
+    if (parts.path.empty()) return rules.matcher.isAllowed("/", 1);
+
+    const char* end = parts.hasQuery ? parts.query.data() + parts.query.size() : parts.path.data() + parts.path.size();
+    return rules.matcher.isAllowed(parts.path.data(), end - parts.path.data());
+}
+
+RobotsCache::RobotsCache(Fetcher fetcher, std::chrono::seconds ttl, std::chrono::seconds failureTtl,
+                         ErrorHandler onError)
+    : fetcher(std::move(fetcher)), ttl(ttl), failureTtl(failureTtl), onError(std::move(onError)) {
+    RobotsRules rules;
+    rules.allowAll = true;
+    allowAll = std::make_shared<const RobotsRules>(std::move(rules));
+}
+
+std::shared_ptr<const RobotsRules> RobotsCache::get(const std::string& origin) {
+    std::promise<std::shared_ptr<const RobotsRules>> promise;
+    std::shared_future<std::shared_ptr<const RobotsRules>> rules;
+    bool owner = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(origin);
+        if (it != entries.end() && std::chrono::steady_clock::now() < it->second.expires) {
+            rules = it->second.rules;
+        } else {
+            // Claim the fetch; workers asking meanwhile wait on the same future
+            rules = promise.get_future().share();
+            entries[origin] = {rules, std::chrono::steady_clock::time_point::max()};
+            owner = true;
+        }
+    }
+    if (!owner) {
+        hits++;
+        return rules.get();
+    }
+
+    fetches++;
+    std::shared_ptr<const RobotsRules> fetched;
+    std::string error;
+    try {
+        fetched = std::make_shared<const RobotsRules>(fetcher(origin));
+    } catch (const std::exception& e) {
+        error = e.what();
+    } catch (...) {
+        error = "unknown error";
+    }
+    bool failed = !fetched;
+    if (failed) {
+        // Waiting workers must not get a broken promise: they crawl as if
+        // there were no robots.txt until the shorter failure TTL runs out.
+        // Every failure shares one rule set, so callers see no new rules.
+        if (onError) onError(origin, error);
+        fetched = allowAll;
+    }
+    promise.set_value(fetched);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(origin);
+        if (it != entries.end()) it->second.expires = std::chrono::steady_clock::now() + (failed ? failureTtl : ttl);
+    }
+    return fetched;
+}
@@ -0,0 +1,103 @@
+#ifndef ROBOTS_HPP
+#define ROBOTS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Allow/Disallow rules of one robots.txt group compiled into a byte trie
+// over the literal prefix of each pattern (the part before the first '*' or
+// a trailing '$'). Matching walks the trie once along the path; only rules
+// with wildcards check the rest of their pattern. Semantics follow RFC 9309:
+// '*' matches any run of characters, a trailing '$' anchors the end, and the
+// longest matching pattern wins, Allow winning ties.
+class RobotsMatcher {
+public:
+    void addRule(const std::string& pattern, bool allow);
+
+    // path is the URL path plus query, starting with '/'
+    bool isAllowed(const char* path, size_t length) const;
+    bool isAllowed(const std::string& path) const { return isAllowed(path.data(), path.size()); }
+
+    size_t allowCount() const { return allows; }
+    size_t disallowCount() const { return disallows; }
+
+private:
+    struct Rule {
+        std::string tail;     // pattern after the literal prefix ("" for plain prefixes)
+        size_t length;        // full pattern length, for precedence
+        bool allow;
+    };
+
+    struct Node {
+        std::vector<std::pair<char, int>> children;  // sorted by byte
+        std::vector<int> rules;                      // rules whose prefix ends here
+    };
+
+    int child(int node, char c) const;
+    static bool matchTail(const std::string& tail, const char* text, size_t length);
+
+    std::vector<Node> nodes = std::vector<Node>(1);  // nodes[0] is the root
+    std::vector<Rule> rules;
+    size_t allows = 0;
+    size_t disallows = 0;
+};
+
+struct RobotsRules {
+    RobotsMatcher matcher;
+    int crawlDelay = 0;
+    bool allowAll = false;
+    std::vector<std::string> sitemaps;  // Sitemap: URLs (they apply to every user agent)
+};
+
+// Function to parse robots.txt. Uses the group naming our product token
+// (e.g. "CustomSearchBot") if there is one, otherwise the "*" group.
+// Sitemap: lines are collected wherever they appear.
+RobotsRules parseRobotsTxt(const std::string& body, const std::string& productToken);
+
+// Function to check a URL against the rules (path and query are matched)
+bool isAllowedByRobots(const std::string& url, const RobotsRules& rules);
+
+// Compiled rules per origin, shared by all workers. An entry is fetched
+// once, even when several workers ask for it at the same time, and
+// fetched again after the TTL. A fetcher that throws is reported to
+// onError; the origin then gets one shared allow-all rule set until
+// failureTtl has passed.
+class RobotsCache {
+public:
+    using Fetcher = std::function<RobotsRules(const std::string& origin)>;
+    using ErrorHandler = std::function<void(const std::string& origin, const std::string& error)>;
+
+    RobotsCache(Fetcher fetcher, std::chrono::seconds ttl, std::chrono::seconds failureTtl,
+                ErrorHandler onError = nullptr);
+
+    std::shared_ptr<const RobotsRules> get(const std::string& origin);
+
+    size_t hitCount() const { return hits.load(); }
+    size_t fetchCount() const { return fetches.load(); }
+
+private:
+    struct Entry {
+        std::shared_future<std::shared_ptr<const RobotsRules>> rules;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    Fetcher fetcher;
+    std::chrono::seconds ttl;
+    std::chrono::seconds failureTtl;
+    ErrorHandler onError;
+    std::shared_ptr<const RobotsRules> allowAll;  // handed out after a failed fetch
+    std::mutex mutex;
+    std::map<std::string, Entry> entries;
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> fetches{0};
+};
+
+#endif // ROBOTS_HPP
@@ -0,0 +1,213 @@
+#include "shard.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sqlite3.h>
+
+#include "database.hpp"
+#include "url_seen.hpp"
+#include "url_utils.hpp"
+
+namespace {
+
+// Rows copied per input. ?1 is the page id offset, ?2 the dictionary id
+// offset. Child rows are copied only for pages that were inserted (a page
+// skipped as already merged has no row at its shifted id).
+const char* const COPY_PAGES =
+    "INSERT OR IGNORE INTO main.pages (id, url, title, description, content, favicon, crawled_at, etag, "
+    "last_modified, content_hash, simhash, page_rank) "
+    "SELECT id + ?1, url, title, description, content, favicon, crawled_at, etag, last_modified, content_hash, "
+    "simhash, page_rank FROM shard.pages ORDER BY id";
+
+const char* const COPY_ROWS[] = {
+    "INSERT INTO main.images (page_id, image_url) "
+    "SELECT i.page_id + ?1, i.image_url FROM shard.images i JOIN main.pages p ON p.id = i.page_id + ?1",
+    "INSERT INTO main.tags (page_id, tag) "
+    "SELECT t.page_id + ?1, t.tag FROM shard.tags t JOIN main.pages p ON p.id = t.page_id + ?1",
+    "INSERT INTO main.links (source_page_id, target_url) "
+    "SELECT l.source_page_id + ?1, l.target_url FROM shard.links l JOIN main.pages p ON p.id = l.source_page_id + ?1",
+    "INSERT INTO main.html_dicts (id, dict, created_at) SELECT id + ?2, dict, created_at FROM shard.html_dicts",
+    // dict_id 0 means stored without a dictionary
+    "INSERT INTO main.page_html (page_id, dict_id, raw_size, data) "
+    "SELECT h.page_id + ?1, CASE WHEN h.dict_id = 0 THEN 0 ELSE h.dict_id + ?2 END, h.raw_size, h.data "
+    "FROM shard.page_html h JOIN main.pages p ON p.id = h.page_id + ?1",
+    "INSERT OR IGNORE INTO main.duplicates (url, original_url, distance, found_at) "
+    "SELECT url, original_url, distance, found_at FROM shard.duplicates",
+};
+
+bool exec(sqlite3* db, const char* sql) {
+    char* errMsg = 0;
+    if (sqlite3_exec(db, sql, 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Run one statement with up to two integer parameters; adds the rows it changed
+bool run(sqlite3* db, const char* sql, sqlite3_int64 first, sqlite3_int64 second, size_t& changes) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    int parameters = sqlite3_bind_parameter_count(stmt);
+    if (parameters >= 1) sqlite3_bind_int64(stmt, 1, first);
+    if (parameters >= 2) sqlite3_bind_int64(stmt, 2, second);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (ok) changes += static_cast<size_t>(sqlite3_changes(db));
+    else std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+sqlite3_int64 queryInt(sqlite3* db, const char* sql) {
+    sqlite3_stmt* stmt;
+    sqlite3_int64 value = 0;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+bool bindAndRun(sqlite3* db, const char* sql, const std::string& text, sqlite3_int64 number = 0) {
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) {
+        std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_bind_parameter_count(stmt) >= 2) sqlite3_bind_int64(stmt, 2, number);
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!ok) std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+bool fileExists(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (file) std::fclose(file);
+    return file != nullptr;
+}
+
+void removeDatabase(const std::string& path) {
+    for (const char* suffix : {"", "-wal", "-shm", "-journal"}) std::remove((path + suffix).c_str());
+}
+
+// Copy one input database into the merge (one transaction)
+bool mergeInput(sqlite3* db, const std::string& input, MergeStats& stats) {
+    if (!fileExists(input)) {
+        std::cerr << "No database at " << input << std::endl;
+        return false;
+    }
+    if (!bindAndRun(db, "ATTACH DATABASE ? AS shard", input)) return false;
+
+    // Ids of this input go after everything merged so far
+    sqlite3_int64 pageOffset = queryInt(db, "SELECT COALESCE(MAX(id), 0) FROM main.pages");
+    sqlite3_int64 dictOffset = queryInt(db, "SELECT COALESCE(MAX(id), 0) FROM main.html_dicts");
+    size_t shardPages = static_cast<size_t>(queryInt(db, "SELECT count(*) FROM shard.pages"));
+
+    size_t pages = 0;
+    size_t rows = 0;
+    bool ok = exec(db, "BEGIN") && run(db, COPY_PAGES, pageOffset, dictOffset, pages);
+    for (const char* sql : COPY_ROWS) ok = ok && run(db, sql, pageOffset, dictOffset, rows);
+    ok = ok && bindAndRun(db, "INSERT INTO shard_merge (source, pages) VALUES (?, ?)", input,
+                          static_cast<sqlite3_int64>(pages));
+    ok = ok && exec(db, "COMMIT");
+    if (!ok) sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+    sqlite3_exec(db, "DETACH DATABASE shard", 0, 0, 0);
+
+    stats.inputs++;
+    stats.pages += pages;
+    stats.pagesSkipped += shardPages > pages ? shardPages - pages : 0;
+    stats.rows += rows;
+    return ok;
+}
+
+} // namespace
+
+bool ShardSpec::owns(const std::string& url) const {
+    return !sharded() || shardOf(url, count) == index;
+}
+
+bool parseShardSpec(const char* text, ShardSpec& spec) {
+    int index = 0, count = 0;
+    char end = 0;
+    if (!text || std::sscanf(text, "%d/%d%c", &index, &count, &end) != 2) return false;
+    if (count < 1 || index < 0 || index >= count) return false;
+    spec.index = index;
+    spec.count = count;
+    return true;
+}
+
+int shardOf(const std::string& url, int count) {
+    if (count <= 1) return 0;
+    return static_cast<int>(UrlSeenFilter::fingerprint(extractBaseDomain(url)) % static_cast<uint64_t>(count));
+}
+
+std::string shardSuffix(const ShardSpec& spec) {
+    return ".shard-" + std::to_string(spec.index) + "-of-" + std::to_string(spec.count);
+}
+
+std::string shardDatabasePath(const std::string& dbPath, const ShardSpec& spec) {
+    if (!spec.sharded()) return dbPath;
+    size_t slash = dbPath.rfind('/');
+    size_t dot = dbPath.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1) {
+        return dbPath + shardSuffix(spec);
+    }
+    return dbPath.substr(0, dot) + shardSuffix(spec) + dbPath.substr(dot);
+}
+
+bool mergeShards(const std::vector<std::string>& inputs, const std::string& outPath, MergeStats& stats) {
+    std::string building = outPath + ".merging";
+    removeDatabase(building);
+
+    // A bulk load: large pages, no FTS triggers and no secondary indexes
+    // while rows are copied, no journal (a failed merge is thrown away)
+    sqlite3* db = initDatabase(building.c_str(), true);
+    if (!db) return false;
+    bool ok = beginBulkLoad(db) &&
+              exec(db, "PRAGMA journal_mode = OFF;"
+                       "PRAGMA synchronous = OFF;"
+                       "PRAGMA cache_size = -262144;"
+                       "DROP INDEX IF EXISTS idx_pages_url;"
+                       "DROP INDEX IF EXISTS idx_images_page_id;"
+                       "DROP INDEX IF EXISTS idx_links_source_page_id;"
+                       "CREATE TABLE IF NOT EXISTS shard_merge ("
+                       "source TEXT NOT NULL,"
+                       "pages INTEGER NOT NULL,"
+                       "merged_at DATETIME DEFAULT CURRENT_TIMESTAMP"
+                       ");");
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; ok && i < inputs.size(); i++) ok = mergeInput(db, inputs[i], stats);
+    auto copied = std::chrono::steady_clock::now();
+    stats.copySeconds = std::chrono::duration<double>(copied - start).count();
+
+    // pages_fts in one rebuild, then the triggers and indexes (createSchema)
+    ok = ok && finishBulkLoad(db);
+    stats.ftsSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - copied).count();
+
+    // The crawler and backend open it in WAL mode; switching needs no open transaction
+    ok = ok && exec(db, "PRAGMA journal_mode = WAL;");
+    sqlite3_close(db);
+    if (!ok) {
+        removeDatabase(building);
+        return false;
+    }
+
+    // A -wal file of the old database must not be applied to the new one
+    std::remove((outPath + "-wal").c_str());
+    std::remove((outPath + "-shm").c_str());
+    if (std::rename(building.c_str(), outPath.c_str()) != 0) {
+        std::perror(("Cannot rename " + building + " to " + outPath).c_str());
+        removeDatabase(building);
+        return false;
+    }
+    return true;
+}
+
@@ -0,0 +1,52 @@
+#ifndef SHARD_HPP
+#define SHARD_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Host-sharded crawling: N crawler processes on one machine split the
+// starting websites by a hash of their base domain. Each one keeps its own
+// frontier, seen-URL file and shard database, so none of them waits for
+// another's SQLite write lock. Sites only follow links within their base
+// domain, so two shards never crawl the same URL.
+struct ShardSpec {
+    int index = 0;
+    int count = 1;
+
+    bool sharded() const { return count > 1; }
+
+    // Whether this shard crawls the website a URL belongs to
+    bool owns(const std::string& url) const;
+};
+
+// Function to read "i/N" (0 <= i < N); returns false if text is not one
+bool parseShardSpec(const char* text, ShardSpec& spec);
+
+// Function to pick the shard of a URL's base domain (stable across runs and machines)
+int shardOf(const std::string& url, int count);
+
+// ".shard-2-of-4"
+std::string shardSuffix(const ShardSpec& spec);
+
+// Function to name a shard's database: crawler_data.db -> crawler_data.shard-2-of-4.db
+std::string shardDatabasePath(const std::string& dbPath, const ShardSpec& spec);
+
+struct MergeStats {
+    size_t inputs = 0;
+    size_t pages = 0;
+    size_t pagesSkipped = 0;  // URL already merged from an earlier input
+    size_t rows = 0;          // images, tags, links, HTML and duplicates
+    double copySeconds = 0;
+    double ftsSeconds = 0;
+};
+
+// Function to merge crawler databases (the shards, then optionally an earlier
+// crawler_data.db) into a fresh database at outPath in the layout the
+// backend reads, pages_fts included. Page and dictionary ids are renumbered;
+// a URL in several inputs keeps its row from the first. The result is built
+// next to outPath and renamed over it only when complete, so readers never
+// see a partial merge. Returns false on error (outPath is left as it was).
+bool mergeShards(const std::vector<std::string>& inputs, const std::string& outPath, MergeStats& stats);
+
+#endif // SHARD_HPP
@@ -0,0 +1,257 @@
+#include "simhash.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline bool isWordByte(unsigned char c) {
+    // Bytes of multibyte UTF-8 characters count as letters
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+// Per-bit counts of the set bits of many 64-bit hashes. Counts build up in
+// 8-bit lanes (bit b of a hash is lane b) and are moved to 32-bit totals
+// before a lane can overflow.
+class BitCounter {
+public:
+    BitCounter() { clearLanes(); }
+
+    void add(uint64_t h) {
+#if defined(__SSE2__)
+        // Spread each byte of the hash over 8 lanes and keep the lane's own bit
+        const __m128i bitMask = _mm_set1_epi64x(static_cast<long long>(0x8040201008040201ULL));
+        for (int i = 0; i < 4; i++) {
+            uint64_t lo = (h >> (16 * i)) & 0xff;
+            uint64_t hi = (h >> (16 * i + 8)) & 0xff;
+            __m128i bytes = _mm_set_epi64x(static_cast<long long>(hi * 0x0101010101010101ULL),
+                                           static_cast<long long>(lo * 0x0101010101010101ULL));
+            __m128i set = _mm_cmpeq_epi8(_mm_and_si128(bytes, bitMask), bitMask);
+            lanes[i] = _mm_sub_epi8(lanes[i], set);  // set lanes are -1
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint8x16_t bitMask = vreinterpretq_u8_u64(vdupq_n_u64(0x8040201008040201ULL));
+        for (int i = 0; i < 4; i++) {
+            uint8x16_t bytes = vcombine_u8(vdup_n_u8(static_cast<uint8_t>(h >> (16 * i))),
+                                           vdup_n_u8(static_cast<uint8_t>(h >> (16 * i + 8))));
+            lanes[i] = vsubq_u8(lanes[i], vtstq_u8(bytes, bitMask));
+        }
+#else
+        for (int b = 0; b < 64; b++) lanes[b] += (h >> b) & 1;
+#endif
+        count++;
+        if (++sinceSpill == 255) spill();
+    }
+
+    // Bits set in more than half of the hashes
+    uint64_t majority() {
+        spill();
+        uint64_t result = 0;
+        for (int b = 0; b < 64; b++) {
+            if (totals[b] * 2 > count) result |= 1ULL << b;
+        }
+        return result;
+    }
+
+    size_t size() const { return count; }
+
+private:
+    void spill() {
+        uint8_t counts[64];
+#if defined(__SSE2__)
+        for (int i = 0; i < 4; i++) _mm_storeu_si128(reinterpret_cast<__m128i*>(counts + 16 * i), lanes[i]);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (int i = 0; i < 4; i++) vst1q_u8(counts + 16 * i, lanes[i]);
+#else
+        for (int b = 0; b < 64; b++) counts[b] = lanes[b];
+#endif
+        for (int b = 0; b < 64; b++) totals[b] += counts[b];
+        clearLanes();
+    }
+
+    void clearLanes() {
+#if defined(__SSE2__)
+        for (auto& lane : lanes) lane = _mm_setzero_si128();
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (auto& lane : lanes) lane = vdupq_n_u8(0);
+#else
+        for (auto& lane : lanes) lane = 0;
+#endif
+        sinceSpill = 0;
+    }
+
+#if defined(__SSE2__)
+    __m128i lanes[4];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t lanes[4];
+#else
+    uint8_t lanes[64];
+#endif
+    uint32_t totals[64] = {};
+    size_t count = 0;
+    size_t sinceSpill = 0;
+};
+
+// Call found(i, distance) for every fingerprint within maxDistance bits of
+// target. The distances of two fingerprints are computed per vector.
+template <typename Found>
+void scanWithin(const uint64_t* fingerprints, size_t n, uint64_t target, int maxDistance, Found&& found) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // SWAR popcount in each 64-bit lane; psadbw sums the byte counts
+    const __m128i m1 = _mm_set1_epi8(0x55);
+    const __m128i m2 = _mm_set1_epi8(0x33);
+    const __m128i m4 = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i t = _mm_set1_epi64x(static_cast<long long>(target));
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(fingerprints + i)), t);
+        x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi64(x, 1), m1));
+        x = _mm_add_epi8(_mm_and_si128(x, m2), _mm_and_si128(_mm_srli_epi64(x, 2), m2));
+        x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi64(x, 4)), m4);
+        x = _mm_sad_epu8(x, zero);
+        int d0 = _mm_cvtsi128_si32(x);
+        int d1 = _mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+        if (d0 <= maxDistance) found(i, d0);
+        if (d1 <= maxDistance) found(i + 1, d1);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint64x2_t t = vdupq_n_u64(target);
+    for (; i + 2 <= n; i += 2) {
+        uint8x16_t x = vreinterpretq_u8_u64(veorq_u64(vld1q_u64(fingerprints + i), t));
+        uint64x2_t bits = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vcntq_u8(x))));
+        int d0 = static_cast<int>(vgetq_lane_u64(bits, 0));
+        int d1 = static_cast<int>(vgetq_lane_u64(bits, 1));
+        if (d0 <= maxDistance) found(i, d0);
+        if (d1 <= maxDistance) found(i + 1, d1);
+    }
+#endif
+    for (; i < n; i++) {
+        int d = hammingDistance(fingerprints[i], target);
+        if (d <= maxDistance) found(i, d);
+    }
+}
+
+} // namespace
+
+uint64_t simhash(std::string_view text, size_t minShingles) {
+    BitCounter counter;
+    uint64_t words[3] = {0, 0, 0};
+    size_t wordCount = 0;
+
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(text.data());
+    size_t n = text.size();
+    size_t i = 0;
+    while (i < n) {
+        while (i < n && !isWordByte(s[i])) i++;
+        if (i == n) break;
+
+        // FNV-1a over the lowercased word
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (; i < n && isWordByte(s[i]); i++) {
+            unsigned char c = s[i];
+            if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+            h ^= c;
+            h *= 0x100000001b3ULL;
+        }
+
+        words[0] = words[1];
+        words[1] = words[2];
+        words[2] = h;
+        if (++wordCount >= 3) {
+            // Rotations keep the shingle order-sensitive
+            counter.add(mix64(words[0] ^ rotl(words[1], 21) ^ rotl(words[2], 42)));
+        }
+    }
+
+    if (counter.size() < minShingles || counter.size() == 0) return 0;
+    uint64_t fingerprint = counter.majority();
+    return fingerprint ? fingerprint : 1;  // 0 means no fingerprint
+}
+
+int hammingDistance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+NearDuplicateIndex::NearDuplicateIndex(int maxDistance)
+    : maxDistance(std::min(maxDistance, MAX_DISTANCE)), buckets(BANDS * BUCKETS) {
+    static_assert(MAX_DISTANCE == BANDS - 1, "two fingerprints must share a band within MAX_DISTANCE bits");
+    if (maxDistance > MAX_DISTANCE) {
+        std::cerr << "Near-duplicate distance " << maxDistance << " is over " << MAX_DISTANCE << ", using "
+                  << MAX_DISTANCE << std::endl;
+    }
+}
+
+bool NearDuplicateIndex::find(uint64_t fingerprint, const std::string& url, std::string& original, int& distance) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return findLocked(fingerprint, url, original, distance);
+}
+
+bool NearDuplicateIndex::checkAndInsert(uint64_t fingerprint, const std::string& url, std::string& original,
+                                        int& distance) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (findLocked(fingerprint, url, original, distance)) return true;
+    add(fingerprint, url);
+    return false;
+}
+
+bool NearDuplicateIndex::findLocked(uint64_t fingerprint, const std::string& url, std::string& original,
+                                    int& distance) {
+    int best = maxDistance + 1;
+    uint32_t bestPage = 0;
+    for (int band = 0; band < BANDS; band++) {
+        const Bucket& bucket = buckets[band * BUCKETS + ((fingerprint >> (16 * band)) & (BUCKETS - 1))];
+        scanWithin(bucket.fingerprints.data(), bucket.fingerprints.size(), fingerprint, maxDistance,
+                   [&](size_t i, int d) {
+                       if (d < best && urls[bucket.pages[i]] != url) {
+                           best = d;
+                           bestPage = bucket.pages[i];
+                       }
+                   });
+        if (best == 0) break;
+    }
+
+    if (best > maxDistance) return false;
+    original = urls[bestPage];
+    distance = best;
+    return true;
+}
+
+void NearDuplicateIndex::insert(uint64_t fingerprint, const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex);
+    add(fingerprint, url);
+}
+
+size_t NearDuplicateIndex::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return urls.size();
+}
+
+void NearDuplicateIndex::add(uint64_t fingerprint, const std::string& url) {
+    uint32_t page = static_cast<uint32_t>(urls.size());
+    urls.push_back(url);
+    for (int band = 0; band < BANDS; band++) {
+        Bucket& bucket = buckets[band * BUCKETS + ((fingerprint >> (16 * band)) & (BUCKETS - 1))];
+        bucket.fingerprints.push_back(fingerprint);
+        bucket.pages.push_back(page);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SIMHASH_HPP
+#define SIMHASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Texts with fewer word shingles than this get no fingerprint (too short to
+// call two pages near-duplicates)
+const size_t SIMHASH_MIN_SHINGLES = 16;
+
+// Function to compute the 64-bit SimHash of a text over its word 3-shingles
+// (words are runs of letters and digits, compared case-insensitively).
+// Returns 0, meaning no fingerprint, for texts shorter than minShingles.
+uint64_t simhash(std::string_view text, size_t minShingles = SIMHASH_MIN_SHINGLES);
+
+int hammingDistance(uint64_t a, uint64_t b);
+
+// Fingerprints of stored pages, split into four 16-bit bands. Two
+// fingerprints within 3 bits of each other agree on at least one band, so
+// only the pages that share a band value are compared; a larger
+// maxDistance is clamped to 3. Shared by all workers; calls are serialized.
+class NearDuplicateIndex {
+public:
+    // Largest distance the band lookup is guaranteed to find (BANDS - 1)
+    static constexpr int MAX_DISTANCE = 3;
+
+    explicit NearDuplicateIndex(int maxDistance = MAX_DISTANCE);
+
+    NearDuplicateIndex(const NearDuplicateIndex&) = delete;
+    NearDuplicateIndex& operator=(const NearDuplicateIndex&) = delete;
+
+    // Look for a page within maxDistance bits of fingerprint (other than url
+    // itself). Returns true with the closest match in original and distance.
+    bool find(uint64_t fingerprint, const std::string& url, std::string& original, int& distance);
+
+    // find(), and add the page if it is not a near-duplicate
+    bool checkAndInsert(uint64_t fingerprint, const std::string& url, std::string& original, int& distance);
+
+    // Add a stored page without checking it
+    void insert(uint64_t fingerprint, const std::string& url);
+
+    size_t size();
+
+private:
+    static const int BANDS = 4;
+    static const size_t BUCKETS = 1 << 16;
+
+    // Fingerprints and their page numbers side by side, so a bucket scan
+    // compares fingerprints without touching the pages
+    struct Bucket {
+        std::vector<uint64_t> fingerprints;
+        std::vector<uint32_t> pages;
+    };
+
+    bool findLocked(uint64_t fingerprint, const std::string& url, std::string& original, int& distance);
+    void add(uint64_t fingerprint, const std::string& url);
+
+    int maxDistance;
+    std::mutex mutex;
+    std::vector<Bucket> buckets;  // BANDS * BUCKETS
+    std::vector<std::string> urls;
+};
+
+#endif // SIMHASH_HPP
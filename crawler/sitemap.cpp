@@ -0,0 +1,371 @@
+#include "sitemap.hpp"
+
+#include <cstring>
+
+namespace {
+
+const size_t MAX_NAME = 64;         // longer tag names are cut (they never match)
+const size_t MAX_MARKUP = 7;        // "[CDATA["
+const size_t MAX_LOC = 4096;        // the protocol allows 2,048 characters
+const size_t MAX_LASTMOD = 64;
+const size_t INFLATE_CHUNK = 16384;
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// Decode the predefined entities and numeric references below 128; others
+// are kept as written
+std::string decodeEntities(std::string_view s) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        size_t semicolon = s[i] == '&' ? s.find(';', i) : std::string_view::npos;
+        if (semicolon == std::string_view::npos || semicolon - i > 8) {
+            out += s[i];
+            continue;
+        }
+        std::string_view entity = s.substr(i + 1, semicolon - i - 1);
+        int c = -1;
+        if (entity == "amp") c = '&';
+        else if (entity == "lt") c = '<';
+        else if (entity == "gt") c = '>';
+        else if (entity == "quot") c = '"';
+        else if (entity == "apos") c = '\'';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            c = 0;
+            for (size_t j = hex ? 2 : 1; j < entity.size() && c >= 0; j++) {
+                char d = entity[j];
+                int digit = d >= '0' && d <= '9'                 ? d - '0'
+                            : hex && d >= 'a' && d <= 'f'         ? d - 'a' + 10
+                            : hex && d >= 'A' && d <= 'F'         ? d - 'A' + 10
+                                                                  : -1;
+                c = digit < 0 || c > 0xffff ? -1 : c * (hex ? 16 : 10) + digit;
+            }
+            if (c <= 0 || c >= 128) c = -1;
+        }
+        if (c < 0) {
+            out += s[i];
+            continue;
+        }
+        out += static_cast<char>(c);
+        i = semicolon;
+    }
+    return out;
+}
+
+// Read exactly `count` digits at pos
+bool readDigits(std::string_view s, size_t& pos, int count, int& value) {
+    if (pos + count > s.size()) return false;
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        char c = s[pos + i];
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + (c - '0');
+    }
+    pos += count;
+    return true;
+}
+
+} // namespace
+
+time_t parseW3cDatetime(std::string_view value) {
+    value = trim(value);
+    struct tm fields {};
+    int year = 0, month = 1, day = 1, hour = 0, minute = 0, second = 0;
+    long offset = 0;  // seconds east of UTC
+    size_t pos = 0;
+
+    if (!readDigits(value, pos, 4, year) || year < 1970) return 0;
+    if (pos < value.size()) {
+        if (value[pos++] != '-' || !readDigits(value, pos, 2, month)) return 0;
+    }
+    if (pos < value.size()) {
+        if (value[pos++] != '-' || !readDigits(value, pos, 2, day)) return 0;
+    }
+    if (pos < value.size()) {
+        // 'T' per the spec; some generators write a space
+        if ((value[pos] != 'T' && value[pos] != ' ') || !readDigits(value, ++pos, 2, hour) ||
+            pos >= value.size() || value[pos++] != ':' || !readDigits(value, pos, 2, minute)) {
+            return 0;
+        }
+        if (pos < value.size() && value[pos] == ':') {
+            if (!readDigits(value, ++pos, 2, second)) return 0;
+            if (pos < value.size() && value[pos] == '.') {
+                for (pos++; pos < value.size() && value[pos] >= '0' && value[pos] <= '9'; pos++) {}
+            }
+        }
+        if (pos < value.size()) {
+            char sign = value[pos++];
+            int offsetHours = 0, offsetMinutes = 0;
+            if (sign == 'Z') {
+                offset = 0;
+            } else if ((sign == '+' || sign == '-') && readDigits(value, pos, 2, offsetHours) &&
+                       pos < value.size() && value[pos++] == ':' && readDigits(value, pos, 2, offsetMinutes)) {
+                offset = (sign == '+' ? 1 : -1) * (offsetHours * 3600L + offsetMinutes * 60L);
+            } else {
+                return 0;
+            }
+        }
+    }
+    if (pos != value.size() || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 ||
+        second > 60) {
+        return 0;
+    }
+
+    fields.tm_year = year - 1900;
+    fields.tm_mon = month - 1;
+    fields.tm_mday = day;
+    fields.tm_hour = hour;
+    fields.tm_min = minute;
+    fields.tm_sec = second;
+    time_t utc = timegm(&fields);
+    return utc == static_cast<time_t>(-1) ? 0 : utc - offset;
+}
+
+SitemapParser::SitemapParser(Callback onUrl, Callback onSitemap, size_t maxBytes)
+    : onUrl(std::move(onUrl)), onSitemap(std::move(onSitemap)), maxBytes(maxBytes) {}
+
+SitemapParser::~SitemapParser() {
+    if (inflating) inflateEnd(&zstream);
+}
+
+void SitemapParser::feed(const char* data, size_t length) {
+    if (error || length == 0) return;
+
+    // A gzip member starts with 1f 8b. Servers send .xml.gz files as
+    // application/gzip without Content-Encoding, so curl leaves them packed.
+    if (!sniffed) {
+        if (!haveMagic) {
+            haveMagic = true;
+            magic = data[0];
+            data++;
+            length--;
+            if (length == 0) return;
+        }
+        sniffed = true;
+        if (static_cast<unsigned char>(magic) == 0x1f && static_cast<unsigned char>(data[0]) == 0x8b) {
+            if (inflateInit2(&zstream, 16 + MAX_WBITS) != Z_OK) {
+                error = true;
+                return;
+            }
+            inflating = true;
+        }
+        input(&magic, 1);
+    }
+    input(data, length);
+}
+
+void SitemapParser::input(const char* data, size_t length) {
+    if (!inflating) {
+        parse(data, length);
+        return;
+    }
+    if (inflateDone) return;  // trailing bytes after the gzip member
+
+    char out[INFLATE_CHUNK];
+    zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zstream.avail_in = static_cast<uInt>(length);
+    do {
+        zstream.next_out = reinterpret_cast<Bytef*>(out);
+        zstream.avail_out = sizeof(out);
+        int rc = inflate(&zstream, Z_NO_FLUSH);
+        size_t produced = sizeof(out) - zstream.avail_out;
+        parse(out, produced);
+        if (rc == Z_STREAM_END) {
+            inflateDone = true;
+            return;
+        }
+        if (rc == Z_BUF_ERROR && produced == 0) return;  // needs more input
+        if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            error = true;
+            return;
+        }
+    } while (!error && (zstream.avail_in > 0 || zstream.avail_out == 0));
+}
+
+void SitemapParser::parse(const char* data, size_t length) {
+    if (error) return;
+    xmlSize += length;
+    if (maxBytes && xmlSize > maxBytes) {
+        error = true;  // also stops gzip bombs
+        return;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        char c = data[i];
+        switch (state) {
+        case TEXT:
+            if (c == '<') {
+                state = TAG_OPEN;
+                closing = false;
+                selfClosing = false;
+                name.clear();
+            } else {
+                appendText(c);
+            }
+            break;
+        case TAG_OPEN:
+            if (c == '/') {
+                closing = true;
+                state = TAG_NAME;
+            } else if (c == '!') {
+                markup.clear();
+                state = MARKUP;
+            } else if (c == '?') {
+                state = SKIP_DECLARATION;
+            } else {
+                name += c;
+                state = TAG_NAME;
+            }
+            break;
+        case TAG_NAME:
+            if (isSpace(c)) {
+                state = TAG_ATTRIBUTES;
+            } else if (c == '/') {
+                selfClosing = true;
+                state = TAG_ATTRIBUTES;
+            } else if (c == '>') {
+                finishTag();
+            } else if (c == ':') {
+                name.clear();  // keep the local name only
+            } else if (name.size() < MAX_NAME) {
+                name += c;
+            }
+            break;
+        case TAG_ATTRIBUTES:
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '/') {
+                selfClosing = true;
+            } else if (c == '>') {
+                finishTag();
+            } else if (!isSpace(c)) {
+                selfClosing = false;
+            }
+            break;
+        case MARKUP:
+            if (c == '>') {
+                state = TEXT;
+                break;
+            }
+            markup += c;
+            matched = 0;
+            if (markup == "--") {
+                state = COMMENT;
+            } else if (markup == "[CDATA[") {
+                state = CDATA;
+            } else if (markup.size() >= MAX_MARKUP || (std::strncmp("--", markup.c_str(), markup.size()) != 0 &&
+                                                        std::strncmp("[CDATA[", markup.c_str(), markup.size()) != 0)) {
+                state = SKIP_DECLARATION;  // <!DOCTYPE ...>
+            }
+            break;
+        case COMMENT:
+            if (c == '-') {
+                if (matched < 2) matched++;
+            } else if (c == '>' && matched == 2) {
+                state = TEXT;
+            } else {
+                matched = 0;
+            }
+            break;
+        case CDATA:
+            if (c == ']') {
+                if (matched < 2) matched++;
+                else appendText(']');
+            } else if (c == '>' && matched == 2) {
+                state = TEXT;
+            } else {
+                for (; matched > 0; matched--) appendText(']');
+                appendText(c);
+            }
+            break;
+        case SKIP_DECLARATION:
+            if (c == '>') state = TEXT;
+            break;
+        }
+    }
+}
+
+void SitemapParser::finishTag() {
+    state = TEXT;
+    if (closing) {
+        closeElement();
+        return;
+    }
+    openElement();
+    if (selfClosing) closeElement();
+}
+
+void SitemapParser::openElement() {
+    depth++;
+    if (depth > 3) return;
+
+    Element element = OTHER;
+    if (depth == 1) {
+        if (name == "urlset") element = URLSET;
+        else if (name == "sitemapindex") element = SITEMAPINDEX;
+    } else if (depth == 2) {
+        if (path[0] == URLSET && name == "url") element = URL;
+        else if (path[0] == SITEMAPINDEX && name == "sitemap") element = SITEMAP;
+    } else if (path[1] == URL || path[1] == SITEMAP) {
+        if (name == "loc") element = LOC;
+        else if (name == "lastmod") element = LASTMOD;
+    }
+    path[depth - 1] = element;
+
+    if (element == URL || element == SITEMAP) {
+        loc.clear();
+        lastmod.clear();
+        overflow = false;
+    } else if (element == LOC) {
+        loc.clear();
+        text = &loc;
+    } else if (element == LASTMOD) {
+        lastmod.clear();
+        text = &lastmod;
+    }
+}
+
+void SitemapParser::closeElement() {
+    if (depth == 0) return;  // stray closing tag
+    if (depth <= 3) {
+        Element element = path[depth - 1];
+        if (element == LOC || element == LASTMOD) text = nullptr;
+        if (element == URL || element == SITEMAP) emitEntry(element);
+        path[depth - 1] = OTHER;
+    }
+    depth--;
+}
+
+void SitemapParser::appendText(char c) {
+    if (!text) return;
+    if (text->size() >= (text == &loc ? MAX_LOC : MAX_LASTMOD)) {
+        overflow = true;
+        return;
+    }
+    *text += c;
+}
+
+void SitemapParser::emitEntry(Element entry) {
+    if (overflow) return;
+    std::string url = decodeEntities(trim(loc));
+    if (url.empty()) return;
+    time_t lastModified = parseW3cDatetime(lastmod);
+    if (entry == URL) {
+        urls++;
+        if (onUrl) onUrl(url, lastModified);
+    } else {
+        sitemaps++;
+        if (onSitemap) onSitemap(url, lastModified);
+    }
+}
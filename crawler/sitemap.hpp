@@ -0,0 +1,102 @@
+#ifndef SITEMAP_HPP
+#define SITEMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <zlib.h>
+
+// Streaming reader for sitemaps (https://www.sitemaps.org/protocol.html):
+// a <urlset> of pages or a <sitemapindex> of further sitemaps, plain or
+// gzipped. Bytes are fed as they download; each <url> or <sitemap> entry
+// is handed to its callback once its closing tag is seen. Nothing but the
+// current <loc> and <lastmod> is buffered, so memory stays the same for 10
+// entries or 50,000.
+//
+// The tokenizer knows just enough XML for sitemaps: elements are matched by
+// local name (namespace prefixes are ignored), <loc> counts only directly
+// inside <url> or <sitemap> (not image:loc and the like), comments,
+// processing instructions and DOCTYPEs are skipped, CDATA is read as text
+// and the five predefined entities plus numeric ASCII references are
+// decoded.
+class SitemapParser {
+public:
+    // loc is the entry's URL; lastModified its <lastmod> as Unix time, 0 if
+    // missing or unreadable
+    using Callback = std::function<void(const std::string& loc, time_t lastModified)>;
+
+    SitemapParser(Callback onUrl, Callback onSitemap, size_t maxBytes = 50 << 20);
+    ~SitemapParser();
+
+    SitemapParser(const SitemapParser&) = delete;
+    SitemapParser& operator=(const SitemapParser&) = delete;
+
+    // Feed the next downloaded bytes; gzip is recognized from its magic bytes
+    void feed(const char* data, size_t length);
+
+    // Input was corrupt gzip or over maxBytes once decompressed; the rest is ignored
+    bool failed() const { return error; }
+    bool gzipped() const { return inflating; }
+
+    size_t urlCount() const { return urls; }
+    size_t sitemapCount() const { return sitemaps; }
+    size_t xmlBytes() const { return xmlSize; }
+
+private:
+    enum State { TEXT, TAG_OPEN, TAG_NAME, TAG_ATTRIBUTES, MARKUP, COMMENT, CDATA, SKIP_DECLARATION };
+
+    // Where the tokenizer is: the local names of the open elements it cares
+    // about (root, entry, field), deeper elements are only counted
+    enum Element { OTHER, URLSET, SITEMAPINDEX, URL, SITEMAP, LOC, LASTMOD };
+
+    void input(const char* data, size_t length);
+    void parse(const char* data, size_t length);
+    void finishTag();
+    void openElement();
+    void closeElement();
+    void appendText(char c);
+    void emitEntry(Element entry);
+
+    Callback onUrl;
+    Callback onSitemap;
+    size_t maxBytes;
+
+    // gzip
+    bool sniffed = false;
+    bool inflating = false;
+    bool inflateDone = false;
+    z_stream zstream{};
+    bool haveMagic = false;
+    char magic = 0;  // first byte, held until the second arrives
+
+    // Tokenizer
+    State state = TEXT;
+    bool closing = false;      // "</name"
+    bool selfClosing = false;  // "<name/>"
+    char quote = 0;            // inside an attribute value
+    std::string name;          // tag name being read (bounded)
+    std::string markup;        // first bytes after "<!" (bounded)
+    int matched = 0;           // bytes of a terminator ("-->", "]]>") seen so far
+    int depth = 0;
+    Element path[3] = {OTHER, OTHER, OTHER};
+
+    // Current entry
+    std::string loc;
+    std::string lastmod;
+    std::string* text = nullptr;  // field receiving character data, if any
+    bool overflow = false;        // the field outgrew its bound; the entry is dropped
+
+    bool error = false;
+    size_t xmlSize = 0;
+    size_t urls = 0;
+    size_t sitemaps = 0;
+};
+
+// Function to read a W3C datetime (YYYY, YYYY-MM, YYYY-MM-DD or
+// YYYY-MM-DDThh:mm[:ss[.s]]TZD) as Unix time; 0 if it is not one
+time_t parseW3cDatetime(std::string_view value);
+
+#endif // SITEMAP_HPP
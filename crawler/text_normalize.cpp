@@ -0,0 +1,90 @@
+#include "text_normalize.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+inline bool isSpace(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Index of the first whitespace byte at or after i (n if none). Bytes of
+// multibyte UTF-8 characters are all >= 0x80, so they never match and a
+// character is never split by the scan.
+size_t findSpace(const char* s, size_t i, size_t n) {
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+        // \t..\r is (b - '\t') <= 4 unsigned, i.e. min(b - '\t', 4) == b - '\t'
+        __m128i offset = _mm_sub_epi8(bytes, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(offset, four), offset);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), control));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t tab = vdupq_n_u8('\t');
+    const uint8x16_t four = vdupq_n_u8(4);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(s + i));
+        uint8x16_t match = vorrq_u8(vceqq_u8(bytes, space), vcleq_u8(vsubq_u8(bytes, tab), four));
+        if (vmaxvq_u8(match)) break;  // the scalar loop below finds the byte
+    }
+#endif
+    while (i < n && !isSpace(static_cast<unsigned char>(s[i]))) i++;
+    return i;
+}
+
+} // namespace
+
+template <typename String>
+BasicTextNormalizer<String>::BasicTextNormalizer(String& out, size_t maxBytes) : out(out), maxBytes(maxBytes) {
+    out.clear();
+}
+
+template <typename String>
+void BasicTextNormalizer<String>::append(const char* data, size_t length) {
+    size_t i = 0;
+    while (i < length && !overflowed) {
+        size_t end = findSpace(data, i, length);
+        if (end > i) {
+            // Whitespace between words becomes one space; leading whitespace is dropped
+            if (pendingSpace && !out.empty()) out += ' ';
+            pendingSpace = false;
+            out.append(data + i, end - i);
+            overflowed = out.size() > maxBytes;
+        }
+        i = end;
+        while (i < length && isSpace(static_cast<unsigned char>(data[i]))) i++;
+        if (i > end) pendingSpace = true;
+    }
+}
+
+template <typename String>
+void BasicTextNormalizer<String>::finish() {
+    if (!overflowed) return;  // trailing whitespace was never written
+
+    // Back up to the start of the character that straddles the cap
+    size_t cut = maxBytes;
+    while (cut > 0 && (static_cast<unsigned char>(out[cut]) & 0xC0) == 0x80) cut--;
+    out.resize(cut);
+    out += "...";
+}
+
+template class BasicTextNormalizer<std::string>;
+template class BasicTextNormalizer<std::pmr::string>;
+
+std::string normalizeText(const std::string& text, size_t maxBytes) {
+    std::string out;
+    TextNormalizer normalizer(out, maxBytes);
+    normalizer.append(text);
+    normalizer.finish();
+    return out;
+}
@@ -0,0 +1,45 @@
+#ifndef TEXT_NORMALIZE_HPP
+#define TEXT_NORMALIZE_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+// Builds normalized page text in one pass: runs of whitespace (space, \t,
+// \n, \v, \f, \r) become a single space, leading and trailing whitespace is
+// dropped, and the result is capped at maxBytes followed by "...". The cap
+// never splits a UTF-8 character. Input can arrive in pieces (text nodes),
+// and once the cap is reached the rest of the input is ignored.
+// Instantiated for std::string and std::pmr::string outputs.
+template <typename String>
+class BasicTextNormalizer {
+public:
+    explicit BasicTextNormalizer(String& out, size_t maxBytes = std::string::npos);
+
+    void append(const char* data, size_t length);
+    void append(std::string_view text) { append(text.data(), text.size()); }
+
+    // Acts like a whitespace byte between two pieces
+    void separator() { pendingSpace = true; }
+
+    // True once more than maxBytes were produced; further input is ignored
+    bool full() const { return overflowed; }
+
+    // Apply the cap. Call once, after the last append().
+    void finish();
+
+private:
+    String& out;
+    size_t maxBytes;
+    bool pendingSpace = false;
+    bool overflowed = false;
+};
+
+using TextNormalizer = BasicTextNormalizer<std::string>;
+using PmrTextNormalizer = BasicTextNormalizer<std::pmr::string>;
+
+// Function to normalize a whole string (see TextNormalizer)
+std::string normalizeText(const std::string& text, size_t maxBytes = std::string::npos);
+
+#endif // TEXT_NORMALIZE_HPP
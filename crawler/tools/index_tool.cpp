@@ -0,0 +1,64 @@
+// Builds an index segment (see index_segment.hpp) from the pages of a
+// crawler database, or runs queries against one.
+//
+//   ./index_tool build crawler_data.db pages.idx
+//   ./index_tool search pages.idx 'rust "memory safety"' [k=10]
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../index_segment.hpp"
+
+namespace {
+
+int build(const std::string& dbPath, const std::string& segmentPath) {
+    sqlite3* db;
+    if (sqlite3_open_v2(dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        std::cerr << "Cannot open database: " << dbPath << std::endl;
+        sqlite3_close(db);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    long documents = buildIndexSegment(db, segmentPath);
+    sqlite3_close(db);
+    if (documents < 0) return 1;
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    IndexSegment segment(segmentPath);
+    std::cout << "Indexed " << documents << " pages, " << segment.termCount() << " terms in " << std::fixed
+              << std::setprecision(1) << elapsed << "s (" << segment.fileSize() << " bytes)" << std::endl;
+    return 0;
+}
+
+int search(const std::string& segmentPath, const std::string& query, size_t k) {
+    IndexSegment segment(segmentPath);
+    if (!segment.ok()) return 1;
+
+    SearchStats stats;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SearchHit> hits = segment.search(query, k, &stats);
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto& hit : hits) {
+        std::cout << std::fixed << std::setprecision(3) << std::setw(8) << hit.score << "  " << hit.url << "  "
+                  << hit.title << std::endl;
+    }
+    std::cout << hits.size() << " hits in " << std::fixed << std::setprecision(0) << elapsed << "us ("
+              << stats.blocksDecoded << " blocks decoded, " << stats.documentsScored << " postings scored)" << std::endl;
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "build" && argc == 4) return build(argv[2], argv[3]);
+    if (command == "search" && (argc == 4 || argc == 5)) {
+        return search(argv[2], argv[3], argc == 5 ? std::stoul(argv[4]) : 10);
+    }
+    std::cerr << "Usage: " << argv[0] << " build <database> <segment>" << std::endl;
+    std::cerr << "       " << argv[0] << " search <segment> <query> [k]" << std::endl;
+    return 1;
+}
@@ -0,0 +1,45 @@
+// Merges the shard databases of a sharded crawl (see shard.hpp) into one
+// database in the layout the backend reads, pages_fts included. To keep the
+// pages of an existing output database, list it after the shards (a URL
+// keeps its row from the first input that has it).
+//
+//   ./merge_shards crawler_data.db crawler_data.shard-0-of-4.db crawler_data.shard-1-of-4.db ...
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../shard.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <output> <shard>..." << std::endl;
+        return 1;
+    }
+    std::string outPath = argv[1];
+    std::vector<std::string> inputs(argv + 2, argv + argc);
+
+    // The output is replaced, so an existing one must be merged or removed explicitly
+    FILE* existing = std::fopen(outPath.c_str(), "rb");
+    if (existing) {
+        std::fclose(existing);
+        if (std::find(inputs.begin(), inputs.end(), outPath) == inputs.end()) {
+            std::cerr << outPath << " exists: list it as an input to keep its pages, or remove it" << std::endl;
+            return 1;
+        }
+    }
+
+    MergeStats stats;
+    if (!mergeShards(inputs, outPath, stats)) {
+        std::cerr << "Merge failed; " << outPath << " was not changed" << std::endl;
+        return 1;
+    }
+    std::cout << "Merged " << stats.inputs << " databases: " << stats.pages << " pages (" << stats.pagesSkipped
+              << " already merged), " << stats.rows << " other rows copied in " << std::fixed << std::setprecision(2)
+              << stats.copySeconds << "s, FTS built in " << stats.ftsSeconds << "s" << std::endl;
+    std::cout << "Database saved as '" << outPath << "'" << std::endl;
+    return 0;
+}
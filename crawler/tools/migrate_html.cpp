@@ -0,0 +1,184 @@
+// Moves the uncompressed pages.raw_html column of an existing crawler
+// database into the compressed page_html table (see html_store.hpp).
+// A dictionary is trained on a random sample of the stored pages first.
+// Safe to interrupt and run again: it picks up the rows still left.
+//
+//   ./migrate_html crawler_data.db [--vacuum]
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+#include "../database.hpp"
+#include "../html_store.hpp"
+
+namespace {
+
+const int BATCH_ROWS = 500;
+const size_t MIN_DICT_SAMPLES = 16;
+
+long long fileSize(const std::string& path) {
+    struct stat st;
+    long long total = 0;
+    for (const char* suffix : {"", "-wal"}) {
+        if (stat((path + suffix).c_str(), &st) == 0) total += st.st_size;
+    }
+    return total;
+}
+
+bool exec(sqlite3* db, const char* sql) {
+    char* errMsg = 0;
+    if (sqlite3_exec(db, sql, 0, 0, &errMsg) != SQLITE_OK) {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+// Train from a random sample of the rows still to migrate
+void trainDictionary(sqlite3* db, HtmlCompressor& compressor, const HtmlStoreConfig& config) {
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT raw_html FROM pages WHERE raw_html IS NOT NULL ORDER BY random() LIMIT ?";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) return;
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(config.dictSamplePages));
+
+    size_t sampled = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        compressor.addSample(static_cast<const char*>(sqlite3_column_blob(stmt, 0)), sqlite3_column_bytes(stmt, 0));
+        sampled++;
+    }
+    sqlite3_finalize(stmt);
+
+    if (sampled < MIN_DICT_SAMPLES) {
+        std::cout << "Only " << sampled << " pages, compressing without a dictionary" << std::endl;
+        return;
+    }
+    if (compressor.trainDictionary(db)) {
+        std::cout << "Trained dictionary " << compressor.dictionaryId() << " on " << sampled << " pages" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <database> [--vacuum]" << std::endl;
+        return 1;
+    }
+    std::string path = argv[1];
+    bool vacuum = argc > 2 && std::strcmp(argv[2], "--vacuum") == 0;
+    long long sizeBefore = fileSize(path);
+
+    // Creates page_html/html_dicts if this database predates them
+    sqlite3* db = initDatabase(path.c_str());
+    if (!db) return 1;
+
+    sqlite3_stmt* probe;
+    if (sqlite3_prepare_v2(db, "SELECT raw_html FROM pages LIMIT 0", -1, &probe, 0) != SQLITE_OK) {
+        std::cout << "No pages.raw_html column, nothing to migrate" << std::endl;
+        sqlite3_close(db);
+        return 0;
+    }
+    sqlite3_finalize(probe);
+
+    HtmlStoreConfig config;
+    HtmlCompressor compressor(config);
+    if (compressor.loadLatestDictionary(db)) {
+        std::cout << "Using stored dictionary " << compressor.dictionaryId() << std::endl;
+    } else {
+        trainDictionary(db, compressor, config);
+    }
+
+    sqlite3_stmt* select;
+    sqlite3_stmt* insert;
+    sqlite3_stmt* clear;
+    if (sqlite3_prepare_v2(db, "SELECT id, raw_html FROM pages WHERE raw_html IS NOT NULL AND id > ? ORDER BY id LIMIT ?", -1, &select, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO page_html (page_id, dict_id, raw_size, data) VALUES (?, ?, ?, ?)", -1, &insert, 0) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "UPDATE pages SET raw_html = NULL WHERE id = ?", -1, &clear, 0) != SQLITE_OK) {
+        std::cerr << "Failed to prepare statements: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_close(db);
+        return 1;
+    }
+
+    // raw_html is not indexed, so clearing it must not re-index every page
+    // in pages_fts; createSchema() puts the trigger back afterwards
+    exec(db, "DROP TRIGGER IF EXISTS pages_au");
+
+    auto start = std::chrono::steady_clock::now();
+    sqlite3_int64 lastId = 0;
+    size_t migrated = 0, failed = 0;
+    std::string compressed;
+    bool more = true;
+    std::vector<std::pair<sqlite3_int64, std::string>> batch;
+    while (more) {
+        // Read the batch first: rows are not changed under a running SELECT
+        batch.clear();
+        sqlite3_bind_int64(select, 1, lastId);
+        sqlite3_bind_int(select, 2, BATCH_ROWS);
+        while (sqlite3_step(select) == SQLITE_ROW) {
+            const char* html = static_cast<const char*>(sqlite3_column_blob(select, 1));
+            batch.emplace_back(sqlite3_column_int64(select, 0), html ? std::string(html, sqlite3_column_bytes(select, 1)) : std::string());
+        }
+        sqlite3_reset(select);
+        more = batch.size() == static_cast<size_t>(BATCH_ROWS);
+        if (batch.empty()) break;
+        lastId = batch.back().first;
+
+        exec(db, "BEGIN TRANSACTION");
+        for (const auto& [pageId, html] : batch) {
+            if (!compressor.compress(html.data(), html.size(), compressed)) {
+                failed++;
+                continue;
+            }
+
+            sqlite3_bind_int64(insert, 1, pageId);
+            sqlite3_bind_int64(insert, 2, compressor.dictionaryId());
+            sqlite3_bind_int64(insert, 3, static_cast<sqlite3_int64>(html.size()));
+            sqlite3_bind_blob(insert, 4, compressed.data(), static_cast<int>(compressed.size()), SQLITE_STATIC);
+            bool ok = sqlite3_step(insert) == SQLITE_DONE;
+            sqlite3_reset(insert);
+            if (ok) {
+                sqlite3_bind_int64(clear, 1, pageId);
+                ok = sqlite3_step(clear) == SQLITE_DONE;
+                sqlite3_reset(clear);
+            }
+            if (ok) {
+                migrated++;
+            } else {
+                std::cerr << "Failed to migrate page " << pageId << ": " << sqlite3_errmsg(db) << std::endl;
+                failed++;
+            }
+        }
+        exec(db, "COMMIT");
+        std::cout << "\r" << migrated << " pages migrated" << std::flush;
+    }
+    std::cout << std::endl;
+
+    sqlite3_finalize(select);
+    sqlite3_finalize(insert);
+    sqlite3_finalize(clear);
+    createSchema(db);
+
+    if (vacuum) {
+        std::cout << "Vacuuming..." << std::endl;
+        exec(db, "PRAGMA wal_checkpoint(TRUNCATE)");
+        exec(db, "VACUUM");
+    }
+    sqlite3_close(db);
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double ratio = compressor.compressedBytes() ? static_cast<double>(compressor.rawBytes()) / compressor.compressedBytes() : 0;
+    std::cout << "Migrated " << migrated << " pages (" << failed << " failed) in " << std::fixed
+              << std::setprecision(1) << elapsed << "s" << std::endl;
+    std::cout << "HTML: " << compressor.rawBytes() << " -> " << compressor.compressedBytes() << " bytes ("
+              << std::setprecision(2) << ratio << "x)" << std::endl;
+    std::cout << "Database file: " << sizeBefore << " -> " << fileSize(path) << " bytes"
+              << (vacuum ? "" : " (run with --vacuum to reclaim the freed pages)") << std::endl;
+    return failed ? 1 : 0;
+}
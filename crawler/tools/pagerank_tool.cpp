@@ -0,0 +1,75 @@
+// Ranks the pages of a crawler database by their links (see pagerank.hpp)
+// and stores the result in pages.page_rank for the backend.
+//
+//   ./pagerank_tool crawler_data.db [threads] [top=10]
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../database.hpp"
+#include "../pagerank.hpp"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printTop(sqlite3* db, size_t top) {
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT page_rank, url FROM pages WHERE page_rank IS NOT NULL ORDER BY page_rank DESC LIMIT ?";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, 0) != SQLITE_OK) return;
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(top));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        std::cout << std::fixed << std::setprecision(3) << std::setw(10) << sqlite3_column_double(stmt, 0) << "  "
+                  << sqlite3_column_text(stmt, 1) << std::endl;
+    }
+    sqlite3_finalize(stmt);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <database> [threads] [top]" << std::endl;
+        return 1;
+    }
+    PageRankOptions options;
+    if (argc > 2) options.threads = static_cast<unsigned>(std::stoul(argv[2]));
+    size_t top = argc > 3 ? std::stoul(argv[3]) : 10;
+
+    // initDatabase adds the page_rank column to older databases
+    sqlite3* db = initDatabase(argv[1]);
+    if (!db) return 1;
+
+    auto start = std::chrono::steady_clock::now();
+    LinkGraph graph;
+    size_t linksRead = 0;
+    if (!loadLinkGraph(db, graph, &linksRead, options.threads)) {
+        sqlite3_close(db);
+        return 1;
+    }
+    double loadSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    PageRankResult result = computePageRank(graph, options);
+    double rankSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    bool saved = savePageRank(db, graph, result.rank);
+    double saveSeconds = secondsSince(start);
+
+    std::cout << "Graph: " << graph.nodeCount() << " pages, " << graph.edgeCount() << " links between them ("
+              << linksRead << " stored) loaded in " << std::fixed << std::setprecision(2) << loadSeconds << "s"
+              << std::endl;
+    std::cout << "PageRank: " << result.iterations << " iterations in " << rankSeconds << "s, "
+              << (result.converged ? "converged" : "stopped at the iteration limit") << " (change "
+              << std::scientific << std::setprecision(1) << result.change << ")" << std::endl;
+    std::cout << "Saved in " << std::fixed << std::setprecision(2) << saveSeconds << "s\n" << std::endl;
+    if (saved) printTop(db, top);
+
+    sqlite3_close(db);
+    return saved ? 0 : 1;
+}
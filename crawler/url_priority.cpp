@@ -0,0 +1,162 @@
+#include "url_priority.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#include "html_parser.hpp"
+#include "url_utils.hpp"
+
+namespace {
+
+// Path segments of pages that rarely belong in a search index: accounts,
+// legal and help pages, listings and feeds. Matched against the letters a
+// lowercased segment starts with ("login", "login.php", "terms-of-use").
+const std::string_view LOW_VALUE_SEGMENTS[] = {
+    "login", "logout", "signin", "sign", "signup", "register", "account", "profile",
+    "cart", "checkout", "basket", "privacy", "terms", "cookie", "cookies", "legal", "disclaimer",
+    "contact", "help", "faq", "support", "subscribe", "newsletter", "feedback", "careers", "jobs",
+    "advertise", "advertising", "tag", "tags", "search", "share", "print", "feed", "rss", "sitemap",
+    "comments", "preferences",
+};
+
+// LOW_VALUE_SEGMENTS by first letter
+const std::array<std::vector<std::string_view>, 26> LOW_VALUE_BY_LETTER = []() {
+    std::array<std::vector<std::string_view>, 26> table;
+    for (std::string_view word : LOW_VALUE_SEGMENTS) table[word[0] - 'a'].push_back(word);
+    return table;
+}();
+
+// Query parameters of pagination, sorting, sessions, tracking and edit views
+const std::string_view LOW_VALUE_PARAMS[] = {
+    "page=", "sort=", "order=", "filter", "session", "sid=", "utm_", "ref=", "action=", "oldid=",
+    "diff=", "printable=", "returnto=", "redirect",
+};
+
+// File types the crawler would skip after downloading them
+const std::string_view NON_HTML_EXTENSIONS[] = {
+    ".pdf", ".jpg", ".jpeg", ".png", ".gif", ".webp", ".svg", ".ico", ".zip", ".gz", ".mp3", ".mp4",
+    ".avi", ".mov", ".css", ".js", ".json", ".xml", ".doc", ".docx", ".xls", ".xlsx", ".ppt", ".exe",
+};
+
+const int BASE_SCORE = LINK_PRIORITY_LEVELS / 2;
+const time_t RECENT_SECONDS = 30 * 86400;
+
+bool startsWith(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// The letters s starts with ("terms" of "terms-of-use")
+std::string_view leadingWord(std::string_view s) {
+    size_t n = 0;
+    while (n < s.size() && s[n] >= 'a' && s[n] <= 'z') n++;
+    return s.substr(0, n);
+}
+
+// ASCII only: URLs are percent-encoded, and this runs for every queued link
+void assignLowercase(std::string& out, std::string_view s) {
+    out.resize(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        out[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+}
+
+bool endsWith(std::string_view s, std::string_view suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// A segment that reads like an article: several words joined by - or _,
+// or a year as in /2024/05/...
+bool looksLikeContent(std::string_view segment) {
+    int separators = 0;
+    for (char c : segment) separators += (c == '-' || c == '_');
+    if (separators >= 2) return true;
+    return segment.size() == 4 && (startsWith(segment, "19") || startsWith(segment, "20")) &&
+           std::isdigit(static_cast<unsigned char>(segment[2])) &&
+           std::isdigit(static_cast<unsigned char>(segment[3]));
+}
+
+} // namespace
+
+// Function to score a link from cheap signals
+int linkPriority(std::string_view url, const LinkSignals& signals) {
+    int score = BASE_SCORE;
+
+    // Shallow pages first, then pages many links point to (+1 per doubling, up to +4)
+    score -= std::min(signals.depth, 4);
+    int inlinkBonus = 0;
+    for (unsigned n = signals.inlinks; n > 1 && inlinkBonus < 4; n >>= 1) inlinkBonus++;
+    score += inlinkBonus;
+
+    // Anchor text and page region, when the parser saw the link
+    if (signals.flags >= 0) {
+        score += (signals.flags & LINK_HAS_TEXT) ? 1 : -1;
+        if (signals.flags & LINK_BOILERPLATE) score -= 2;
+    }
+
+    // Pages a sitemap lists as recently changed
+    if (signals.lastModified > 0) {
+        time_t age = std::time(nullptr) - signals.lastModified;
+        if (age < RECENT_SECONDS) score += 2;
+        else if (age < 12 * RECENT_SECONDS) score += 1;
+    }
+
+    // URL shape (matched in lowercase; the buffer is reused across calls)
+    thread_local std::string lower;
+    UrlParts parts = parseUrl(url);
+    assignLowercase(lower, parts.path);
+    std::string_view path = lower;
+
+    if (url.size() > 200) score -= 2;
+    else if (url.size() > 120) score -= 1;
+
+    size_t dot = path.rfind('.');
+    if (dot != std::string_view::npos && path.find('/', dot) == std::string_view::npos) {
+        for (std::string_view extension : NON_HTML_EXTENSIONS) {
+            if (endsWith(path, extension)) {
+                score -= 6;
+                break;
+            }
+        }
+    }
+
+    int segments = 0;
+    bool lowValue = false;
+    bool content = false;
+    bool namespaced = false;
+    while (!path.empty()) {
+        size_t slash = path.find('/');
+        std::string_view segment = path.substr(0, slash);
+        path = slash == std::string_view::npos ? std::string_view() : path.substr(slash + 1);
+        if (segment.empty()) continue;
+        segments++;
+        std::string_view word = leadingWord(segment);
+        if (!word.empty()) {
+            for (std::string_view lowValueWord : LOW_VALUE_BY_LETTER[word[0] - 'a']) {
+                if (word == lowValueWord) lowValue = true;
+            }
+        }
+        if (segment.find(':') != std::string_view::npos) namespaced = true;  // Special:, Talk:, File:, ...
+        if (looksLikeContent(segment)) content = true;
+    }
+    if (lowValue) score -= 4;
+    if (namespaced) score -= 2;
+    if (content) score += 1;
+    if (segments > 6) score -= 1;
+
+    if (parts.hasQuery) {
+        score -= 1;
+        assignLowercase(lower, parts.query);
+        for (std::string_view param : LOW_VALUE_PARAMS) {
+            if (lower.find(param) != std::string::npos) {
+                score -= 2;
+                break;
+            }
+        }
+    }
+
+    return std::clamp(score, 0, LINK_PRIORITY_LEVELS - 1);
+}
@@ -0,0 +1,24 @@
+#ifndef URL_PRIORITY_HPP
+#define URL_PRIORITY_HPP
+
+#include <ctime>
+#include <string_view>
+
+// Priority levels of the crawl frontier; higher is crawled first
+const int LINK_PRIORITY_LEVELS = 16;
+
+// What is known about a link when it is queued
+struct LinkSignals {
+    int depth = 0;         // of the page the link leads to
+    unsigned inlinks = 1;  // times the link has been found so far (on this site)
+    int flags = -1;        // LinkFlag bits from the parser, -1 if unknown
+    time_t lastModified = 0;  // <lastmod> of a sitemap entry, 0 if unknown
+};
+
+// Function to score a link from cheap signals: depth, in-links seen so far,
+// URL length and path shape, whether the anchor had text or sat in
+// navigation, and how recently a sitemap says the page changed. Returns a
+// level in [0, LINK_PRIORITY_LEVELS).
+int linkPriority(std::string_view url, const LinkSignals& signals);
+
+#endif // URL_PRIORITY_HPP
@@ -0,0 +1,185 @@
+#include "url_seen.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const char FILE_MAGIC[8] = {'U', 'R', 'L', 'S', 'E', 'E', 'N', '1'};
+const int BLOOM_PROBES = 4;
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t roundUpPow2(uint64_t n) {
+    uint64_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+uint64_t UrlSeenFilter::fingerprint(const std::string& url) {
+    // FNV-1a over the bytes, then a finalizer so every bit is well mixed
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : url) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h = mix64(h ^ url.size());
+    return h ? h : 1;  // 0 is the empty-slot marker
+}
+
+UrlSeenFilter::UrlSeenFilter(size_t expectedUrls)
+    : bloomBits(roundUpPow2(std::max<uint64_t>(expectedUrls * 10, 1 << 16))),
+      shards(new Shard[SHARD_COUNT]) {
+    bloom.reset(new std::atomic<uint64_t>[bloomBits / 64]);
+    for (uint64_t i = 0; i < bloomBits / 64; i++) {
+        bloom[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool UrlSeenFilter::bloomMayContain(uint64_t fp) const {
+    // Double hashing: probe i uses h1 + i*h2
+    uint64_t h1 = fp, h2 = (fp >> 32) | 1;
+    for (int i = 0; i < BLOOM_PROBES; i++) {
+        uint64_t bit = (h1 + i * h2) & (bloomBits - 1);
+        if (!(bloom[bit / 64].load(std::memory_order_acquire) & (1ULL << (bit % 64)))) return false;
+    }
+    return true;
+}
+
+void UrlSeenFilter::bloomAdd(uint64_t fp) {
+    uint64_t h1 = fp, h2 = (fp >> 32) | 1;
+    for (int i = 0; i < BLOOM_PROBES; i++) {
+        uint64_t bit = (h1 + i * h2) & (bloomBits - 1);
+        bloom[bit / 64].fetch_or(1ULL << (bit % 64), std::memory_order_release);
+    }
+}
+
+bool UrlSeenFilter::Shard::find(uint64_t fp) const {
+    if (slots.empty()) return false;
+    size_t mask = slots.size() - 1;
+    for (size_t i = (fp >> 6) & mask;; i = (i + 1) & mask) {
+        if (slots[i] == fp) return true;
+        if (slots[i] == 0) return false;
+    }
+}
+
+bool UrlSeenFilter::Shard::add(uint64_t fp) {
+    if ((used + 1) * 10 > slots.size() * 7) grow();  // keep load under 70%
+    size_t mask = slots.size() - 1;
+    for (size_t i = (fp >> 6) & mask;; i = (i + 1) & mask) {
+        if (slots[i] == fp) return false;
+        if (slots[i] == 0) {
+            slots[i] = fp;
+            used++;
+            return true;
+        }
+    }
+}
+
+void UrlSeenFilter::Shard::grow() {
+    std::vector<uint64_t> old;
+    old.swap(slots);
+    slots.assign(old.empty() ? 1024 : old.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (uint64_t fp : old) {
+        if (!fp) continue;
+        size_t i = (fp >> 6) & mask;
+        while (slots[i]) i = (i + 1) & mask;
+        slots[i] = fp;
+    }
+}
+
+bool UrlSeenFilter::containsFingerprint(uint64_t fp) const {
+    if (!bloomMayContain(fp)) return false;  // definitely new, no lock taken
+    const Shard& shard = shards[fp % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.find(fp);
+}
+
+bool UrlSeenFilter::insertFingerprint(uint64_t fp) {
+    Shard& shard = shards[fp % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.add(fp)) return false;
+    // Set the Bloom bits after the table holds the entry, so a reader that
+    // passes the filter always finds it in the shard
+    bloomAdd(fp);
+    count++;
+    return true;
+}
+
+bool UrlSeenFilter::save(const std::string& path) const {
+    // Write to a temporary file and rename, so a crash never leaves a torn file
+    std::string tmpPath = path + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot write URL-seen file: " << tmpPath << std::endl;
+        return false;
+    }
+
+    // Snapshot shard by shard so the count always matches what is written
+    std::vector<uint64_t> packed;
+    packed.reserve(size());
+    for (size_t s = 0; s < SHARD_COUNT; s++) {
+        std::lock_guard<std::mutex> lock(shards[s].mutex);
+        for (uint64_t fp : shards[s].slots) {
+            if (fp) packed.push_back(fp);
+        }
+    }
+
+    uint64_t total = packed.size();
+    bool ok = std::fwrite(FILE_MAGIC, sizeof(FILE_MAGIC), 1, file) == 1 &&
+              std::fwrite(&total, sizeof(total), 1, file) == 1 &&
+              (packed.empty() || std::fwrite(packed.data(), sizeof(uint64_t), packed.size(), file) == packed.size());
+
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to save URL-seen file: " << path << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool UrlSeenFilter::load(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return true;  // first run
+
+    char magic[sizeof(FILE_MAGIC)];
+    uint64_t total = 0;
+    if (std::fread(magic, sizeof(magic), 1, file) != 1 || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+        std::fread(&total, sizeof(total), 1, file) != 1) {
+        std::cerr << "Ignoring invalid URL-seen file: " << path << std::endl;
+        std::fclose(file);
+        return false;
+    }
+
+    std::vector<uint64_t> chunk(64 * 1024);
+    uint64_t read = 0;
+    while (read < total) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(chunk.size(), total - read));
+        size_t got = std::fread(chunk.data(), sizeof(uint64_t), want, file);
+        for (size_t i = 0; i < got; i++) {
+            if (chunk[i]) insertFingerprint(chunk[i]);
+        }
+        read += got;
+        if (got < want) break;
+    }
+    std::fclose(file);
+
+    if (read != total) {
+        std::cerr << "URL-seen file is truncated: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
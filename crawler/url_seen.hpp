@@ -0,0 +1,65 @@
+#ifndef URL_SEEN_HPP
+#define URL_SEEN_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set of URLs the crawler has already seen, shared by every site and worker.
+// URLs are kept as 64-bit fingerprints in open-addressing tables (sharded,
+// one lock each), fronted by a lock-free Bloom filter so most lookups of new
+// URLs never take a lock. The fingerprints can be written to a file and
+// loaded again on the next run.
+class UrlSeenFilter {
+public:
+    // expectedUrls sizes the Bloom filter (~10 bits per URL); the tables grow
+    // as needed, so going past it only makes the front less selective
+    explicit UrlSeenFilter(size_t expectedUrls = 1 << 20);
+
+    UrlSeenFilter(const UrlSeenFilter&) = delete;
+    UrlSeenFilter& operator=(const UrlSeenFilter&) = delete;
+
+    static uint64_t fingerprint(const std::string& url);
+
+    bool contains(const std::string& url) const { return containsFingerprint(fingerprint(url)); }
+
+    // Mark a URL as seen. Returns false if it was already there, so
+    // concurrent callers racing on the same URL see exactly one true.
+    bool insert(const std::string& url) { return insertFingerprint(fingerprint(url)); }
+
+    bool containsFingerprint(uint64_t fp) const;
+    bool insertFingerprint(uint64_t fp);
+
+    size_t size() const { return count.load(); }
+
+    // Persist / restore the fingerprints (a missing file loads as empty)
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+private:
+    static const size_t SHARD_COUNT = 64;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<uint64_t> slots;  // 0 marks an empty slot
+        size_t used = 0;
+
+        bool find(uint64_t fp) const;
+        bool add(uint64_t fp);
+        void grow();
+    };
+
+    bool bloomMayContain(uint64_t fp) const;
+    void bloomAdd(uint64_t fp);
+
+    std::unique_ptr<std::atomic<uint64_t>[]> bloom;
+    uint64_t bloomBits;  // power of two
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<size_t> count{0};
+};
+
+#endif // URL_SEEN_HPP
@@ -0,0 +1,258 @@
+#include "url_utils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+bool isAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool isSchemeChar(char c) {
+    return isAlpha(c) || (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.';
+}
+
+char toLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (toLower(a[i]) != b[i]) return false;
+    }
+    return true;
+}
+
+void appendLower(std::string& out, std::string_view s) {
+    size_t start = out.size();
+    out.append(s.data(), s.size());
+    std::transform(out.begin() + start, out.end(), out.begin() + start, toLower);
+}
+
+// The authority without "userinfo@"
+std::string_view hostAndPort(const UrlParts& parts) {
+    const char* at = static_cast<const char*>(std::memchr(parts.authority.data(), '@', parts.authority.size()));
+    return at ? parts.authority.substr(at + 1 - parts.authority.data()) : parts.authority;
+}
+
+// remove_dot_segments (RFC 3986 section 5.2.4) on s[start..], in place. The
+// output never grows past the input consumed so far, so both can share the
+// buffer. When "/." or "/.." ends the input it is replaced by "/", which is
+// the byte already at s[in], so the input is shortened to that byte.
+void removeDotSegments(std::string& s, size_t start) {
+    // Most paths have no segment starting with '.'
+    if ((start == s.size() || s[start] != '.') && s.find("/.", start) == std::string::npos) return;
+
+    size_t in = start;
+    size_t end = s.size();
+    size_t out = start;
+
+    auto popSegment = [&]() {
+        size_t slash = std::string_view(s.data() + start, out - start).rfind('/');
+        out = slash == std::string_view::npos ? start : start + slash;
+    };
+
+    while (in < end) {
+        std::string_view input(s.data() + in, end - in);
+        if (input.compare(0, 3, "../") == 0) {
+            in += 3;
+        } else if (input.compare(0, 2, "./") == 0) {
+            in += 2;
+        } else if (input.compare(0, 3, "/./") == 0) {
+            in += 2;
+        } else if (input == "/.") {
+            end = in + 1;
+        } else if (input.compare(0, 4, "/../") == 0) {
+            in += 3;
+            popSegment();
+        } else if (input == "/..") {
+            end = in + 1;
+            popSegment();
+        } else if (input == "." || input == "..") {
+            in = end;
+        } else {
+            // Move the first segment (with its leading '/') to the output
+            size_t segmentEnd = s.find('/', in + 1);
+            if (segmentEnd == std::string::npos || segmentEnd > end) segmentEnd = end;
+            std::memmove(&s[out], &s[in], segmentEnd - in);
+            out += segmentEnd - in;
+            in = segmentEnd;
+        }
+    }
+    s.resize(out);
+}
+
+} // namespace
+
+bool UrlParts::isHttp() const {
+    return hasAuthority && !host.empty() && isHttpScheme(scheme);
+}
+
+// Function to split a URL or relative reference into its components
+UrlParts parseUrl(std::string_view url) {
+    UrlParts parts;
+    size_t pos = 0;
+
+    // The fragment starts at the first '#', the query at the first '?' before it
+    const char* hash = static_cast<const char*>(std::memchr(url.data(), '#', url.size()));
+    size_t fragmentStart = hash ? hash - url.data() : url.size();
+    const char* question = static_cast<const char*>(std::memchr(url.data(), '?', fragmentStart));
+    size_t queryStart = question ? question - url.data() : fragmentStart;
+
+    // scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) ":"
+    if (!url.empty() && isAlpha(url[0])) {
+        size_t i = 1;
+        while (i < url.size() && isSchemeChar(url[i])) i++;
+        if (i < url.size() && url[i] == ':') {
+            parts.scheme = url.substr(0, i);
+            parts.hasScheme = true;
+            pos = i + 1;
+        }
+    }
+
+    if (url.compare(pos, 2, "//") == 0) {
+        const char* slash = static_cast<const char*>(std::memchr(url.data() + pos + 2, '/', queryStart - pos - 2));
+        size_t end = slash ? slash - url.data() : queryStart;
+        parts.authority = url.substr(pos + 2, end - pos - 2);
+        parts.hasAuthority = true;
+        pos = end;
+
+        std::string_view hostPort = hostAndPort(parts);
+        size_t colon;
+        if (!hostPort.empty() && hostPort[0] == '[') {
+            size_t close = hostPort.find(']');
+            colon = close == std::string_view::npos ? close : hostPort.find(':', close);
+        } else {
+            colon = hostPort.find(':');
+        }
+        parts.host = hostPort.substr(0, colon);
+        if (colon != std::string_view::npos) parts.port = hostPort.substr(colon + 1);
+    }
+
+    parts.path = url.substr(pos, queryStart - pos);
+
+    if (queryStart < fragmentStart) {
+        parts.query = url.substr(queryStart + 1, fragmentStart - queryStart - 1);
+        parts.hasQuery = true;
+    }
+
+    if (fragmentStart < url.size()) {
+        parts.fragment = url.substr(fragmentStart + 1);
+        parts.hasFragment = true;
+    }
+    return parts;
+}
+
+bool isHttpScheme(std::string_view scheme) {
+    return equalsIgnoreCase(scheme, "http") || equalsIgnoreCase(scheme, "https");
+}
+
+bool resolveUrl(const UrlParts& base, const UrlParts& ref, std::string& out) {
+    if (!base.hasScheme) return false;
+    const UrlParts& authoritySource = (ref.hasScheme || ref.hasAuthority) ? ref : base;
+
+    out.clear();
+    out.reserve(base.scheme.size() + base.authority.size() + base.path.size() + ref.authority.size() +
+                ref.path.size() + ref.query.size() + ref.fragment.size() + 8);
+    out.append(ref.hasScheme ? ref.scheme : base.scheme);
+    out += ':';
+    if (authoritySource.hasAuthority) {
+        out += "//";
+        out.append(authoritySource.authority);
+    }
+
+    size_t pathStart = out.size();
+    const UrlParts* querySource = &ref;
+    if (ref.hasScheme || ref.hasAuthority) {
+        out.append(ref.path);
+        removeDotSegments(out, pathStart);
+    } else if (ref.path.empty()) {
+        // Same document: the base path, and the base query unless one is given
+        out.append(base.path);
+        if (!ref.hasQuery) querySource = &base;
+    } else {
+        if (ref.path[0] != '/') {
+            // Merge with the base path up to its last '/'
+            if (base.hasAuthority && base.path.empty()) {
+                out += '/';
+            } else {
+                size_t slash = base.path.rfind('/');
+                if (slash != std::string_view::npos) out.append(base.path.substr(0, slash + 1));
+            }
+        }
+        out.append(ref.path);
+        removeDotSegments(out, pathStart);
+    }
+
+    if (querySource->hasQuery) {
+        out += '?';
+        out.append(querySource->query);
+    }
+    if (ref.hasFragment) {
+        out += '#';
+        out.append(ref.fragment);
+    }
+    return true;
+}
+
+bool resolveUrl(const UrlParts& base, std::string_view reference, std::string& out) {
+    return resolveUrl(base, parseUrl(reference), out);
+}
+
+// Function to resolve a reference against an absolute base URL
+bool resolveUrl(std::string_view base, std::string_view reference, std::string& out) {
+    return resolveUrl(parseUrl(base), parseUrl(reference), out);
+}
+
+// Function to normalize URLs (remove trailing slashes, fragments, lowercase)
+std::string normalizeUrl(const std::string& url) {
+    UrlParts parts = parseUrl(url);
+
+    // Remove fragment (#section)
+    size_t length = parts.hasFragment ? parts.fragment.data() - url.data() - 1 : url.size();
+
+    // Remove trailing slash (except for root domains). Kept textual so the
+    // keys match the ones already stored in the URL-seen file.
+    std::string_view kept(url.data(), length);
+    if (length > 8 && kept.back() == '/') {
+        size_t protocolEnd = kept.find("://");
+        if (protocolEnd != std::string_view::npos) {
+            size_t pathStart = kept.find('/', protocolEnd + 3);
+            if (pathStart != std::string_view::npos && pathStart < length - 1) length--;
+        }
+    }
+
+    // Convert to lowercase (for case-insensitive comparison)
+    std::string normalized;
+    appendLower(normalized, kept.substr(0, length));
+    return normalized;
+}
+
+// Extract the host of a URL without the "www." prefix (used for same-site checks)
+std::string extractBaseDomain(const std::string& url) {
+    UrlParts parts = parseUrl(url);
+    std::string_view domain = hostAndPort(parts);
+
+    // Remove www. prefix if present
+    if (domain.size() > 4 && equalsIgnoreCase(domain.substr(0, 4), "www.")) {
+        domain.remove_prefix(4);
+    }
+    std::string result;
+    appendLower(result, domain);
+    return result;
+}
+
+// Extract "scheme://host" from a URL (the politeness key for a crawl)
+std::string extractOrigin(const std::string& url) {
+    UrlParts parts = parseUrl(url);
+    if (!parts.hasScheme || !parts.hasAuthority) return url;
+    std::string origin;
+    origin.reserve(parts.scheme.size() + parts.authority.size() + 3);
+    appendLower(origin, parts.scheme);
+    origin += "://";
+    appendLower(origin, parts.authority);
+    return origin;
+}
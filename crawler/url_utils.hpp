@@ -0,0 +1,46 @@
+#ifndef URL_UTILS_HPP
+#define URL_UTILS_HPP
+
+#include <string>
+#include <string_view>
+
+// Components of a URI reference (RFC 3986 section 3). Every field is a view
+// into the string that was parsed, so it must outlive the parts.
+struct UrlParts {
+    std::string_view scheme;     // without the ':'
+    std::string_view authority;  // [userinfo@]host[:port]
+    std::string_view host;       // IPv6 literals keep their brackets
+    std::string_view port;
+    std::string_view path;
+    std::string_view query;      // without the '?'
+    std::string_view fragment;   // without the '#'
+    bool hasScheme = false;
+    bool hasAuthority = false;
+    bool hasQuery = false;
+    bool hasFragment = false;
+
+    bool isHttp() const;  // scheme is http or https (any case) and there is a host
+};
+
+// Function to split a URL or relative reference into its components (no copies)
+UrlParts parseUrl(std::string_view url);
+
+// Function to resolve a reference against an absolute base URL (RFC 3986
+// section 5.2, dot segments removed). The result is written to out; returns
+// false if the base has no scheme. out must not overlap base or reference.
+bool resolveUrl(std::string_view base, std::string_view reference, std::string& out);
+bool resolveUrl(const UrlParts& base, std::string_view reference, std::string& out);
+bool resolveUrl(const UrlParts& base, const UrlParts& reference, std::string& out);
+
+bool isHttpScheme(std::string_view scheme);  // "http" or "https", any case
+
+// Function to normalize URLs (remove trailing slashes, fragments, lowercase)
+std::string normalizeUrl(const std::string& url);
+
+// Extract the host of a URL without the "www." prefix (used for same-site checks)
+std::string extractBaseDomain(const std::string& url);
+
+// Extract "scheme://host" from a URL (the politeness key for a crawl)
+std::string extractOrigin(const std::string& url);
+
+#endif // URL_UTILS_HPP
@@ -0,0 +1,153 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+void HostTask::failed(const std::string& error) {
+    std::cerr << "Host task failed: " << error << std::endl;
+}
+
+WorkStealingPool::WorkStealingPool(size_t numThreads) {
+    if (numThreads == 0) numThreads = 1;
+    for (size_t i = 0; i < numThreads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    for (auto& t : threads) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void WorkStealingPool::submit(std::shared_ptr<HostTask> task) {
+    pending++;
+    size_t index = nextWorker++ % workers.size();
+    pushLocal(index, std::move(task));
+}
+
+void WorkStealingPool::pushLocal(size_t index, std::shared_ptr<HostTask> task) {
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    idleCv.notify_one();
+}
+
+// Requeue a task that has more work, or park it until its host is ready
+void WorkStealingPool::reschedule(size_t index, std::shared_ptr<HostTask> task) {
+    auto readyAt = task->nextRunTime();
+    if (readyAt <= std::chrono::steady_clock::now()) {
+        pushLocal(index, std::move(task));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        timers.push({readyAt, std::move(task)});
+    }
+    defers++;
+    idleCv.notify_one();  // an idle worker may need to wake earlier now
+}
+
+// Move parked tasks whose time has come to this worker's deque. Returns when
+// the next parked task becomes ready (time_point::max() if there is none).
+std::chrono::steady_clock::time_point WorkStealingPool::releaseDueTasks(size_t index) {
+    std::vector<std::shared_ptr<HostTask>> due;
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::time_point::max();
+    {
+        std::lock_guard<std::mutex> lock(timerMutex);
+        auto now = std::chrono::steady_clock::now();
+        while (!timers.empty() && timers.top().readyAt <= now) {
+            due.push_back(timers.top().task);
+            timers.pop();
+        }
+        if (!timers.empty()) next = timers.top().readyAt;
+    }
+    for (auto& task : due) {
+        pushLocal(index, std::move(task));
+    }
+    return next;
+}
+
+// Owner takes from the front so its hosts are served round-robin
+std::shared_ptr<HostTask> WorkStealingPool::popLocal(size_t index) {
+    std::lock_guard<std::mutex> lock(workers[index]->mutex);
+    if (workers[index]->tasks.empty()) return nullptr;
+    auto task = std::move(workers[index]->tasks.front());
+    workers[index]->tasks.pop_front();
+    return task;
+}
+
+// Thieves take from the back, away from the owner's next pick
+std::shared_ptr<HostTask> WorkStealingPool::steal(size_t thief) {
+    size_t n = workers.size();
+    for (size_t offset = 1; offset < n; offset++) {
+        Worker& victim = *workers[(thief + offset) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            auto task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            steals++;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    while (pending.load() > 0) {
+        auto nextTimer = releaseDueTasks(index);
+        std::shared_ptr<HostTask> task = popLocal(index);
+        if (!task) task = steal(index);
+
+        if (!task) {
+            // Nothing runnable right now; other workers still hold tasks
+            // that may be requeued, so wait until the next parked host is
+            // ready (at most 50ms) instead of exiting.
+            auto wakeAt = std::min(nextTimer, std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idleCv.wait_until(lock, wakeAt);
+            continue;
+        }
+
+        bool more = false;
+        std::string error;
+        try {
+            more = task->runSlice();
+        } catch (const std::exception& e) {
+            error = e.what();
+            if (error.empty()) error = "unknown error";
+        } catch (...) {
+            error = "unknown error";
+        }
+        if (!error.empty()) {
+            // The task is dropped; let it save its progress first
+            failures++;
+            try {
+                task->failed(error);
+            } catch (const std::exception& e) {
+                std::cerr << "Worker " << index << ": failure handler threw: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Worker " << index << ": failure handler threw" << std::endl;
+            }
+        }
+
+        if (more) {
+            reschedule(index, std::move(task));
+        } else if (--pending == 0) {
+            idleCv.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::run() {
+    for (size_t i = 0; i < workers.size(); i++) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    threads.clear();
+}
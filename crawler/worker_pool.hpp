@@ -0,0 +1,96 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A unit of crawl work bound to a single host. Only one worker runs a given
+// task at a time, so the task itself is the politeness owner for its host.
+class HostTask {
+public:
+    virtual ~HostTask() = default;
+
+    // Run a bounded slice of work (a few pages). Return true if the task
+    // still has work left and should be scheduled again.
+    virtual bool runSlice() = 0;
+
+    // Earliest time the next slice may start (the host's politeness delay).
+    // The pool parks the task until then and runs other hosts meanwhile.
+    virtual std::chrono::steady_clock::time_point nextRunTime() const { return {}; }
+
+    // Called when runSlice threw, before the pool drops the task. Override
+    // it to save what the task has done so far.
+    virtual void failed(const std::string& error);
+};
+
+// Fixed-size pool of worker threads. Each worker keeps its own deque of host
+// tasks and round-robins over them; a worker with an empty deque steals a
+// task from the back of another worker's deque. Tasks that are not ready yet
+// wait in a min-heap ordered by nextRunTime(), so no worker sleeps through a
+// host's crawl delay while another host has work.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(size_t numThreads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Add a task before or during run(). Tasks are spread across workers.
+    void submit(std::shared_ptr<HostTask> task);
+
+    // Start the workers and block until every task has finished.
+    void run();
+
+    size_t threadCount() const { return workers.size(); }
+    size_t stealCount() const { return steals.load(); }
+    size_t deferCount() const { return defers.load(); }  // slices that waited for their host
+    size_t failureCount() const { return failures.load(); }  // tasks dropped because runSlice threw
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::shared_ptr<HostTask>> tasks;
+    };
+
+    struct Delayed {
+        std::chrono::steady_clock::time_point readyAt;
+        std::shared_ptr<HostTask> task;
+
+        bool operator>(const Delayed& other) const { return readyAt > other.readyAt; }
+    };
+
+    void workerLoop(size_t index);
+    std::shared_ptr<HostTask> popLocal(size_t index);
+    std::shared_ptr<HostTask> steal(size_t thief);
+    void pushLocal(size_t index, std::shared_ptr<HostTask> task);
+    void reschedule(size_t index, std::shared_ptr<HostTask> task);
+    std::chrono::steady_clock::time_point releaseDueTasks(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex timerMutex;
+    std::priority_queue<Delayed, std::vector<Delayed>, std::greater<Delayed>> timers;
+
+    std::mutex idleMutex;
+    std::condition_variable idleCv;
+
+    std::atomic<size_t> pending{0};   // tasks submitted but not finished
+    std::atomic<size_t> nextWorker{0};
+    std::atomic<size_t> steals{0};
+    std::atomic<size_t> defers{0};
+    std::atomic<size_t> failures{0};
+};
+
+#endif // WORKER_POOL_HPP